@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cfloat>
+#include <iomanip>
+#include <iostream>
+#include <sys/time.h>
+
+#include "SusyNtuple/CutflowEngine.h"
+
+using namespace std;
+using namespace Susy;
+
+/*--------------------------------------------------------------------------------*/
+// CutflowEngine constructor
+/*--------------------------------------------------------------------------------*/
+CutflowEngine::CutflowEngine(uint nChannels) :
+        m_nChannels(nChannels),
+        m_booked(false),
+        m_doTiming(false),
+        m_generation(0),
+        m_decisionOnly(false),
+        m_reorderPeriod(1000),
+        m_nProcessed(0)
+{
+}
+/*--------------------------------------------------------------------------------*/
+CutflowEngine::~CutflowEngine()
+{
+  for(uint i=0; i<m_cuts.size(); i++) delete m_cuts[i].cut;
+}
+/*--------------------------------------------------------------------------------*/
+// Cut and region definitions
+/*--------------------------------------------------------------------------------*/
+bool CutflowEngine::addCut(const string& name, CutflowCut* cut)
+{
+  if(m_booked || findCut(name) >= 0){
+    cout << "CutflowEngine::addCut ERROR cannot add cut " << name << endl;
+    delete cut;
+    return false;
+  }
+  Cut c;
+  c.name = name;
+  c.cut = cut;
+  c.generation = 0;
+  c.result = false;
+  c.barrier = false;
+  m_cuts.push_back(c);
+  return true;
+}
+/*--------------------------------------------------------------------------------*/
+bool CutflowEngine::addRegion(const string& name, const string& cuts)
+{
+  if(m_booked || regionIndex(name) >= 0){
+    cout << "CutflowEngine::addRegion ERROR cannot add region " << name << endl;
+    return false;
+  }
+
+  // Resolve the cut names first, so a bad region leaves the tree unchanged
+  vector<uint> cutList;
+  string::size_type start = 0;
+  while(start <= cuts.size()){
+    string::size_type end = cuts.find(',', start);
+    if(end == string::npos) end = cuts.size();
+    string cutName = cuts.substr(start, end - start);
+    int iCut = findCut(cutName);
+    if(iCut < 0){
+      cout << "CutflowEngine::addRegion ERROR unknown cut '" << cutName
+           << "' in region " << name << endl;
+      return false;
+    }
+    cutList.push_back(iCut);
+    start = end + 1;
+  }
+
+  // Walk down the tree, sharing the nodes of the regions with the same prefix
+  Region region;
+  region.name = name;
+  int parent = -1;
+  for(uint i=0; i<cutList.size(); i++){
+    int node = -1;
+    for(uint n=0; n<m_nodes.size(); n++){
+      if(m_nodes[n].parent == parent && m_nodes[n].cut == cutList[i]){
+        node = n;
+        break;
+      }
+    }
+    if(node < 0){
+      Node newNode;
+      newNode.cut = cutList[i];
+      newNode.parent = parent;
+      m_nodes.push_back(newNode);
+      node = m_nodes.size() - 1;
+    }
+    region.nodes.push_back(node);
+    parent = node;
+  }
+  region.order = cutList;
+  m_regions.push_back(region);
+  return true;
+}
+/*--------------------------------------------------------------------------------*/
+bool CutflowEngine::setBarrier(const string& cut)
+{
+  int iCut = findCut(cut);
+  if(iCut < 0){
+    cout << "CutflowEngine::setBarrier ERROR unknown cut " << cut << endl;
+    return false;
+  }
+  m_cuts[iCut].barrier = true;
+  return true;
+}
+/*--------------------------------------------------------------------------------*/
+void CutflowEngine::book()
+{
+  m_booked = true;
+  m_pass.assign(m_nodes.size(), 0);
+  m_counts.assign(NtSys_N*nCounts(), 0);
+  m_nEval.assign(m_cuts.size(), 0);
+  m_nPass.assign(m_cuts.size(), 0);
+  m_time.assign(m_cuts.size(), 0);
+}
+/*--------------------------------------------------------------------------------*/
+void CutflowEngine::reset()
+{
+  m_counts.assign(m_counts.size(), 0);
+  m_nEval.assign(m_nEval.size(), 0);
+  m_nPass.assign(m_nPass.size(), 0);
+  m_time.assign(m_time.size(), 0);
+  m_nProcessed = 0;
+}
+/*--------------------------------------------------------------------------------*/
+int CutflowEngine::findCut(const string& name) const
+{
+  for(uint i=0; i<m_cuts.size(); i++) if(m_cuts[i].name == name) return i;
+  return -1;
+}
+/*--------------------------------------------------------------------------------*/
+int CutflowEngine::regionIndex(const string& region) const
+{
+  for(uint i=0; i<m_regions.size(); i++) if(m_regions[i].name == region) return i;
+  return -1;
+}
+/*--------------------------------------------------------------------------------*/
+// Event processing
+/*--------------------------------------------------------------------------------*/
+void CutflowEngine::process(uint ch, uint sys)
+{
+  if(!m_booked) book();
+
+  // New event, forget the cut results. Slot generations start at 0.
+  if(++m_generation == 0){
+    for(uint i=0; i<m_cuts.size(); i++) m_cuts[i].generation = 0;
+    m_generation = 1;
+  }
+
+  if(m_decisionOnly){
+    processDecisions(ch, sys);
+    return;
+  }
+
+  // Parents come before their children, so one pass over the nodes
+  // evaluates every region in order
+  uint* counts = &m_counts[sys*nCounts()];
+  for(uint n=0; n<m_nodes.size(); n++){
+    const Node& node = m_nodes[n];
+    bool pass = (node.parent < 0 || m_pass[node.parent]) && evalCut(node.cut);
+    m_pass[n] = pass;
+    if(pass) counts[n*m_nChannels + ch]++;
+  }
+}
+/*--------------------------------------------------------------------------------*/
+bool CutflowEngine::evalCut(uint iCut)
+{
+  Cut& c = m_cuts[iCut];
+  if(c.generation == m_generation) return c.result;
+
+  if(m_doTiming){
+    timeval t0, t1;
+    gettimeofday(&t0, 0);
+    c.result = c.cut->pass();
+    gettimeofday(&t1, 0);
+    m_time[iCut] += (t1.tv_sec - t0.tv_sec) + 1e-6*(t1.tv_usec - t0.tv_usec);
+  }
+  else c.result = c.cut->pass();
+
+  m_nEval[iCut]++;
+  if(c.result) m_nPass[iCut]++;
+  c.generation = m_generation;
+  return c.result;
+}
+/*--------------------------------------------------------------------------------*/
+// Region decisions with reordered cuts
+/*--------------------------------------------------------------------------------*/
+void CutflowEngine::setDecisionOnly(bool decisionOnly, uint reorderPeriod)
+{
+  m_decisionOnly = decisionOnly;
+  m_reorderPeriod = reorderPeriod;
+  // The ordering needs the cut cost
+  if(m_decisionOnly) m_doTiming = true;
+}
+/*--------------------------------------------------------------------------------*/
+void CutflowEngine::processDecisions(uint ch, uint sys)
+{
+  // Only the last node of each region is used in this mode
+  m_pass.assign(m_pass.size(), 0);
+  for(uint r=0; r<m_regions.size(); r++){
+    const Region& region = m_regions[r];
+    if(region.nodes.empty()) continue;
+    bool pass = true;
+    for(uint i=0; i<region.order.size(); i++){
+      if(!evalCut(region.order[i])){
+        pass = false;
+        break;
+      }
+    }
+    if(pass) m_pass[region.nodes.back()] = 1;
+  }
+
+  // Regions with the same cuts share their last node, count it once
+  uint* counts = &m_counts[sys*nCounts()];
+  for(uint n=0; n<m_nodes.size(); n++){
+    if(m_pass[n]) counts[n*m_nChannels + ch]++;
+  }
+
+  if(m_reorderPeriod && ++m_nProcessed % m_reorderPeriod == 0) reorder();
+}
+/*--------------------------------------------------------------------------------*/
+double CutflowEngine::rank(uint iCut) const
+{
+  // Not measured yet, run it early to learn about it
+  if(m_nEval[iCut] == 0) return 0;
+  double cost = m_time[iCut] / m_nEval[iCut];
+  double rejection = 1. - double(m_nPass[iCut]) / m_nEval[iCut];
+  if(rejection <= 0) return DBL_MAX;
+  return cost / rejection;
+}
+/*--------------------------------------------------------------------------------*/
+namespace
+{
+  // Order cuts by rank, keeping the analysis order for equal ranks
+  struct RankLess
+  {
+    RankLess(const vector<double>& ranks) : r(ranks) {}
+    bool operator()(uint a, uint b) const { return r[a] < r[b]; }
+    const vector<double>& r;
+  };
+}
+/*--------------------------------------------------------------------------------*/
+void CutflowEngine::reorder()
+{
+  if(!m_booked) return;
+  vector<double> ranks(m_cuts.size());
+  for(uint i=0; i<m_cuts.size(); i++) ranks[i] = rank(i);
+
+  for(uint r=0; r<m_regions.size(); r++){
+    Region& region = m_regions[r];
+    // Start from the analysis order, sort the cuts between barriers
+    region.order.clear();
+    for(uint s=0; s<region.nodes.size(); s++) region.order.push_back(m_nodes[region.nodes[s]].cut);
+    vector<uint>::iterator begin = region.order.begin();
+    for(vector<uint>::iterator it = region.order.begin(); it != region.order.end(); ++it){
+      if(m_cuts[*it].barrier){
+        stable_sort(begin, it, RankLess(ranks));
+        begin = it + 1;
+      }
+    }
+    stable_sort(begin, region.order.end(), RankLess(ranks));
+  }
+}
+/*--------------------------------------------------------------------------------*/
+bool CutflowEngine::passed(uint iRegion) const
+{
+  const Region& region = m_regions[iRegion];
+  return m_booked && !region.nodes.empty() && m_pass[region.nodes.back()];
+}
+/*--------------------------------------------------------------------------------*/
+bool CutflowEngine::passed(const string& region) const
+{
+  int iRegion = regionIndex(region);
+  return iRegion >= 0 && passed(iRegion);
+}
+/*--------------------------------------------------------------------------------*/
+uint CutflowEngine::count(uint iRegion, uint step, uint ch, uint sys) const
+{
+  if(!m_booked) return 0;
+  uint node = m_regions[iRegion].nodes[step];
+  return m_counts[sys*nCounts() + node*m_nChannels + ch];
+}
+/*--------------------------------------------------------------------------------*/
+// Printout
+/*--------------------------------------------------------------------------------*/
+void CutflowEngine::print(uint sys, uint ch) const
+{
+  for(uint r=0; r<m_regions.size(); r++){
+    cout << "---------------------------------" << endl;
+    // Only the full region is counted when the cuts are reordered
+    uint first = m_decisionOnly && nSteps(r)? nSteps(r) - 1 : 0;
+    for(uint s=first; s<nSteps(r); s++){
+      uint iCut = m_nodes[m_regions[r].nodes[s]].cut;
+      string label = "pass " + m_regions[r].name + " " + cutName(iCut) + ":";
+      cout << left << setw(24) << label << right << " " << count(r, s, ch, sys) << endl;
+    }
+  }
+}
+/*--------------------------------------------------------------------------------*/
+void CutflowEngine::printTiming() const
+{
+  if(!m_booked) return;
+  cout << "Cut timing" << endl;
+  for(uint i=0; i<m_cuts.size(); i++){
+    double perEval = m_nEval[i]? 1e6*m_time[i]/m_nEval[i] : 0;
+    double passFrac = m_nEval[i]? double(m_nPass[i])/m_nEval[i] : 0;
+    cout << "  " << left << setw(16) << m_cuts[i].name << right
+         << " evaluations " << setw(10) << m_nEval[i]
+         << " pass " << setw(6) << fixed << setprecision(3) << passFrac;
+    if(m_doTiming){
+      cout << " time " << setw(9) << fixed << setprecision(3) << m_time[i] << " s"
+           << " per evaluation " << setw(9) << perEval << " us";
+    }
+    cout << endl;
+  }
+  cout.unsetf(ios::fixed);
+
+  if(m_decisionOnly){
+    cout << "Cut evaluation order" << endl;
+    for(uint r=0; r<m_regions.size(); r++){
+      cout << "  " << left << setw(8) << m_regions[r].name << right;
+      for(uint i=0; i<m_regions[r].order.size(); i++) cout << " " << cutName(m_regions[r].order[i]);
+      cout << endl;
+    }
+  }
+}
@@ -0,0 +1,148 @@
+#include "SusyNtuple/EventView.h"
+
+using namespace std;
+using namespace Susy;
+
+namespace
+{
+  /// Fill the nominal kinematic columns of entry i
+  void fillKinematics(ObjectColumns& c, uint i, const Particle& p)
+  {
+    // Same construction as Particle::resetTLV
+    TLorentzVector tlv;
+    tlv.SetPtEtaPhiM(p.pt, p.eta, p.phi, p.m);
+    c.pt[i]  = p.pt;
+    c.eta[i] = p.eta;
+    c.phi[i] = p.phi;
+    c.px[i]  = tlv.Px();
+    c.py[i]  = tlv.Py();
+    c.pz[i]  = tlv.Pz();
+    c.e[i]   = tlv.E();
+  }
+}
+
+/*--------------------------------------------------------------------------------*/
+// Fill the table for one entry
+/*--------------------------------------------------------------------------------*/
+void EventView::fill(SusyNtObject* susyNt, bool n0150BugFix)
+{
+  m_filled = true;
+  m_n0150BugFix = n0150BugFix;
+  clearScales();
+
+  // Electrons
+  const vector<Electron>* elecs = susyNt->ele();
+  uint nEle = elecs->size();
+  ele.resize(nEle);
+  m_ele0 = nEle? &(*elecs)[0] : 0;
+  for(uint i=0; i<nEle; i++){
+    const Electron& el = (*elecs)[i];
+    fillKinematics(ele, i, el);
+    ele.q[i] = el.q;
+    ele.flags[i] = (el.tightPP? EVF_TightPP : 0) | (el.mediumPP? EVF_MediumPP : 0);
+  }
+
+  // Muons
+  const vector<Muon>* muons = susyNt->muo();
+  uint nMuo = muons->size();
+  muo.resize(nMuo);
+  m_muo0 = nMuo? &(*muons)[0] : 0;
+  for(uint i=0; i<nMuo; i++){
+    const Muon& mu = (*muons)[i];
+    fillKinematics(muo, i, mu);
+    muo.q[i] = mu.q;
+    muo.flags[i] = (mu.isCombined? EVF_Combined : 0) | (mu.isBadMuon? EVF_BadMuon : 0) |
+                   (mu.isCosmic? EVF_Cosmic : 0);
+  }
+
+  // Taus
+  const vector<Tau>* taus = susyNt->tau();
+  uint nTau = taus->size();
+  tau.resize(nTau);
+  m_tau0 = nTau? &(*taus)[0] : 0;
+  for(uint i=0; i<nTau; i++){
+    const Tau& t = (*taus)[i];
+    fillKinematics(tau, i, t);
+    tau.q[i] = t.q;
+    tau.flags[i] = t.jetBDTSigMedium==1? EVF_TauMedium : 0;
+  }
+
+  // Jets
+  const vector<Jet>* jets = susyNt->jet();
+  uint nJet = jets->size();
+  jet.resize(nJet);
+  m_jet0 = nJet? &(*jets)[0] : 0;
+  jetDetEta.resize(nJet);
+  jetJvf.resize(nJet);
+  jetMv1.resize(nJet);
+  for(uint i=0; i<nJet; i++){
+    const Jet& j = (*jets)[i];
+    fillKinematics(jet, i, j);
+    jet.q[i] = 0;
+    jet.flags[i] = (j.isBadVeryLoose? EVF_BadJet : 0) | (j.isHotTile? EVF_HotTile : 0) |
+                   (j.mv1 > MV1_80? EVF_BTag : 0);
+    jetDetEta[i] = j.detEta;
+    jetJvf[i]    = j.jvf;
+    jetMv1[i]    = j.mv1;
+  }
+  computeScales(NtSys_NOM);
+}
+/*--------------------------------------------------------------------------------*/
+// Scale factors of one systematic
+/*--------------------------------------------------------------------------------*/
+void EventView::computeScales(SusyNtSys sys)
+{
+  m_hasScales[sys] = true;
+  uint nEle = ele.size();
+  for(uint i=0; i<nEle; i++) ele.sf[sys*nEle + i] = m_ele0[i].sysScale(sys);
+  uint nMuo = muo.size();
+  for(uint i=0; i<nMuo; i++) muo.sf[sys*nMuo + i] = m_muo0[i].sysScale(sys, m_n0150BugFix);
+  uint nTau = tau.size();
+  for(uint i=0; i<nTau; i++) tau.sf[sys*nTau + i] = m_tau0[i].sysScale(sys);
+  uint nJet = jet.size();
+  for(uint i=0; i<nJet; i++) jet.sf[sys*nJet + i] = m_jet0[i].sysScale(sys);
+}
+/*--------------------------------------------------------------------------------*/
+void EventView::clear()
+{
+  m_filled = false;
+  clearScales();
+  ele.clear();
+  muo.clear();
+  tau.clear();
+  jet.clear();
+  jetDetEta.clear();
+  jetJvf.clear();
+  jetMv1.clear();
+}
+/*--------------------------------------------------------------------------------*/
+// Systematics envelope
+/*--------------------------------------------------------------------------------*/
+void ObjectColumns::fillEnvelope(const vector<SusyNtSys>& sysList, float minPt)
+{
+  uint n = size();
+  envSys.assign(NtSys_N, 0);
+  for(uint k=0; k<sysList.size(); k++) envSys[sysList[k]] = 1;
+
+  cand.clear();
+  for(uint i=0; i<n; i++){
+    // Same float product as the selection cuts, so the envelope is exact
+    float maxPt = -1;
+    for(uint k=0; k<sysList.size(); k++){
+      float ptSys = sf[sysList[k]*n + i] * pt[i];
+      if(ptSys > maxPt) maxPt = ptSys;
+    }
+    ptMax[i] = maxPt;
+    if(maxPt >= minPt) cand.push_back(i);
+  }
+  candMinPt = minPt;
+}
+/*--------------------------------------------------------------------------------*/
+void EventView::fillEnvelope(const vector<SusyNtSys>& sysList)
+{
+  for(uint k=0; k<sysList.size(); k++) fillScales(sysList[k]);
+  ele.fillEnvelope(sysList, ELECTRON_PT_CUT);
+  muo.fillEnvelope(sysList, MUON_PT_CUT);
+  tau.fillEnvelope(sysList, TAU_PT_CUT);
+  jet.fillEnvelope(sysList, JET_PT_CUT);
+}
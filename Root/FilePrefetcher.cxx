@@ -0,0 +1,92 @@
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "TFile.h"
+
+#include "SusyNtuple/FilePrefetcher.h"
+
+using namespace std;
+
+namespace
+{
+  // Size of the reads of the background thread
+  const size_t ReadSize = 4*1024*1024;
+}
+
+/*--------------------------------------------------------------------------------*/
+// FilePrefetcher constructor
+/*--------------------------------------------------------------------------------*/
+FilePrefetcher::FilePrefetcher() :
+        m_running(false),
+        m_stop(false),
+        m_bytesRead(0),
+        m_threadBytes(0)
+{
+}
+/*--------------------------------------------------------------------------------*/
+FilePrefetcher::~FilePrefetcher()
+{
+  stop();
+}
+/*--------------------------------------------------------------------------------*/
+// Start warming up a file
+/*--------------------------------------------------------------------------------*/
+void FilePrefetcher::prefetch(const string& fileName)
+{
+  if(fileName == m_fileName) return;
+  stop();
+  m_fileName = fileName;
+
+  // Remote files are opened by ROOT, which handles the asynchronous open itself
+  string::size_type proto = fileName.find("://");
+  if(proto != string::npos && fileName.compare(0, proto, "file") != 0){
+    TFile::AsyncOpen(fileName.c_str());
+    return;
+  }
+
+  m_stop = false;
+  m_threadBytes = 0;
+  if(pthread_create(&m_thread, 0, &FilePrefetcher::readFile, this) != 0){
+    cout << "FilePrefetcher::prefetch WARNING cannot start the thread for " << fileName << endl;
+    return;
+  }
+  m_running = true;
+}
+/*--------------------------------------------------------------------------------*/
+void FilePrefetcher::stop()
+{
+  if(!m_running) return;
+  m_stop = true;
+  pthread_join(m_thread, 0);
+  m_running = false;
+  m_bytesRead += m_threadBytes;
+}
+/*--------------------------------------------------------------------------------*/
+// Background thread
+/*--------------------------------------------------------------------------------*/
+void* FilePrefetcher::readFile(void* arg)
+{
+  FilePrefetcher* self = static_cast<FilePrefetcher*>(arg);
+
+  string path = self->m_fileName;
+  if(path.compare(0, 7, "file://") == 0) path = path.substr(7);
+  else if(path.compare(0, 5, "file:") == 0) path = path.substr(5);
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0) return 0;
+#ifdef POSIX_FADV_WILLNEED
+  posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+  // The advice is only a hint, read the file to make sure it is cached
+  self->m_buffer.resize(ReadSize);
+  while(!self->m_stop){
+    ssize_t n = read(fd, &self->m_buffer[0], ReadSize);
+    if(n <= 0) break;
+    self->m_threadBytes += n;
+  }
+  close(fd);
+  return 0;
+}
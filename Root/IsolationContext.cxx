@@ -0,0 +1,49 @@
+#include "SusyNtuple/IsolationContext.h"
+
+using namespace std;
+using namespace Susy;
+
+/*--------------------------------------------------------------------------------*/
+// Fill the table for a set of baseline leptons
+/*--------------------------------------------------------------------------------*/
+void IsolationContext::fill(const ElectronVector& baseElectrons, const MuonVector& baseMuons)
+{
+  m_valid = true;
+
+  uint nEl = baseElectrons.size();
+  uint nMu = baseMuons.size();
+  m_nLep = nEl + nMu;
+  m_ele.assign(baseElectrons.begin(), baseElectrons.end());
+  m_muo.assign(baseMuons.begin(), baseMuons.end());
+
+  // Lepton four-momenta, electrons first
+  m_p4.resize(m_nLep);
+  for(uint i=0; i<nEl; i++) m_p4[i] = *m_ele[i];
+  for(uint i=0; i<nMu; i++) m_p4[nEl+i] = *m_muo[i];
+
+  // Pairwise delta R. DeltaR is symmetric, compute each pair once.
+  m_dR.resize(m_nLep*m_nLep);
+  for(uint i=0; i<m_nLep; i++){
+    m_dR[i*m_nLep + i] = 0;
+    for(uint j=i+1; j<m_nLep; j++){
+      float dR = m_p4[i].DeltaR(m_p4[j]);
+      m_dR[i*m_nLep + j] = dR;
+      m_dR[j*m_nLep + i] = dR;
+    }
+  }
+
+  semiSignal.assign(m_nLep, 0);
+  clusEt.assign(nEl, 0);
+}
+/*--------------------------------------------------------------------------------*/
+int IsolationContext::index(const Electron* e) const
+{
+  for(uint i=0; i<m_ele.size(); i++) if(m_ele[i] == e) return i;
+  return -1;
+}
+/*--------------------------------------------------------------------------------*/
+int IsolationContext::index(const Muon* m) const
+{
+  for(uint i=0; i<m_muo.size(); i++) if(m_muo[i] == m) return m_ele.size() + i;
+  return -1;
+}
@@ -2,11 +2,18 @@
 
 #include "SusyNtuple/SusyNt.h"
 #include "SusyNtuple/SusyNtObject.h"
+#include "SusyNtuple/EventView.h"
+#include "SusyNtuple/IsolationContext.h"
+#include "SusyNtuple/CutflowEngine.h"
+#include "SusyNtuple/SusyNtSummary.h"
+#include "SusyNtuple/SusyNtSkimWriter.h"
+#include "SusyNtuple/SusyNtColumnCache.h"
 #include "SusyNtuple/SusyDefs.h"
 
 #include "SusyNtuple/D3PDReadStats.h"
 #include "SusyNtuple/D3PDPerfStats.h"
 #include "SusyNtuple/ChainHelper.h"
+#include "SusyNtuple/ParallelDriver.h"
 #include "SusyNtuple/SusyNtTools.h"
 #include "SusyNtuple/SusyNtAna.h"
 #include "SusyNtuple/SusyNtTruthAna.h"
@@ -38,6 +45,14 @@
 #pragma link C++ class D3PDReader::D3PDPerfStats+;
 
 #pragma link C++ class Susy::SusyNtObject;
+#pragma link C++ class Susy::ObjectColumns;
+#pragma link C++ class Susy::EventView;
+#pragma link C++ class Susy::IsolationContext;
+#pragma link C++ class Susy::CutflowEngine;
+#pragma link C++ class Susy::SusyNtSummary;
+#pragma link C++ class Susy::SusyNtZone;
+#pragma link C++ class Susy::SusyNtSkimWriter;
+#pragma link C++ class Susy::SusyNtColumnCache;
 #pragma link C++ class Susy::Particle+;
 #pragma link C++ class Susy::Lepton+;
 #pragma link C++ class Susy::Electron+;
@@ -47,6 +62,8 @@
 #pragma link C++ class Susy::Jet+;
 #pragma link C++ class Susy::Met+;
 #pragma link C++ class Susy::Event+;
+// Version 29 may store the systematic cutFlags as deltas, see Event::packCutFlags
+#pragma read sourceClass="Susy::Event" targetClass="Susy::Event" version="[29-]" source="" target="" code="{ newObj->unpackCutFlags(); }"
 #pragma link C++ class Susy::TruthParticle+;
 #pragma link C++ class Susy::TruthJet+;
 #pragma link C++ class Susy::TruthMet+;
@@ -67,6 +84,7 @@
 //Tools //optional to have this here ?
 #pragma link C++ class SusyNtTools+;
 #pragma link C++ class ChainHelper+;
+#pragma link C++ class ParallelDriver+;
 
 #pragma link C++ enum SusyNtSys+;
 #pragma link C++ enum BTagSys+;
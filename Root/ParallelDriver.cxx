@@ -0,0 +1,235 @@
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "TChainElement.h"
+#include "TEntryList.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TMethodCall.h"
+#include "TSystem.h"
+
+#include "SusyNtuple/ParallelDriver.h"
+#include "SusyNtuple/SusyNtAna.h"
+
+using namespace std;
+
+/*--------------------------------------------------------------------------------*/
+// ParallelDriver Constructor
+/*--------------------------------------------------------------------------------*/
+ParallelDriver::ParallelDriver(int nWorkers) :
+        m_nWorkers(nWorkers),
+        m_tmpDir(gSystem->TempDirectory()),
+        m_verbose(false),
+        m_jobId(0)
+{
+}
+
+/*--------------------------------------------------------------------------------*/
+// Process the chain
+/*--------------------------------------------------------------------------------*/
+ParallelDriver::Status ParallelDriver::process(TChain* chain, SusyNtAna* ana, const char* option,
+                                               Long64_t nEvt, Long64_t nSkip)
+{
+  // Single process, nothing to do
+  if(m_nWorkers <= 1){
+    chain->Process(ana, option, nEvt<0? TChain::kBigNumber : nEvt, nSkip);
+    return GOOD;
+  }
+
+  // The entries are counted in the entry list, if any, like TTree::Process
+  TEntryList* entryList = chain->GetEntryList();
+  Long64_t nEntries = entryList? entryList->GetN() : chain->GetEntries();
+  Long64_t first = nSkip;
+  Long64_t last  = nEvt<0? nEntries : first + nEvt;
+  if(last > nEntries) last = nEntries;
+  if(first >= last){
+    cout << "ParallelDriver WARNING no entries to process" << endl;
+    return GOOD;
+  }
+
+  // Don't start more workers than entries
+  Long64_t nToProcess = last - first;
+  int nWorkers = m_nWorkers;
+  if(nToProcess < nWorkers) nWorkers = (int) nToProcess;
+
+  // Begin is only called once, like on a PROOF client. The workers inherit
+  // the configured selector (trigger logic, booked histograms, ...) via fork.
+  ana->SetOption(option);
+  ana->Begin(chain);
+
+  // Tag the worker files with the parent pid
+  m_jobId = gSystem->GetPid();
+
+  // Flush the output buffers so the workers don't repeat them
+  cout.flush();
+  fflush(stdout);
+
+  vector<pid_t> pids(nWorkers, 0);
+  for(int iW=0; iW<nWorkers; iW++){
+    Long64_t wFirst = first + nToProcess*iW/nWorkers;
+    Long64_t wLast  = first + nToProcess*(iW+1)/nWorkers;
+    if(m_verbose){
+      cout << "ParallelDriver starting worker " << iW << " for entries ["
+           << wFirst << ", " << wLast << ")" << endl;
+    }
+    pid_t pid = fork();
+    if(pid < 0){
+      cerr << "ParallelDriver ERROR failed to fork worker " << iW << endl;
+      // Collect the workers which are already running before giving up
+      for(int jW=0; jW<iW; jW++) waitpid(pids[jW], 0, 0);
+      return BAD;
+    }
+    if(pid == 0){
+      // Worker process: never return into the caller
+      Status status = runWorker(chain, ana, wFirst, wLast, workerFileName(iW));
+      cout.flush();
+      fflush(stdout);
+      _exit(status==GOOD? 0 : 1);
+    }
+    pids[iW] = pid;
+  }
+
+  // Wait for the workers
+  Status status = GOOD;
+  for(int iW=0; iW<nWorkers; iW++){
+    int wStatus = 0;
+    if(waitpid(pids[iW], &wStatus, 0) < 0 || !WIFEXITED(wStatus) || WEXITSTATUS(wStatus)!=0){
+      cerr << "ParallelDriver ERROR worker " << iW << " failed" << endl;
+      status = BAD;
+    }
+  }
+
+  // Merge the worker output into the parent selector
+  bool addDir = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(kFALSE);
+  for(int iW=0; iW<nWorkers; iW++){
+    string fileName = workerFileName(iW);
+    TFile* file = TFile::Open(fileName.c_str());
+    if(file == 0 || file->IsZombie()){
+      cerr << "ParallelDriver ERROR cannot open worker output " << fileName << endl;
+      status = BAD;
+      delete file;
+      continue;
+    }
+    TList input;
+    TIter nextKey(file->GetListOfKeys());
+    while(TKey* key = (TKey*) nextKey()){
+      TObject* obj = key->ReadObj();
+      if(obj->InheritsFrom(TH1::Class())) ((TH1*)obj)->SetDirectory(0);
+      input.Add(obj);
+    }
+    file->Close();
+    delete file;
+    gSystem->Unlink(fileName.c_str());
+
+    mergeOutput(ana->GetOutputList(), &input);
+    input.Delete();
+  }
+  TH1::AddDirectory(addDir);
+
+  if(status != GOOD){
+    cerr << "ParallelDriver ERROR not all workers finished, results are incomplete" << endl;
+  }
+
+  // Put the merged counters back into the selector and finish
+  ana->retrieveCounters();
+  ana->Terminate();
+
+  return status;
+}
+
+/*--------------------------------------------------------------------------------*/
+// Worker event loop
+/*--------------------------------------------------------------------------------*/
+ParallelDriver::Status ParallelDriver::runWorker(TChain* chain, SusyNtAna* ana,
+                                                 Long64_t first, Long64_t last,
+                                                 const string& outFile)
+{
+  // The file descriptors inherited from the parent share their offsets,
+  // so the worker has to open its own copy of the chain
+  TChain* wChain = new TChain(chain->GetName());
+  TIter next(chain->GetListOfFiles());
+  while(TChainElement* element = (TChainElement*) next()){
+    wChain->Add(element->GetTitle());
+  }
+  TEntryList* entryList = chain->GetEntryList();
+  if(entryList) wChain->SetEntryList(entryList);
+
+  // Same call sequence as TTreePlayer::Process
+  wChain->SetNotify(ana);
+  ana->SlaveBegin(wChain);
+  ana->Init(wChain);
+  ana->Notify();
+  for(Long64_t entry=first; entry<last; entry++){
+    // With an entry list, the range counts the entries of the list
+    Long64_t chainEntry = entryList? wChain->GetEntryNumber(entry) : entry;
+    if(chainEntry < 0) break;
+    Long64_t localEntry = wChain->LoadTree(chainEntry);
+    if(localEntry < 0) break;
+    ana->Process(localEntry);
+    if(ana->GetAbort() != TSelector::kContinue) break;
+  }
+  ana->SlaveTerminate();
+  ana->storeCounters();
+
+  TFile* file = TFile::Open(outFile.c_str(), "RECREATE");
+  if(file == 0 || file->IsZombie()){
+    cerr << "ParallelDriver ERROR cannot write worker output " << outFile << endl;
+    return BAD;
+  }
+  ana->GetOutputList()->Write();
+  file->Close();
+  delete file;
+
+  return GOOD;
+}
+
+/*--------------------------------------------------------------------------------*/
+// Merge output lists
+/*--------------------------------------------------------------------------------*/
+void ParallelDriver::mergeOutput(TList* output, TList* input)
+{
+  vector<TObject*> toMove;
+  TIter next(input);
+  while(TObject* obj = next()){
+    TObject* target = output->FindObject(obj->GetName());
+    if(target == 0){
+      toMove.push_back(obj);
+      continue;
+    }
+    TMethodCall merge;
+    merge.InitWithPrototype(target->IsA(), "Merge", "TCollection*");
+    if(!merge.IsValid()){
+      cerr << "ParallelDriver WARNING cannot merge " << obj->GetName()
+           << " of class " << target->ClassName() << endl;
+      continue;
+    }
+    TList toMerge;
+    toMerge.Add(obj);
+    merge.SetParam((Long_t) &toMerge);
+    merge.Execute(target);
+  }
+
+  // Take ownership of the objects the output list didn't have yet
+  for(uint i=0; i<toMove.size(); i++){
+    input->Remove(toMove[i]);
+    output->Add(toMove[i]);
+  }
+}
+
+/*--------------------------------------------------------------------------------*/
+// Worker output file name
+/*--------------------------------------------------------------------------------*/
+string ParallelDriver::workerFileName(int iWorker) const
+{
+  stringstream name;
+  name << m_tmpDir << "/susyNtWorker_" << m_jobId << "_" << iWorker << ".root";
+  return name.str();
+}
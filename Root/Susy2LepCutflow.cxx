@@ -12,55 +12,46 @@ Susy2LepCutflow::Susy2LepCutflow() :
         m_nLepMin(2),
         m_nLepMax(2),
         m_cutNBaseLep(true),
-	m_ET(ET_Unknown)
+	m_ET(ET_Unknown),
+        m_cutflow(ET_N)
 {
   n_readin       = 0;
-  n_pass_LAr     = 0;
-  n_pass_BadJet  = 0;
-  n_pass_BadMuon = 0;
-  n_pass_Cosmic  = 0;
-
-  // The rest are channel specific.
-  for(int i=0; i<ET_N; ++i){
-    n_pass_nLep[i]    = 0;
-    n_pass_trig[i]    = 0;
-    n_pass_flavor[i]  = 0;
-    n_pass_mll[i]     = 0;
-    n_pass_ss[i]      = 0;
-    n_pass_os[i]      = 0;
-    
-    // SR1
-    n_pass_SR1jv[i]   = 0;
-    n_pass_SR1Zv[i]   = 0;
-    n_pass_SR1MET[i]  = 0;
-    
-    // SR2
-    n_pass_SR2jv[i]   = 0;
-    n_pass_SR2MET[i]  = 0;
-    
-    // SR3
-    n_pass_SR3ge2j[i] = 0;
-    n_pass_SR3Zv[i]   = 0;
-    n_pass_SR3bjv[i]  = 0;
-    n_pass_SR3mct[i]  = 0;
-    n_pass_SR3MET[i]  = 0;
-    
-    // SR4
-    n_pass_SR4jv[i]        = 0;
-    n_pass_SR4MET[i]       = 0;
-    n_pass_SR4Zv[i]        = 0;
-    n_pass_SR4L0pt[i]      = 0;
-    n_pass_SR4SUMpt[i]     = 0;
-    n_pass_SR4dPhiMETLL[i] = 0;
-    n_pass_SR4dPhiMETL1[i] = 0;
-    
-    // SR5
-    n_pass_SR5jv[i]    = 0;
-    n_pass_SR5Zv[i]    = 0;
-    n_pass_SR5MET[i]   = 0;
-    n_pass_SR5MT2[i]   = 0;
+  for(int s=0; s<NtSys_N; ++s){
+    n_pass_LAr[s]     = 0;
+    n_pass_BadJet[s]  = 0;
+    n_pass_BadMuon[s] = 0;
+    n_pass_Cosmic[s]  = 0;
+
+    // The rest are channel specific.
+    for(int i=0; i<ET_N; ++i){
+      n_pass_nLep[s][i]    = 0;
+      n_pass_trig[s][i]    = 0;
+      n_pass_flavor[s][i]  = 0;
+      n_pass_mll[s][i]     = 0;
+      n_pass_ss[s][i]      = 0;
+      n_pass_os[s][i]      = 0;
+    }
   }
 
+  // Counters are summed over workers when running in parallel,
+  // all but n_readin have a systematic axis
+  registerCounter("readin",          &n_readin);
+  registerSysCounter("pass_LAr",        n_pass_LAr);
+  registerSysCounter("pass_BadJet",     n_pass_BadJet);
+  registerSysCounter("pass_BadMuon",    n_pass_BadMuon);
+  registerSysCounter("pass_Cosmic",     n_pass_Cosmic);
+  registerSysCounter("pass_flavor",     &n_pass_flavor[0][0], ET_N);
+  registerSysCounter("pass_nLep",       &n_pass_nLep[0][0], ET_N);
+  registerSysCounter("pass_mll",        &n_pass_mll[0][0], ET_N);
+  registerSysCounter("pass_os",         &n_pass_os[0][0], ET_N);
+  registerSysCounter("pass_ss",         &n_pass_ss[0][0], ET_N);
+  registerSysCounter("pass_trig",       &n_pass_trig[0][0], ET_N);
+
+  // The signal region counters are booked with the regions
+  defineSignalRegions();
+  registerSysCounter("pass_SR",         m_cutflow.counts(), m_cutflow.nCounts());
+  registerCounter("SR_cutEvals",        m_cutflow.cutEvals(), m_cutflow.nCuts());
+
   //out.open("event.dump");
   
   setAnaType(Ana_2Lep);
@@ -87,7 +78,6 @@ Bool_t Susy2LepCutflow::Process(Long64_t entry)
   // Communicate tree entry number to SusyNtObject
   GetEntry(entry);
   clearObjects();
-  m_ET = ET_Unknown;
   n_readin++;
 
   //if(!debugEvent()) return kTRUE;
@@ -104,25 +94,32 @@ Bool_t Susy2LepCutflow::Process(Long64_t entry)
          << " event " << setw(7) << nt.evt()->event << " ****" << endl;
   }
 
-  // select signal objects
-  selectObjects();
-  //dumpBaselineObjects();
-  //dumpSignalObjects();
+  // Preselection on the summary tree, before reading the objects
+  if(rejectedBySummary()) return kTRUE;
+
+  // Run the full selection for every systematic on the same entry
+  for(uint iSys=0; iSys<m_sysList.size(); iSys++){
+    m_ET = ET_Unknown;
+
+    // select signal objects, on first access after the event cleaning cuts
+    requestObjects(m_sysList[iSys]);
+    //dumpBaselineObjects();
+    //dumpSignalObjects();
 
-  // Check Event
-  if(!selectEvent(m_signalLeptons, m_baseLeptons)) return false;
+    // Check Event
+    if(!selectEvent(m_signalLeptons, m_baseLeptons)) continue;
 
-  // Count SS and OS
-  if(sameSign(m_signalLeptons))     n_pass_ss[m_ET]++;
+    // Count SS and OS
+    if(sameSign(m_signalLeptons))     n_pass_ss[m_sys][m_ET]++;
   
-  if(oppositeSign(m_signalLeptons)) n_pass_os[m_ET]++;
+    if(oppositeSign(m_signalLeptons)) n_pass_os[m_sys][m_ET]++;
   
-  // Check Signal regions
-  passSR1(m_signalLeptons, m_signalJets, m_met);
-  passSR2(m_signalLeptons, m_signalJets, m_met);
-  passSR3(m_signalLeptons, m_signalJets, m_met);
-  passSR4(m_signalLeptons, m_signalJets, m_met);
-  passSR5(m_signalLeptons, m_signalJets, m_met);
+    // Check Signal regions
+    m_cutflow.process(m_ET, m_sys);
+    for(uint iR=0; iR<m_cutflow.nRegions(); iR++){
+      if(m_cutflow.passed(iR)) skimStage(m_cutflow.regionName(iR));
+    }
+  }
     
   return kTRUE;
 }
@@ -150,164 +147,105 @@ bool Susy2LepCutflow::selectEvent(const LeptonVector& leptons, const LeptonVecto
   //int flag = nt.evt()->evtFlag[NtSys_NOM];
   int flag = nt.evt()->cutFlags[NtSys_NOM];
 
-  if( !passLAr(flag) )              return false;
-  n_pass_LAr++;
-  if( !passBadJet(flag) )           return false;
-  n_pass_BadJet++;
-  if( !passBadMuon(flag) )          return false;
-  n_pass_BadMuon++;
-  if( !passCosmic(flag) )           return false;
-  n_pass_Cosmic++;
+  if( !passCleaning(flag, m_sys) )  return false;
+  skimStage("Cosmic");
+
+  // The cuts above only read the Event. Events without enough leptons in
+  // any systematic fail the baseline lepton cut everywhere, reject them
+  // from the kinematics table before running the object selection.
+  if(m_cutNBaseLep && maxPreLeptons() < m_nLepMin) return false;
+  ensureObjects();
   if(!passNBaseLepCut(baseLeps))    return false;
   
   // Get Event Type to continue cutflow
   m_ET = getDiLepEvtType(baseLeps);
   
   if( !passTrigger(baseLeps, m_met) )     return false;  
-  n_pass_flavor[m_ET]++;
+  n_pass_flavor[m_sys][m_ET]++;
+  skimStage("trig");
   if( !passNLepCut(leptons) )       return false;
   if( !passMll(leptons) )           return false;
+  skimStage("mll");
 
   return true;
 }
 /*--------------------------------------------------------------------------------*/
-// Signal Region 1 
-/*--------------------------------------------------------------------------------*/
-bool Susy2LepCutflow::passSR1(const LeptonVector& leptons, const JetVector& jets, const Met *met)
+bool Susy2LepCutflow::passCleaning(int flag, SusyNtSys sys)
 {
-  // Only for OS events
-  if( !oppositeSign(leptons) )           return false;  
-
-  // Jet Veto
-  if( !passJetVeto(jets) )               return false;
-  n_pass_SR1jv[m_ET]++;
-  
-  // Reject events with mll in Z window
-  if( !passZVeto(leptons))               return false;
-  n_pass_SR1Zv[m_ET]++;
-
-  // Reject if Met_rel < 100
-  if( !passMETRel(met,leptons,jets) )    return false;
-  n_pass_SR1MET[m_ET]++;
-
+  if( !passLAr(flag) )              return false;
+  n_pass_LAr[sys]++;
+  if( !passBadJet(flag) )           return false;
+  n_pass_BadJet[sys]++;
+  if( !passBadMuon(flag) )          return false;
+  n_pass_BadMuon[sys]++;
+  if( !passCosmic(flag) )           return false;
+  n_pass_Cosmic[sys]++;
   return true;
 }
 /*--------------------------------------------------------------------------------*/
-bool Susy2LepCutflow::passSR2(const LeptonVector& leptons, const JetVector& jets, const Met *met)
+// Signal regions
+/*--------------------------------------------------------------------------------*/
+void Susy2LepCutflow::defineSignalRegions()
 {
-  // Only SS
-  if( !sameSign(leptons) )               return false;
-  
-  // CHeck Jet Veto
-  if( !passJetVeto(jets) )               return false;
-  n_pass_SR2jv[m_ET]++;
-
-  // Check MET rel > 100
-  if( !passMETRel(met,leptons,jets) )    return false;
-  n_pass_SR2MET[m_ET]++;
-
-  return true;
-
+  m_cutflow.addCut("OS",        this, &Susy2LepCutflow::cutOS);
+  m_cutflow.addCut("SS",        this, &Susy2LepCutflow::cutSS);
+  m_cutflow.addCut("SF",        this, &Susy2LepCutflow::cutSF);
+  m_cutflow.addCut("JV",        this, &Susy2LepCutflow::cutJetVeto);
+  m_cutflow.addCut(">=2j",      this, &Susy2LepCutflow::cutGe2Jet);
+  m_cutflow.addCut("bV",        this, &Susy2LepCutflow::cutBJetVeto);
+  m_cutflow.addCut("ZV",        this, &Susy2LepCutflow::cutZVeto);
+  m_cutflow.addCut("mct",       this, &Susy2LepCutflow::cutTopTag);
+  m_cutflow.addCut("MET",       this, &Susy2LepCutflow::cutMetRel100);
+  m_cutflow.addCut("MET50",     this, &Susy2LepCutflow::cutMetRel50);
+  m_cutflow.addCut("MET40",     this, &Susy2LepCutflow::cutMetRel40);
+  m_cutflow.addCut("l0Pt",      this, &Susy2LepCutflow::cutL0Pt50);
+  m_cutflow.addCut("SumPt",     this, &Susy2LepCutflow::cutSumPt100);
+  m_cutflow.addCut("dPhiMetLL", this, &Susy2LepCutflow::cutDPhiMetLL);
+  m_cutflow.addCut("dPhiMetL1", this, &Susy2LepCutflow::cutDPhiMetL1);
+  m_cutflow.addCut("Mt2",       this, &Susy2LepCutflow::cutMT2_90);
+
+  // The other cuts need two signal leptons, keep these first when reordering
+  m_cutflow.setBarrier("OS");
+  m_cutflow.setBarrier("SS");
+  m_cutflow.setBarrier("SF");
+
+  // Regions starting with the same cuts share their evaluation and counts
+  m_cutflow.addRegion("SR1", "OS,JV,ZV,MET");
+  m_cutflow.addRegion("SR2", "SS,JV,MET");
+  m_cutflow.addRegion("SR3", "OS,SF,>=2j,ZV,bV,mct,MET50");
+  m_cutflow.addRegion("SR4", "OS,JV,MET40,ZV,l0Pt,SumPt,dPhiMetLL,dPhiMetL1");
+  m_cutflow.addRegion("SR5", "OS,JV,ZV,MET40,Mt2");
+  m_cutflow.book();
 }
-
 /*--------------------------------------------------------------------------------*/
-bool Susy2LepCutflow::passSR3(const LeptonVector& leptons, const JetVector& jets, const Met *met)
+// SR4 cuts, the regions using them require two leptons first
+/*--------------------------------------------------------------------------------*/
+bool Susy2LepCutflow::cutL0Pt50()
 {
-
-  // Only SFOS
-  if( !oppositeSign(leptons) )           return false;
-  if( !sameFlavor(leptons) )             return false;
-
-  // Require at least 2 jets Pt > 30
-  if( !passge2Jet(jets) )                return false;
-  n_pass_SR3ge2j[m_ET]++;
-
-  // Apply a Zveto
-  if( !passZVeto(leptons) )              return false;
-  n_pass_SR3Zv[m_ET]++;
-
-  // Apply b jet veto
-  if( !passbJetVeto(jets) )              return false;
-  n_pass_SR3bjv[m_ET]++;
-
-  // Veto top-tag events 
-  if( !passTopTag(leptons,jets,met) )    return false;
-  n_pass_SR3mct[m_ET]++;
-
-  // MetRel > 50
-  if( !passMETRel(met,leptons,jets,50) ) return false;
-  n_pass_SR3MET[m_ET]++;
-
-
-  return true;
+  // Leading lepton Pt > 50
+  return !(m_signalLeptons.at(0)->Pt() < 50);
 }
 /*--------------------------------------------------------------------------------*/
-bool Susy2LepCutflow::passSR4(const LeptonVector& leptons, const JetVector& jets, const Met *met)
+bool Susy2LepCutflow::cutSumPt100()
 {
-
-  // OS only
-  if( !oppositeSign(leptons) )           return false;
-
-  // Jet Veto
-  if( !passJetVeto(jets) )               return false;
-  n_pass_SR4jv[m_ET]++;
-
-  // MetRel > 40
-  if( !passMETRel(met,leptons,jets,40) ) return false;
-  n_pass_SR4MET[m_ET]++;
-  
-  // Z Veto
-  if( !passZVeto(leptons) )              return false;
-  n_pass_SR4Zv[m_ET]++;
-
-  // Leading lepton Pt > 50
-  float pt0 = leptons.at(0)->Pt();
-  if( pt0 < 50 )                         return false;
-  n_pass_SR4L0pt[m_ET]++;
-  
   // Sum of Pt > 100
-  float pt1 = leptons.at(1)->Pt();
-  if( pt0 + pt1 < 100 )                  return false;
-  n_pass_SR4SUMpt[m_ET]++;
-  
+  float pt0 = m_signalLeptons.at(0)->Pt();
+  float pt1 = m_signalLeptons.at(1)->Pt();
+  return !(pt0 + pt1 < 100);
+}
+/*--------------------------------------------------------------------------------*/
+bool Susy2LepCutflow::cutDPhiMetLL()
+{
   // dPhi(met, ll) > 2.5
-  TLorentzVector metlv = met->lv();
-  TLorentzVector ll = (*leptons.at(0) + *leptons.at(1));
-  if( !passdPhi(metlv, ll, 2.5) )    return false;
-  n_pass_SR4dPhiMETLL[m_ET]++;
-
-  // dPhi(met, l1) > 0.5
-  TLorentzVector l1 = *leptons.at(1);
-  if( !passdPhi(metlv, l1, 0.5) )    return false;
-  n_pass_SR4dPhiMETL1[m_ET]++;
-
-  return true;
-
+  TLorentzVector ll = (*m_signalLeptons.at(0) + *m_signalLeptons.at(1));
+  return passdPhi(m_met->lv(), ll, 2.5);
 }
 /*--------------------------------------------------------------------------------*/
-bool Susy2LepCutflow::passSR5(const LeptonVector& leptons, const JetVector& jets, const Met *met)
+bool Susy2LepCutflow::cutDPhiMetL1()
 {
-  // For OS
-  if( !oppositeSign(leptons) )          return false;  
-
-  // Check Jet Veto
-  if( !passJetVeto(jets) )              return false;
-  n_pass_SR5jv[m_ET]++;
-
-  // Check Z Veto
-  if( !passZVeto(leptons) )             return false;
-  n_pass_SR5Zv[m_ET]++;
-
-  // Check METRel > 40
-  if( !passMETRel(met,leptons,jets,40) ) return false;
-  n_pass_SR5MET[m_ET]++;
-
-  // Check MT2 > 90
-  if( !passMT2(leptons, met, 90) )      return false;
-  n_pass_SR5MT2[m_ET]++;
-  
-  return true;
-
+  // dPhi(met, l1) > 0.5
+  TLorentzVector l1 = *m_signalLeptons.at(1);
+  return passdPhi(m_met->lv(), l1, 0.5);
 }
 /*--------------------------------------------------------------------------------*/
 // Generic cuts
@@ -317,7 +255,7 @@ bool Susy2LepCutflow::passNLepCut(const LeptonVector& leptons)
   uint nLep = leptons.size();
   if(m_nLepMin>=0 && nLep < m_nLepMin) return false;
   if(m_nLepMax>=0 && nLep > m_nLepMax) return false;
-  n_pass_nLep[m_ET]++;
+  n_pass_nLep[m_sys][m_ET]++;
   return true;
 }
 /*--------------------------------------------------------------------------------*/
@@ -335,7 +273,7 @@ bool Susy2LepCutflow::passTrigger(const LeptonVector& leptons, const Met* met)
 {
   
   if(leptons.size() < 1){
-    n_pass_trig[m_ET]++;
+    n_pass_trig[m_sys][m_ET]++;
     return true;
   }
 
@@ -343,7 +281,7 @@ bool Susy2LepCutflow::passTrigger(const LeptonVector& leptons, const Met* met)
   //DataStream strm = nt.evt()->stream;
   //if( m_trigObj->passDilTrig(leptons, run, strm) ){
   if( m_trigObj->passDilTrig(leptons, met->Et, nt.evt()) ){
-    n_pass_trig[m_ET]++;
+    n_pass_trig[m_sys][m_ET]++;
     return true;
   }
   return false;
@@ -380,7 +318,7 @@ bool Susy2LepCutflow::passMll(const LeptonVector& leptons, float mll)
 {
   if( leptons.size() < 2 ) return false;
   if( (*leptons.at(0) + *leptons.at(1)).M() < mll ) return false;
-  n_pass_mll[m_ET]++;
+  n_pass_mll[m_sys][m_ET]++;
   return true;
 }
  
@@ -427,7 +365,7 @@ bool Susy2LepCutflow::passge2Jet(const JetVector& jets)
 bool Susy2LepCutflow::passZVeto(const LeptonVector& leptons, float Zlow, float Zhigh)
 {
   if( leptons.size() < 2 ) return false;
-  float mll = (*leptons.at(0) + *leptons.at(1)).M();
+  float mll = &leptons==&m_signalLeptons? sigMll() : (*leptons.at(0) + *leptons.at(1)).M();
   if( Zlow < mll && mll < Zhigh ) return false;
   return true;
 }
@@ -435,7 +373,9 @@ bool Susy2LepCutflow::passZVeto(const LeptonVector& leptons, float Zlow, float Z
 bool Susy2LepCutflow::passMETRel(const Met *met, const LeptonVector& leptons, 
 				 const JetVector& jets, float metMax){
   
-  if( getMetRel(met,leptons,jets) < metMax ) return false;
+  // The signal regions share one metRel per event
+  float metRel = isSignalSelection(leptons,jets,met)? sigMetRel() : getMetRel(met,leptons,jets);
+  if( metRel < metMax ) return false;
   return true;
 }
 /*--------------------------------------------------------------------------------*/
@@ -446,7 +386,7 @@ bool Susy2LepCutflow::passdPhi(TLorentzVector v0, TLorentzVector v1, float cut)
 /*--------------------------------------------------------------------------------*/
 bool Susy2LepCutflow::passMT2(const LeptonVector& leptons, const Met* met, float cut)
 {
-  float mT2 = getMT2(leptons, met);
+  float mT2 = (&leptons==&m_signalLeptons && met==m_met)? sigMT2() : getMT2(leptons, met);
   return (mT2 > cut);
 }
 
@@ -458,50 +398,36 @@ void Susy2LepCutflow::dumpEventCounters()
   cout << endl;
   cout << "Susy2LepCutflow event counters"    << endl;
   cout << "read in:       " << n_readin       << endl;
-  cout << "pass LAr:      " << n_pass_LAr     << endl;
-  cout << "pass BadJet:   " << n_pass_BadJet  << endl;
-  cout << "pass BadMu:    " << n_pass_BadMuon << endl;
-  cout << "pass Cosmic:   " << n_pass_Cosmic  << endl;
+  // The skipped entries are not counted by the stages below
+  if(m_useSummary) cout << "skip summary:  " << nSkippedBySummary() << endl;
 
   string v_ET[ET_N] = {"ee","mm","em","Unknown"};
-  for(int i=0; i<ET_N; ++i){
-    cout << "************************************" << endl;
-    cout << "For dilepton type: " << v_ET[i]       << endl;
+  for(uint iSys=0; iSys<m_sysList.size(); iSys++){
+    uint s = m_sysList[iSys];
+    if(m_sysList.size() > 1){
+      cout << "====================================" << endl;
+      cout << "Systematic: " << SusyNtSystNames[s]   << endl;
+    }
+    cout << "pass LAr:      " << n_pass_LAr[s]     << endl;
+    cout << "pass BadJet:   " << n_pass_BadJet[s]  << endl;
+    cout << "pass BadMu:    " << n_pass_BadMuon[s] << endl;
+    cout << "pass Cosmic:   " << n_pass_Cosmic[s]  << endl;
+
+    for(int i=0; i<ET_N; ++i){
+      cout << "************************************" << endl;
+      cout << "For dilepton type: " << v_ET[i]       << endl;
     
-    cout << "pass trig:     " << n_pass_trig[i]    << endl;
-    cout << "pass SF:       " << n_pass_flavor[i]  << endl;
-    cout << "pass nLep:     " << n_pass_nLep[i]    << endl;
-    cout << "pass mll:      " << n_pass_mll[i]     << endl;
-    cout << "pass OS:       " << n_pass_os[i]      << endl;
-    cout << "pass SS:       " << n_pass_ss[i]      << endl;
-    cout << "---------------------------------"    << endl;
-    cout << "pass SR1 JV:   " << n_pass_SR1jv[i]   << endl;
-    cout << "pass SR1 ZV:   " << n_pass_SR1Zv[i]   << endl;
-    cout << "pass SR1 MET:  " << n_pass_SR1MET[i]  << endl;
-    cout << "---------------------------------"    << endl;
-    cout << "pass SR2 JV:   " << n_pass_SR2jv[i]   << endl;
-    cout << "pass SR2 MET:  " << n_pass_SR2MET[i]  << endl;
-    cout << "---------------------------------"    << endl;
-    cout << "pass SR3 >=2j: " << n_pass_SR3ge2j[i] << endl;
-    cout << "pass SR3 ZV:   " << n_pass_SR3Zv[i]   << endl;
-    cout << "pass SR3 bV:   " << n_pass_SR3bjv[i]  << endl;
-    cout << "pass SR3 mct:  " << n_pass_SR3mct[i]  << endl;
-    cout << "pass SR3 MET:  " << n_pass_SR3MET[i]  << endl;
-    cout << "---------------------------------"    << endl;
-    cout << "pass SR4 JV:           " << n_pass_SR4jv[i]        << endl;
-    cout << "pass SR4 MET:          " << n_pass_SR4MET[i]       << endl;
-    cout << "pass SR4 ZV:           " << n_pass_SR4Zv[i]        << endl;
-    cout << "pass SR4 l0 Pt:        " << n_pass_SR4L0pt[i]      << endl;
-    cout << "pass SR4 Sum Pt:       " << n_pass_SR4SUMpt[i]     << endl;
-    cout << "pass SR4 dPhi(Met,ll): " << n_pass_SR4dPhiMETLL[i] << endl;
-    cout << "pass SR4 dPhi(Met,l1): " << n_pass_SR4dPhiMETL1[i] << endl;
-    cout << "---------------------------------"    << endl;
-    cout << "pass SR5 JV:   " << n_pass_SR5jv[i]   << endl;
-    cout << "pass SR5 ZV:   " << n_pass_SR5Zv[i]   << endl;
-    cout << "pass SR5 MET:  " << n_pass_SR5MET[i]  << endl;
-    cout << "pass SR Mt2:   " << n_pass_SR5MT2[i]  << endl;
+      cout << "pass trig:     " << n_pass_trig[s][i]    << endl;
+      cout << "pass SF:       " << n_pass_flavor[s][i]  << endl;
+      cout << "pass nLep:     " << n_pass_nLep[s][i]    << endl;
+      cout << "pass mll:      " << n_pass_mll[s][i]     << endl;
+      cout << "pass OS:       " << n_pass_os[s][i]      << endl;
+      cout << "pass SS:       " << n_pass_ss[s][i]      << endl;
+      m_cutflow.print(s, i);
+    }
   }
-
+  cout << "====================================" << endl;
+  m_cutflow.printTiming();
 }
 
 /*--------------------------------------------------------------------------------*/
@@ -31,21 +31,41 @@ Susy3LepCutflow::Susy3LepCutflow() :
         m_writeOut(false)
 {
   n_readin        = 0;
-  n_pass_hotSpot  = 0;
-  n_pass_badJet   = 0;
-  n_pass_badMuon  = 0;
-  n_pass_cosmic   = 0;
-  n_pass_feb      = 0;
-  n_pass_nLep     = 0;
-  n_pass_nTau     = 0;
-  n_pass_trig     = 0;
-  n_pass_sfos     = 0;
-  n_pass_z        = 0;
-  n_pass_met      = 0;
-  n_pass_bJet     = 0;
-  n_pass_mt       = 0;
-
-  n_evt_tot       = 0;
+  for(int s=0; s<NtSys_N; s++){
+    n_pass_hotSpot[s]  = 0;
+    n_pass_badJet[s]   = 0;
+    n_pass_badMuon[s]  = 0;
+    n_pass_cosmic[s]   = 0;
+    n_pass_feb[s]      = 0;
+    n_pass_nLep[s]     = 0;
+    n_pass_nTau[s]     = 0;
+    n_pass_trig[s]     = 0;
+    n_pass_sfos[s]     = 0;
+    n_pass_z[s]        = 0;
+    n_pass_met[s]      = 0;
+    n_pass_bJet[s]     = 0;
+    n_pass_mt[s]       = 0;
+
+    n_evt_tot[s]       = 0;
+  }
+
+  // Counters are summed over workers when running in parallel,
+  // all but n_readin have a systematic axis
+  registerCounter("readin",       &n_readin);
+  registerSysCounter("pass_hotSpot", n_pass_hotSpot);
+  registerSysCounter("pass_badJet",  n_pass_badJet);
+  registerSysCounter("pass_badMuon", n_pass_badMuon);
+  registerSysCounter("pass_cosmic",  n_pass_cosmic);
+  registerSysCounter("pass_feb",     n_pass_feb);
+  registerSysCounter("pass_nLep",    n_pass_nLep);
+  registerSysCounter("pass_nTau",    n_pass_nTau);
+  registerSysCounter("pass_trig",    n_pass_trig);
+  registerSysCounter("pass_sfos",    n_pass_sfos);
+  registerSysCounter("pass_z",       n_pass_z);
+  registerSysCounter("pass_met",     n_pass_met);
+  registerSysCounter("pass_bJet",    n_pass_bJet);
+  registerSysCounter("pass_mt",      n_pass_mt);
+  registerSysCounter("evt_tot",      n_evt_tot);
 
   setAnaType(Ana_3Lep);
 
@@ -108,63 +128,63 @@ Bool_t Susy3LepCutflow::Process(Long64_t entry)
          << " event " << setw(7) << nt.evt()->event << " ****" << endl;
   }
 
-  //
-  // Object selection
-  //
+  // Preselection on the summary tree, before reading the objects
+  if(rejectedBySummary()) return kTRUE;
 
-  SusyNtSys ntSys = NtSys_NOM;
-  bool subtractLepsFromIso = false;
-  TauID tauID = TauID_medium;
-  selectObjects(ntSys, subtractLepsFromIso, tauID);
+  // Run the full selection for every systematic on the same entry
+  for(uint iSys=0; iSys<m_sysList.size(); iSys++){
 
-  //
-  // Event selection
-  //
+    //
+    // Object selection
+    //
 
-  if(!selectEvent(m_signalLeptons, m_signalTaus, m_signalJets, m_met)) return false;
+    SusyNtSys ntSys = m_sysList[iSys];
+    bool subtractLepsFromIso = false;
+    TauID tauID = TauID_medium;
+    selectObjects(ntSys, subtractLepsFromIso, tauID);
 
-  //
-  // Event weighting
-  //
+    //
+    // Event selection
+    //
 
-  // Weight event to luminosity with cross section and pileup
-  // New approach, using MCWeighter
-  const Event* evt = nt.evt();
-  MCWeighter::WeightSys wSys = MCWeighter::Sys_NOM;
-  float w = SusyNtAna::mcWeighter().getMCWeight(evt, LUMI_A_L, wSys);
-
-  // Lepton efficiency correction
-  float lepSF = getLeptonSF(m_signalLeptons);
-  float tauSF = getTauSF(m_signalTaus);
-
-  // Apply btag efficiency correction if selecting on b-jets
-  bool applyBTagSF = m_vetoB;
-  float btagSF = applyBTagSF? bTagSF(evt, m_signalJets, evt->mcChannel) : 1;
-
-  // Full event weight
-  float fullWeight = w * lepSF * tauSF * btagSF;
-  n_evt_tot += fullWeight;
-
-  //cout << "mcSF   " << w << endl;
-  //cout << "lepSF  " << lepSF << endl;
-  //cout << "tauSF  " << tauSF << endl;
-  //cout << "btagSF " << btagSF << endl;
-  //cout << "full   " << fullWeight << endl;
-  //cout << "n_evt_tot " << n_evt_tot << endl;
-
-  //cout << "mcSF   " << w << endl;
-  //cout << "lepSF  " << lepSF << endl;
-  //cout << "tauSF  " << tauSF << endl;
-  //cout << "btagSF " << btagSF << endl;
-  //cout << "full   " << fullWeight << endl;
-  //cout << "n_evt_tot " << n_evt_tot << endl;
-
-  //
-  // Plotting
-  //
-
-  // Fill histograms
-  fillHistos(m_signalLeptons, m_signalTaus, m_signalJets, m_met, fullWeight);
+    if(!selectEvent(m_signalLeptons, m_signalTaus, m_signalJets, m_met)) continue;
+
+    //
+    // Event weighting
+    //
+
+    // Weight event to luminosity with cross section and pileup
+    // New approach, using MCWeighter
+    const Event* evt = nt.evt();
+    MCWeighter::WeightSys wSys = MCWeighter::Sys_NOM;
+    float w = SusyNtAna::mcWeighter().getMCWeight(evt, LUMI_A_L, wSys);
+
+    // Lepton efficiency correction
+    float lepSF = getLeptonSF(m_signalLeptons);
+    float tauSF = getTauSF(m_signalTaus);
+
+    // Apply btag efficiency correction if selecting on b-jets
+    bool applyBTagSF = m_vetoB;
+    float btagSF = applyBTagSF? bTagSF(evt, m_signalJets, evt->mcChannel) : 1;
+
+    // Full event weight
+    float fullWeight = w * lepSF * tauSF * btagSF;
+    n_evt_tot[m_sys] += fullWeight;
+
+    //cout << "mcSF   " << w << endl;
+    //cout << "lepSF  " << lepSF << endl;
+    //cout << "tauSF  " << tauSF << endl;
+    //cout << "btagSF " << btagSF << endl;
+    //cout << "full   " << fullWeight << endl;
+    //cout << "n_evt_tot " << n_evt_tot[m_sys] << endl;
+
+    //
+    // Plotting
+    //
+
+    // Fill histograms
+    fillHistos(m_signalLeptons, m_signalTaus, m_signalJets, m_met, fullWeight);
+  }
 
   return kTRUE;
 }
@@ -204,40 +224,51 @@ bool Susy3LepCutflow::selectEvent(const LeptonVector& leptons, const TauVector&
   int flag = cleaningCutFlags();
 
   // Cleaning cuts
-  if(!passHotSpot(flag)) return false;
-  n_pass_hotSpot++;
-  if(!passBadJet(flag)) return false;
-  n_pass_badJet++;
-  if(!passBadMuon(flag)) return false;
-  n_pass_badMuon++;
-  if(!passCosmic(flag)) return false;
-  n_pass_cosmic++;
+  if(!passCleaning(flag, m_sys)) return false;
+  skimStage("cosmic");
   if(!passDeadRegions(m_preJets, met, evt->run, evt->isMC)) return false;
-  n_pass_feb++;
+  n_pass_feb[m_sys]++;
   if(!passNLepCut(leptons)) return false;
-  n_pass_nLep++;
+  n_pass_nLep[m_sys]++;
+  skimStage("nLep");
   if(!passNTauCut(taus)) return false;
-  n_pass_nTau++;
+  n_pass_nTau[m_sys]++;
+  skimStage("nTau");
   if(!passTrigger(leptons)) return false;
-  n_pass_trig++;
+  n_pass_trig[m_sys]++;
+  skimStage("trig");
   if(!passSFOSCut(leptons)) return false;
-  n_pass_sfos++;
+  n_pass_sfos[m_sys]++;
   if(!passZCut(leptons)) return false;
-  n_pass_z++;
+  n_pass_z[m_sys]++;
   if(!passMetCut(met)) return false;
-  n_pass_met++;
+  n_pass_met[m_sys]++;
   if(!passBJetCut()) return false;
-  n_pass_bJet++;
+  n_pass_bJet[m_sys]++;
   if(!passMtCut(leptons, met)) return false;
-  n_pass_mt++;
+  n_pass_mt[m_sys]++;
+  skimStage("mt");
 
-  if(m_writeOut){
+  if(m_writeOut && m_sys==NtSys_NOM){
     out << nt.evt()->run << " " << nt.evt()->event << endl;
   }
 
   return true;
 }
 
+/*--------------------------------------------------------------------------------*/
+bool Susy3LepCutflow::passCleaning(int flag, SusyNtSys sys)
+{
+  if(!passHotSpot(flag)) return false;
+  n_pass_hotSpot[sys]++;
+  if(!passBadJet(flag)) return false;
+  n_pass_badJet[sys]++;
+  if(!passBadMuon(flag)) return false;
+  n_pass_badMuon[sys]++;
+  if(!passCosmic(flag)) return false;
+  n_pass_cosmic[sys]++;
+  return true;
+}
 /*--------------------------------------------------------------------------------*/
 // Fill histograms
 /*--------------------------------------------------------------------------------*/
@@ -368,20 +399,33 @@ void Susy3LepCutflow::dumpEventCounters()
   cout << endl;
   cout << "Susy3LepCutflow event counters"    << endl;
   cout << "read in     :  " << n_readin        << endl;
-  cout << "pass HotSpot:  " << n_pass_hotSpot  << endl;
-  cout << "pass BadJet :  " << n_pass_badJet   << endl;
-  cout << "pass BadMu  :  " << n_pass_badMuon  << endl;
-  cout << "pass Cosmic :  " << n_pass_cosmic   << endl;
-  cout << "pass nLep   :  " << n_pass_nLep     << endl;
-  cout << "pass trig   :  " << n_pass_trig     << endl;
-  cout << "pass sfos   :  " << n_pass_sfos     << endl;
-  cout << "pass z      :  " << n_pass_z        << endl;
-  cout << "pass met    :  " << n_pass_met      << endl;
-  cout << "pass b-jet  :  " << n_pass_bJet     << endl;
-  cout << "pass mt     :  " << n_pass_mt       << endl;
+  // The skipped entries are not counted by the stages below
+  if(m_useSummary) cout << "skip summary:  " << nSkippedBySummary() << endl;
+  for(uint iSys=0; iSys<m_sysList.size(); iSys++){
+    uint s = m_sysList[iSys];
+    if(m_sysList.size() > 1){
+      cout << "------------------------------" << endl;
+      cout << "Systematic  :  " << SusyNtSystNames[s] << endl;
+    }
+    cout << "pass HotSpot:  " << n_pass_hotSpot[s]  << endl;
+    cout << "pass BadJet :  " << n_pass_badJet[s]   << endl;
+    cout << "pass BadMu  :  " << n_pass_badMuon[s]  << endl;
+    cout << "pass Cosmic :  " << n_pass_cosmic[s]   << endl;
+    cout << "pass nLep   :  " << n_pass_nLep[s]     << endl;
+    cout << "pass trig   :  " << n_pass_trig[s]     << endl;
+    cout << "pass sfos   :  " << n_pass_sfos[s]     << endl;
+    cout << "pass z      :  " << n_pass_z[s]        << endl;
+    cout << "pass met    :  " << n_pass_met[s]      << endl;
+    cout << "pass b-jet  :  " << n_pass_bJet[s]     << endl;
+    cout << "pass mt     :  " << n_pass_mt[s]       << endl;
+  }
   cout << endl;
   cout << "Weighted event yields"              << endl;
-  cout << "A-L (20/fb) :  " << n_evt_tot       << endl;
+  for(uint iSys=0; iSys<m_sysList.size(); iSys++){
+    uint s = m_sysList[iSys];
+    if(m_sysList.size() > 1) cout << "  " << SusyNtSystNames[s] << endl;
+    cout << "A-L (20/fb) :  " << n_evt_tot[s]       << endl;
+  }
 }
 
 /*--------------------------------------------------------------------------------*/
@@ -91,6 +91,44 @@ bool findLepton(const Lepton* lep, const LeptonVector& leptons) {
   return std::find(leptons.begin(), leptons.end(), lep) != leptons.end(); 
 }
 
+/*--------------------------------------------------------------------------------*/
+// Systematics which shift the object kinematics
+/*--------------------------------------------------------------------------------*/
+bool isElectronSys(int sys)
+{
+  return sys >= NtSys_EES_Z_UP && sys <= NtSys_EER_DN;
+}
+/*--------------------------------------------------------------------------------*/
+bool isMuonSys(int sys)
+{
+  return sys >= NtSys_MS_UP && sys <= NtSys_ID_DN;
+}
+/*--------------------------------------------------------------------------------*/
+bool isTauSys(int sys)
+{
+  return sys == NtSys_TES_UP || sys == NtSys_TES_DN;
+}
+/*--------------------------------------------------------------------------------*/
+bool isJetSys(int sys)
+{
+  return sys == NtSys_JES_UP || sys == NtSys_JES_DN || sys == NtSys_JER;
+}
+/*--------------------------------------------------------------------------------*/
+uint sysDependencies(int sys)
+{
+  if(sys == NtSys_NOM) return 0;
+  // The met is recomputed for every object systematic
+  if(isElectronSys(sys)) return SysDep_Ele | SysDep_Met;
+  if(isMuonSys(sys))     return SysDep_Muo | SysDep_Met;
+  if(isTauSys(sys))      return SysDep_Tau | SysDep_Met;
+  if(isJetSys(sys))      return SysDep_Jet | SysDep_Met;
+  if(sys == NtSys_SCALEST_UP || sys == NtSys_SCALEST_DN || sys == NtSys_RESOST) return SysDep_Met;
+  if(sys >= NtSys_TRIGSF_EL_UP && sys <= NtSys_TRIGSF_MU_DN) return SysDep_Weight;
+  if(sys == NtSys_JVF_UP || sys == NtSys_JVF_DN) return SysDep_JetSel;
+  // Unknown, assume everything changes
+  return SysDep_Ele | SysDep_Muo | SysDep_Tau | SysDep_Jet | SysDep_JetSel | SysDep_Met | SysDep_Weight;
+}
+
 /*--------------------------------------------------------------------------------*/
 // Trigger chain names
 /*--------------------------------------------------------------------------------*/
@@ -20,6 +20,23 @@ void Event::print() const
        << " w " << w << endl;
 }
 
+/*--------------------------------------------------------------------------------*/
+// Delta encoding of the systematic cut flags
+/*--------------------------------------------------------------------------------*/
+void Event::packCutFlags()
+{
+  if(cutFlagsDelta) return;
+  for(int s=0; s<NtSys_N; s++) if(s != NtSys_NOM) cutFlags[s] ^= cutFlags[NtSys_NOM];
+  cutFlagsDelta = true;
+}
+/*--------------------------------------------------------------------------------*/
+void Event::unpackCutFlags()
+{
+  if(!cutFlagsDelta) return;
+  for(int s=0; s<NtSys_N; s++) if(s != NtSys_NOM) cutFlags[s] ^= cutFlags[NtSys_NOM];
+  cutFlagsDelta = false;
+}
+
 
 /*--------------------------------------------------------------------------------*/
 // Copy constructor
@@ -167,26 +184,30 @@ Electron& Electron::operator=(const Electron &rhs)
 /*--------------------------------------------------------------------------------*/
 // Electron Set State
 /*--------------------------------------------------------------------------------*/
+float Electron::sysScale(int sys) const
+{
+  //if     ( sys == NtSys_EES_UP ) return ees_up;
+  //else if( sys == NtSys_EES_DN ) return ees_dn;
+  if     ( sys == NtSys_EES_Z_UP   ) return ees_z_up;
+  else if( sys == NtSys_EES_Z_DN   ) return ees_z_dn;
+  else if( sys == NtSys_EES_MAT_UP ) return ees_mat_up;
+  else if( sys == NtSys_EES_MAT_DN ) return ees_mat_dn;
+  else if( sys == NtSys_EES_PS_UP  ) return ees_ps_up;
+  else if( sys == NtSys_EES_PS_DN  ) return ees_ps_dn;
+  else if( sys == NtSys_EES_LOW_UP ) return ees_low_up;
+  else if( sys == NtSys_EES_LOW_DN ) return ees_low_dn;
+  else if( sys == NtSys_EER_UP     ) return eer_up;
+  else if( sys == NtSys_EER_DN     ) return eer_dn;
+  return 1;
+}
+/*--------------------------------------------------------------------------------*/
 void Electron::setState(int sys)
 {
   resetTLV();
   if(sys == NtSys_NOM) return;
+  if(!isElectronSys(sys)) return;
   
-  float sf = 0;
-  //if     ( sys == NtSys_EES_UP ) sf = ees_up;
-  //else if( sys == NtSys_EES_DN ) sf = ees_dn;
-  if     ( sys == NtSys_EES_Z_UP   ) sf = ees_z_up;
-  else if( sys == NtSys_EES_Z_DN   ) sf = ees_z_dn;
-  else if( sys == NtSys_EES_MAT_UP ) sf = ees_mat_up;
-  else if( sys == NtSys_EES_MAT_DN ) sf = ees_mat_dn;
-  else if( sys == NtSys_EES_PS_UP  ) sf = ees_ps_up;
-  else if( sys == NtSys_EES_PS_DN  ) sf = ees_ps_dn;
-  else if( sys == NtSys_EES_LOW_UP ) sf = ees_low_up;
-  else if( sys == NtSys_EES_LOW_DN ) sf = ees_low_dn;
-  else if( sys == NtSys_EER_UP     ) sf = eer_up;
-  else if( sys == NtSys_EER_DN     ) sf = eer_dn;
-  else return;
-
+  float sf = sysScale(sys);
   this->SetPtEtaPhiE(sf * this->Pt(), this->Eta(), this->Phi(), sf * this->E());
 }
 /*--------------------------------------------------------------------------------*/
@@ -276,21 +297,27 @@ Muon& Muon::operator=(const Muon &rhs)
 /*--------------------------------------------------------------------------------*/
 // Muon Set State
 /*--------------------------------------------------------------------------------*/
-void Muon::setState(int sys, bool isTag0150)
+float Muon::sysScale(int sys, bool isTag0150) const
 {
-  resetTLV();
-  if(sys == NtSys_NOM) return;
-  
-  float sf = 0;
+  float sf = 1;
   if     ( sys == NtSys_MS_UP ) sf = ms_up;
   else if( sys == NtSys_MS_DN ) sf = ms_dn;
   else if( sys == NtSys_ID_UP ) sf = id_up;
   else if( sys == NtSys_ID_DN ) sf = id_dn;
-  else return;
+  else return sf;
 
   // Bugfix for SusyNt tag n0150
   if(isTag0150) sf *= 1000.;
-
+  return sf;
+}
+/*--------------------------------------------------------------------------------*/
+void Muon::setState(int sys, bool isTag0150)
+{
+  resetTLV();
+  if(sys == NtSys_NOM) return;
+  if(!isMuonSys(sys)) return;
+  
+  float sf = sysScale(sys, isTag0150);
   this->SetPtEtaPhiE(sf * this->Pt(), this->Eta(), this->Phi(), sf * this->E());
 }
 /*--------------------------------------------------------------------------------*/
@@ -399,16 +426,20 @@ Tau& Tau::operator=(const Tau &rhs)
 /*--------------------------------------------------------------------------------*/
 // Tau Set State
 /*--------------------------------------------------------------------------------*/
+float Tau::sysScale(int sys) const
+{
+  if     ( sys == NtSys_TES_UP ) return tes_up;
+  else if( sys == NtSys_TES_DN ) return tes_dn;
+  return 1;
+}
+/*--------------------------------------------------------------------------------*/
 void Tau::setState(int sys)
 {
   resetTLV();
   if(sys == NtSys_NOM) return;
+  if(!isTauSys(sys)) return;
   
-  float sf = 0;
-  if     ( sys == NtSys_TES_UP ) sf = tes_up;
-  else if( sys == NtSys_TES_DN ) sf = tes_dn;
-  else return;
-
+  float sf = sysScale(sys);
   this->SetPtEtaPhiE(sf * this->Pt(), this->Eta(), this->Phi(), sf * this->E());
 }
 /*--------------------------------------------------------------------------------*/
@@ -519,17 +550,21 @@ Jet& Jet::operator=(const Jet &rhs)
 /*--------------------------------------------------------------------------------*/
 // Jet Set State
 /*--------------------------------------------------------------------------------*/
+float Jet::sysScale(int sys) const
+{
+  if     ( sys == NtSys_JER    ) return jer;
+  else if( sys == NtSys_JES_UP ) return jes_up;
+  else if( sys == NtSys_JES_DN ) return jes_dn;
+  return 1;
+}
+/*--------------------------------------------------------------------------------*/
 void Jet::setState(int sys)
 {
   resetTLV();
   if(sys == NtSys_NOM) return;
+  if(!isJetSys(sys)) return;
   
-  float sf = 0;
-  if     ( sys == NtSys_JER    ) sf = jer;
-  else if( sys == NtSys_JES_UP ) sf = jes_up;
-  else if( sys == NtSys_JES_DN ) sf = jes_dn;
-  else return;
-  
+  float sf = sysScale(sys);
   this->SetPtEtaPhiE(sf * this->Pt(), this->Eta(), this->Phi(), sf * this->E());
 }
 /*--------------------------------------------------------------------------------*/
@@ -1,10 +1,30 @@
+#include <algorithm>
 #include <iomanip>
 #include "TFile.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TSystem.h"
+#include "TEnv.h"
+#include "TChain.h"
+#include "TChainElement.h"
+#include "TEntryList.h"
+#include "TNamed.h"
 #include "SusyNtuple/SusyNtAna.h"
+#include "SusyNtuple/SusyNtSkimWriter.h"
+#include "SusyNtuple/SusyNtColumnCache.h"
+#include "SusyNtuple/FilePrefetcher.h"
+#include "SusyNtuple/D3PDPerfStats.h"
+#include "SusyNtuple/Utils.h"
 
 using namespace std;
 using namespace Susy;
 
+namespace
+{
+  // TTreeCache size when prefetching or unzipping without a cache profile
+  const Long64_t DefaultCacheSize = 30000000;
+}
+
 /*--------------------------------------------------------------------------------*/
 // SusyNtAna Constructor
 /*--------------------------------------------------------------------------------*/
@@ -16,10 +36,42 @@ SusyNtAna::SusyNtAna() :
         m_printFreq(50000),
         m_dbg(0),
         m_dbgEvt(false),
-        m_duplicate(false)
+        m_duplicate(false),
+        m_sys(NtSys_NOM),
+        m_reuseNominal(true),
+        m_varGeneration(1),
+        m_disableUnusedBranches(false),
+        m_prefetch(false),
+        m_prefetcher(0),
+        m_parallelUnzip(false),
+        m_readPerfStats(false),
+        m_batchSize(0),
+        m_useSummary(false),
+        m_summaryFile(0),
+        m_summaryTree(0),
+        m_prunedEntries(0),
+        m_zone(0),
+        m_sumwBuilt(false),
+        m_skimWriter(0),
+        m_skimmed(-1),
+        m_columnCache(0)
 {
+  m_nominal.valid = false;
+  m_request.pending = false;
+  m_summaryCounts[0] = m_summaryCounts[1] = m_summaryCounts[2] = 0;
+  for(int v=0; v<EV_N; v++) m_varCache[v].generation = 0;
+  m_sysList.push_back(NtSys_NOM);
 }
 
+/*--------------------------------------------------------------------------------*/
+SusyNtAna::~SusyNtAna()
+{
+  delete m_prefetcher;
+  closeSummary();
+  delete m_skimWriter;
+  nt.ReadFromCache(0);
+  delete m_columnCache;
+}
 /*--------------------------------------------------------------------------------*/
 // Attach tree (normally a TChain)
 /*--------------------------------------------------------------------------------*/
@@ -28,7 +80,89 @@ void SusyNtAna::Init(TTree* tree)
   if(m_dbg) cout << "SusyNtAna::Init" << endl;
   m_tree = tree;
   nt.ReadFrom(tree);
-  m_mcWeighter.buildSumwMap(tree);
+  if(!m_sumwBuilt) m_mcWeighter.buildSumwMap(tree);
+
+  // The TTreeCache of each file fetches the next cluster on a ROOT helper
+  // thread. Must be set before the caches are created.
+  if(m_prefetch) gEnv->SetValue("TFile.AsyncPrefetching", 1);
+  // Same for the unzipping cache, the cache type is picked when it is created
+  if(m_parallelUnzip) tree->SetParallelUnzip(kTRUE);
+  if(!m_cacheProfile.empty()) applyCacheProfile(tree);
+  if((m_prefetch || m_parallelUnzip) && tree->GetCacheSize() <= 0) tree->SetCacheSize(DefaultCacheSize);
+
+  if(m_readPerfStats){
+    D3PDReader::D3PDPerfStats::Instance()->NewTreeAccessed(tree);
+    D3PDReader::D3PDPerfStats::Instance()->Start();
+  }
+
+  // Each process maps the cache, the pages are shared between them
+  if(!m_columnCacheFile.empty() && m_columnCache == 0){
+    m_columnCache = new SusyNtColumnCache();
+    if(!m_columnCache->open(m_columnCacheFile)){
+      cout << "SusyNtAna::Init WARNING column cache not used, reading the tree" << endl;
+      delete m_columnCache;
+      m_columnCache = 0;
+    }
+  }
+  nt.ReadFromCache(m_columnCache);
+
+  // Each process writes its own part of the skim, merged by Terminate
+  if(!m_skimFile.empty() && m_skimWriter == 0){
+    m_skimWriter = new SusyNtSkimWriter();
+    m_skimWriter->open(Form("%s.part%d", m_skimFile.c_str(), gSystem->GetPid()), m_skimBranches);
+  }
+}
+/*--------------------------------------------------------------------------------*/
+// Read a batch of entries, stopping at the end of the current tree
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::readBatch(Long64_t entry)
+{
+  TTree* tree = m_tree->GetTree();
+  Long64_t n = std::min<Long64_t>(m_batchSize, tree->GetEntries() - entry);
+  nt.ReadBatch(entry, n);
+}
+/*--------------------------------------------------------------------------------*/
+// New file in the chain
+/*--------------------------------------------------------------------------------*/
+Bool_t SusyNtAna::Notify()
+{
+  // The statistics only count the reads of the current file
+  if(m_readPerfStats && m_tree) D3PDReader::D3PDPerfStats::Instance()->NewTreeAccessed(m_tree);
+  // The batch entries belong to the previous tree
+  if(m_batchSize) nt.ClearBatch();
+  if(m_useSummary) openSummary();
+  if(m_columnCache) setCacheSource();
+  m_skimmed = -1;
+
+  if(m_prefetch && m_tree && m_tree->InheritsFrom(TChain::Class())){
+    // Warm up the file after the current one
+    TChain* chain = (TChain*) m_tree;
+    TChainElement* next = (TChainElement*) chain->GetListOfFiles()->At(chain->GetTreeNumber() + 1);
+    if(next){
+      if(m_prefetcher == 0) m_prefetcher = new FilePrefetcher();
+      m_prefetcher->prefetch(next->GetTitle());
+      if(m_dbg) cout << "SusyNtAna::Notify - prefetching " << next->GetTitle() << endl;
+    }
+  }
+  return kTRUE;
+}
+
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::setCacheSource()
+{
+  TTree* tree = m_tree? m_tree->GetTree() : 0;
+  if(tree == 0 || tree->GetCurrentFile() == 0) return;
+  // The cache knows the files by their name in the chain
+  string fileName = tree->GetCurrentFile()->GetName();
+  if(m_tree->InheritsFrom(TChain::Class())){
+    TChain* chain = (TChain*) m_tree;
+    TObject* element = chain->GetListOfFiles()->At(chain->GetTreeNumber());
+    if(element) fileName = element->GetTitle();
+  }
+  if(nt.SetCacheSource(fileName, tree->GetEntries())){
+    if(m_dbg) cout << "SusyNtAna::Notify - reading " << fileName << " from the column cache" << endl;
+  }
+  else cout << "SusyNtAna::Notify - " << fileName << " not in the column cache, reading the tree" << endl;
 }
 
 /*--------------------------------------------------------------------------------*/
@@ -36,12 +170,22 @@ void SusyNtAna::Init(TTree* tree)
 // When running with PROOF Begin() is only called on the client.
 // The tree argument is deprecated (on PROOF 0 is passed).
 /*--------------------------------------------------------------------------------*/
-void SusyNtAna::Begin(TTree* /*tree*/)
+void SusyNtAna::Begin(TTree* tree)
 {
   if(m_dbg) cout << "SusyNtAna::Begin" << endl;
 
   m_chainEntry = -1;
 
+  // The skim gets the normalization of every input, processed or not.
+  // Already set by pruneChain, including the pruned files.
+  if(m_skimInputs.empty() && tree){
+    if(tree->InheritsFrom(TChain::Class())){
+      TIter next(((TChain*) tree)->GetListOfFiles());
+      while(TChainElement* element = (TChainElement*) next()) m_skimInputs.push_back(element->GetTitle());
+    }
+    else if(tree->GetCurrentFile()) m_skimInputs.push_back(tree->GetCurrentFile()->GetName());
+  }
+
   // Start the timer
   m_timer.Start();
 
@@ -96,6 +240,23 @@ Bool_t SusyNtAna::Process(Long64_t entry)
   return kTRUE;
 }
 
+/*--------------------------------------------------------------------------------*/
+// The SlaveTerminate() function is called after all the entries of this
+// process have been processed.
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::SlaveTerminate()
+{
+  if(m_skimWriter){
+    m_skimWriter->close();
+    // The part is merged by Terminate, in the parent when running in parallel
+    string name = Form("skimPart_%d", gSystem->GetPid());
+    GetOutputList()->Add(new TNamed(name.c_str(), m_skimWriter->fileName().c_str()));
+    cout << "SusyNtAna::SlaveTerminate - " << m_skimWriter->nWritten() << " entries skimmed" << endl;
+    delete m_skimWriter;
+    m_skimWriter = 0;
+  }
+}
+
 /*--------------------------------------------------------------------------------*/
 // The Terminate() function is the last function to be called during
 // a query. It always runs on the client, it can be used to present
@@ -108,6 +269,20 @@ void SusyNtAna::Terminate()
   // Stop the timer
   m_timer.Stop();
   dumpTimer();
+  if(m_prefetcher) m_prefetcher->stop();
+
+  if(!m_cacheProfile.empty()) saveCacheProfile();
+  if(m_readPerfStats) dumpReadPerfStats();
+
+  if(!m_skimFile.empty()) mergeSkim();
+
+  closeSummary();
+  if(m_useSummary){
+    // The zones dropped by pruneChain were not processed, they only count here
+    cout << "Summary preselection skipped " << m_summaryCounts[1] + m_prunedEntries << " of "
+         << m_summaryCounts[0] + m_prunedEntries << " entries, "
+         << m_summaryCounts[2] + m_prunedEntries << " on the zone map" << endl;
+  }
 }
 
 /*--------------------------------------------------------------------------------*/
@@ -200,6 +375,14 @@ void SusyNtAna::clearObjects()
   m_mediumTaus.clear();
   m_tightTaus.clear();
   m_met = NULL;
+  m_request.pending = false;
+  clearIsolationContext();
+
+  // Forget the cached event variables, each selection computes them again
+  if(++m_varGeneration == 0){
+    for(int v=0; v<EV_N; v++) m_varCache[v].generation = 0;
+    m_varGeneration = 1;
+  }
 }
 /*--------------------------------------------------------------------------------*/
 // Select baseline and signal leptons
@@ -209,20 +392,35 @@ void SusyNtAna::selectObjects(SusyNtSys sys, bool removeLepsFromIso,
 {
   // Empty the object vectors
   clearObjects();
+  m_sys = sys;
+
+  // The kinematics table is built once per entry and shared by all systematics
+  fillView(n0150BugFix);
+  m_view.fillScales(sys);
 
-  // Get the Baseline objets
-  getBaselineObjects(&nt, m_preElectrons, m_preMuons, m_preJets, 
-                     m_baseElectrons, m_baseMuons, m_baseTaus, m_baseJets, 
-                     sys, m_selectTaus, n0150BugFix);
-
-  // Now grab Signal objects
-  // New signal tau prescription, fill both ID levels at once
-  getSignalObjects(m_baseElectrons, m_baseMuons, m_baseTaus, m_baseJets,
-                   m_signalElectrons, m_signalMuons, 
-                   m_mediumTaus, m_tightTaus, 
-                   m_signalJets, m_signalJets2Lep, 
-                   nt.evt()->nVtx, nt.evt()->isMC, 
-                   removeLepsFromIso, sys);
+  bool reuseNominal = m_reuseNominal && m_nominal.valid && sys != NtSys_NOM &&
+                      m_nominal.removeLepsFromIso == removeLepsFromIso &&
+                      m_nominal.selectTaus == m_selectTaus;
+  if(reuseNominal){
+    selectObjectsFromNominal(sys, removeLepsFromIso);
+  }
+  else{
+    // Get the Baseline objets
+    getBaselineObjects(&nt, m_view, m_preElectrons, m_preMuons, m_preTaus, m_preJets, 
+                       m_baseElectrons, m_baseMuons, m_baseTaus, m_baseJets, 
+                       sys, m_selectTaus);
+
+    // Now grab Signal objects
+    // New signal tau prescription, fill both ID levels at once
+    getSignalObjects(m_view, m_baseElectrons, m_baseMuons, m_baseTaus, m_baseJets,
+                     m_signalElectrons, m_signalMuons, 
+                     m_mediumTaus, m_tightTaus, 
+                     m_signalJets, m_signalJets2Lep, 
+                     nt.evt()->nVtx, nt.evt()->isMC, 
+                     removeLepsFromIso, sys);
+
+    if(sys == NtSys_NOM) storeNominal(removeLepsFromIso);
+  }
   m_signalTaus = signalTauID==TauID_tight? m_tightTaus : m_mediumTaus;
 
   // Grab met
@@ -240,11 +438,526 @@ void SusyNtAna::selectObjects(SusyNtSys sys, bool removeLepsFromIso,
   std::sort(m_signalJets.begin(), m_signalJets.end(), comparePt);
   std::sort(m_signalJets2Lep.begin(), m_signalJets2Lep.end(), comparePt);
 }
+/*--------------------------------------------------------------------------------*/
+// Object selection on first access
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::requestObjects(SusyNtSys sys, bool removeLepsFromIso,
+                               TauID signalTauID, bool n0150BugFix)
+{
+  clearObjects();
+  m_sys = sys;
+  m_request.pending = true;
+  m_request.sys = sys;
+  m_request.removeLepsFromIso = removeLepsFromIso;
+  m_request.signalTauID = signalTauID;
+  m_request.n0150BugFix = n0150BugFix;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::selectRequestedObjects()
+{
+  ObjectRequest request = m_request;
+  selectObjects(request.sys, request.removeLepsFromIso, request.signalTauID, request.n0150BugFix);
+}
+/*--------------------------------------------------------------------------------*/
+// Cached event variables
+/*--------------------------------------------------------------------------------*/
+float SusyNtAna::cachedVar(EventVar var)
+{
+  ensureObjects();
+  CachedVar& c = m_varCache[var];
+  if(c.generation != m_varGeneration){
+    c.value = computeVar(var);
+    c.generation = m_varGeneration;
+  }
+  return c.value;
+}
+/*--------------------------------------------------------------------------------*/
+float SusyNtAna::computeVar(EventVar var)
+{
+  const LeptonVector& leps = m_signalLeptons;
+  const JetVector& jets = m_signalJets;
+  switch(var){
+    case EV_Mll:    return leps.size() < 2? -999 : Mll(leps[0], leps[1]);
+    case EV_MetRel: return getMetRel(m_met, leps, jets);
+    case EV_MT2:    return getMT2(leps, m_met);
+    case EV_Meff:   return Meff(leps, jets, m_met);
+    case EV_HT:     return getHT(jets);
+    case EV_Mljj:   return mljj(leps, jets);
+    case EV_TopTag: return passTopTag(leps, jets, m_met)? 1 : 0;
+    default:
+      cout << "SusyNtAna::computeVar - unknown variable " << var << endl;
+      return -999;
+  }
+}
+/*--------------------------------------------------------------------------------*/
+float SusyNtAna::sigMll()     { return cachedVar(EV_Mll); }
+float SusyNtAna::sigMetRel()  { return cachedVar(EV_MetRel); }
+float SusyNtAna::sigMT2()     { return cachedVar(EV_MT2); }
+float SusyNtAna::sigMeff()    { return cachedVar(EV_Meff); }
+float SusyNtAna::sigHT()      { return cachedVar(EV_HT); }
+float SusyNtAna::sigMljj()    { return cachedVar(EV_Mljj); }
+bool  SusyNtAna::sigTopTag()  { return cachedVar(EV_TopTag) > 0; }
+
+/*--------------------------------------------------------------------------------*/
+// Preselection on the event summary
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::setUseSummary(bool useSummary)
+{
+  m_useSummary = useSummary;
+  // Counts are [checked, rejected, rejected by zone], merged over the workers
+  for(uint iC=0; iC<m_counters.size(); iC++) if(m_counters[iC].uCounts == m_summaryCounts) return;
+  if(m_useSummary) registerCounter("summary", m_summaryCounts, 3);
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtAna::rejectedBySummary()
+{
+  if(!m_useSummary || m_summaryTree == 0) return false;
+  // Whole cluster rejected, no need to read the summary entry
+  if(rejectedByZone(m_entry)){
+    m_summaryCounts[0]++;
+    m_summaryCounts[1]++;
+    m_summaryCounts[2]++;
+    return true;
+  }
+  m_summaryTree->GetEntry(m_entry);
+  if(m_dbg && m_summary.event != nt.evt()->event){
+    cout << "SusyNtAna::rejectedBySummary ERROR summary of event " << m_summary.event
+         << " for event " << nt.evt()->event << endl;
+  }
+  m_summaryCounts[0]++;
+  if(passSummary(m_summary)) return false;
+  m_summaryCounts[1]++;
+  return true;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::openSummary()
+{
+  closeSummary();
+  TFile* inFile = m_tree? m_tree->GetCurrentFile() : 0;
+  if(inFile == 0) return;
+
+  string name = SusyNtSummary::fileName(inFile->GetName());
+  // AccessPathName is true when the file does not exist
+  if(gSystem->AccessPathName(name.c_str())){
+    cout << "SusyNtAna::openSummary WARNING no summary " << name << ", processing all entries" << endl;
+    return;
+  }
+  m_summaryFile = TFile::Open(name.c_str());
+  TTree* tree = m_summaryFile? (TTree*) m_summaryFile->Get(SusyNtSummary::treeName()) : 0;
+  if(tree == 0 || tree->GetEntries() != m_tree->GetTree()->GetEntries()){
+    cout << "SusyNtAna::openSummary ERROR " << name << " does not match " << inFile->GetName()
+         << ", processing all entries" << endl;
+    closeSummary();
+    return;
+  }
+  m_summary.readFrom(tree);
+  m_summaryTree = tree;
+
+  // Older summary files have no zone map, then every entry is checked
+  SusyNtZone::readZones(m_summaryFile, m_zones);
+  for(uint i=0; i<m_zones.size(); i++) m_zonePass.push_back(passZone(m_zones[i].max));
+  if(m_dbg){
+    uint nPass = std::count(m_zonePass.begin(), m_zonePass.end(), true);
+    cout << "SusyNtAna::openSummary - " << nPass << " of " << m_zones.size() << " zones pass" << endl;
+  }
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtAna::rejectedByZone(Long64_t entry)
+{
+  if(m_zones.empty()) return false;
+  // The entries mostly come in order, start from the last zone
+  if(m_zone >= m_zones.size() || !m_zones[m_zone].contains(entry)){
+    if(m_zone + 1 < m_zones.size() && m_zones[m_zone + 1].contains(entry)) m_zone++;
+    else{
+      m_zone = 0;
+      while(m_zone < m_zones.size() && !m_zones[m_zone].contains(entry)) m_zone++;
+      if(m_zone == m_zones.size()) return false;
+    }
+  }
+  return !m_zonePass[m_zone];
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::closeSummary()
+{
+  // The tree belongs to the file
+  m_summaryTree = 0;
+  if(m_summaryFile) m_summaryFile->Close();
+  delete m_summaryFile;
+  m_summaryFile = 0;
+  m_zones.clear();
+  m_zonePass.clear();
+  m_zone = 0;
+}
+/*--------------------------------------------------------------------------------*/
+TChain* SusyNtAna::pruneChain(TChain* chain)
+{
+  // The sumw of a dataset is summed over all its files, pruned or not
+  m_mcWeighter.buildSumwMap(chain);
+  m_sumwBuilt = true;
+
+  // Entries of each file, from the tree offsets
+  chain->GetEntries();
+  const Long64_t* treeOffsets = chain->GetTreeOffset();
+
+  TChain* pruned = new TChain(chain->GetName());
+  TEntryList* entryList = new TEntryList("summaryZones", "entries of the zones passing passZone");
+  uint nFiles = 0, nPruned = 0;
+  m_prunedEntries = 0;
+  m_skimInputs.clear();
+  TIter next(chain->GetListOfFiles());
+  while(TChainElement* element = (TChainElement*) next()){
+    string fileName = element->GetTitle();
+    Long64_t nEntries = treeOffsets[nFiles + 1] - treeOffsets[nFiles];
+    nFiles++;
+    m_skimInputs.push_back(fileName);
+
+    // The chain entries of the file, all of them without a zone map
+    TEntryList fileList("", "", chain->GetName(), fileName.c_str());
+    vector<SusyNtZone> zones;
+    string summaryName = SusyNtSummary::fileName(fileName);
+    // AccessPathName is true when the file does not exist
+    if(gSystem->AccessPathName(summaryName.c_str()) || !SusyNtZone::readFileZones(summaryName, zones)){
+      for(Long64_t i=0; i<nEntries; i++) fileList.Enter(i);
+    }
+    for(uint iZ=0; iZ<zones.size(); iZ++){
+      const SusyNtZone& zone = zones[iZ];
+      if(!passZone(zone.max)){
+        m_prunedEntries += zone.n;
+        continue;
+      }
+      for(Long64_t i=zone.first; i<zone.first + zone.n; i++) fileList.Enter(i);
+    }
+    if(fileList.GetN() == 0){
+      if(m_dbg) cout << "SusyNtAna::pruneChain - skipping " << fileName << endl;
+      nPruned++;
+      continue;
+    }
+    pruned->Add(fileName.c_str());
+    entryList->Add(&fileList);
+  }
+  pruned->SetEntryList(entryList);
+  cout << "SusyNtAna::pruneChain - skipping " << nPruned << " of " << nFiles << " files and "
+       << m_prunedEntries << " entries of rejected zones" << endl;
+  return pruned;
+}
+
+/*--------------------------------------------------------------------------------*/
+// Skim/slim output
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::setSkim(const string& fileName, const string& stage, const string& branches)
+{
+  m_skimFile = fileName;
+  m_skimStage = stage;
+  m_skimBranches = branches;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::skimStage(const string& stage)
+{
+  if(m_skimWriter == 0 || m_skimmed == m_entry || stage != m_skimStage) return;
+  m_skimWriter->fill(nt);
+  m_skimmed = m_entry;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::mergeSkim()
+{
+  vector<string> parts;
+  TIter next(GetOutputList());
+  while(TObject* obj = next()){
+    if(string(obj->GetName()).find("skimPart_") == 0) parts.push_back(obj->GetTitle());
+  }
+  if(SusyNtSkimWriter::mergeFiles(parts, m_skimInputs, m_skimFile)){
+    cout << "Skim of stage " << m_skimStage << " written to " << m_skimFile << endl;
+  }
+  for(uint i=0; i<parts.size(); i++) gSystem->Unlink(parts[i].c_str());
+}
+
+/*--------------------------------------------------------------------------------*/
+// TTreeCache training
+/*--------------------------------------------------------------------------------*/
+namespace
+{
+  // Name of the read statistics in the profile file and the output list
+  const char* ReadStatsName = "SusyNtReadStats";
+  // Name of the D3PDPerfStats statistics in the output list
+  const char* PerfStatsName = "SusyNtPerfStats";
+  // The cache holds the profiled branches for this many entries
+  const Long64_t CacheEntries = 1000;
+  const Long64_t MinCacheSize = 1000000;
+  const Long64_t MaxCacheSize = 100000000;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::applyCacheProfile(TTree* tree)
+{
+  // AccessPathName is true when the file does not exist
+  if(gSystem->AccessPathName(m_cacheProfile.c_str())){
+    cout << "SusyNtAna::applyCacheProfile - no profile " << m_cacheProfile
+         << " yet, it is written at the end of the job" << endl;
+    return;
+  }
+  TFile* file = TFile::Open(m_cacheProfile.c_str());
+  if(file == 0 || file->IsZombie()){
+    cout << "SusyNtAna::applyCacheProfile ERROR cannot open " << m_cacheProfile << endl;
+    delete file;
+    return;
+  }
+  D3PDReader::D3PDReadStats* stats = (D3PDReader::D3PDReadStats*) file->Get(ReadStatsName);
+  if(stats == 0){
+    cout << "SusyNtAna::applyCacheProfile ERROR no " << ReadStatsName << " in " << m_cacheProfile << endl;
+  }
+  else{
+    if(m_disableUnusedBranches) nt.DisableUnusedBranches(tree, *stats);
+
+    // Compressed size per entry of the branches that were read
+    double bytesPerEntry = 0;
+    uint nBranches = 0;
+    const D3PDReader::D3PDReadStats::Map_t& vars = stats->GetVariables();
+    D3PDReader::D3PDReadStats::Map_t::const_iterator itr = vars.begin();
+    for(; itr != vars.end(); ++itr){
+      const D3PDReader::VariableStats& var = itr->second;
+      if(var.GetReadEntries() <= 0) continue;
+      bytesPerEntry += double(var.GetZippedBytesRead()) / var.GetReadEntries();
+      nBranches++;
+    }
+    Long64_t cacheSize = (Long64_t) (bytesPerEntry * CacheEntries);
+    cacheSize = std::min(std::max(cacheSize, MinCacheSize), MaxCacheSize);
+
+    tree->SetCacheSize(cacheSize);
+    stats->AddToTreeCacheByEntries(tree, 1);
+    tree->StopCacheLearningPhase();
+    cout << "SusyNtAna::applyCacheProfile - " << nBranches << " branches from " << m_cacheProfile
+         << ", cache size " << cacheSize/1000 << " kB" << endl;
+    delete stats;
+  }
+  file->Close();
+  delete file;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::saveCacheProfile()
+{
+  // Merged over the workers when running with the ParallelDriver
+  D3PDReader::D3PDReadStats stats = nt.GetReadStats();
+  TObject* merged = GetOutputList()->FindObject(ReadStatsName);
+  if(merged) stats = *(D3PDReader::D3PDReadStats*) merged;
+
+  // Keep the previous profile if nothing was read
+  Long64_t nRead = 0;
+  const D3PDReader::D3PDReadStats::Map_t& vars = stats.GetVariables();
+  D3PDReader::D3PDReadStats::Map_t::const_iterator itr = vars.begin();
+  for(; itr != vars.end(); ++itr) nRead += itr->second.GetReadEntries();
+  if(nRead == 0) return;
+
+  TFile* file = TFile::Open(m_cacheProfile.c_str(), "RECREATE");
+  if(file == 0 || file->IsZombie()){
+    cout << "SusyNtAna::saveCacheProfile ERROR cannot write " << m_cacheProfile << endl;
+    delete file;
+    return;
+  }
+  stats.SetName(ReadStatsName);
+  stats.Write(ReadStatsName);
+  file->Close();
+  delete file;
+  if(m_dbg) cout << "SusyNtAna::saveCacheProfile - branch access written to " << m_cacheProfile << endl;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::dumpReadPerfStats()
+{
+  D3PDReader::D3PDPerfStats::Instance()->Stop();
+  D3PDReader::D3PDReadStats stats = D3PDReader::D3PDPerfStats::Instance()->GetStats();
+  TObject* merged = GetOutputList()->FindObject(PerfStatsName);
+  if(merged) stats = *(D3PDReader::D3PDReadStats*) merged;
+
+  printf("---------------------------------------------------\n");
+  printf(" Reading statistics%s\n", m_parallelUnzip? ", parallel unzip" : "");
+  printf("\t Bytes read: %s in %d reads\n",
+         D3PDReader::SizeToString(stats.GetBytesRead()).Data(), stats.GetFileReads());
+  printf("\t Unzip time in the event loop: %s\n", D3PDReader::TimeToString(stats.GetUnzipTime()).Data());
+  printf("\t Processing time: %s\n", D3PDReader::TimeToString(stats.GetProcessTime()).Data());
+  printf("---------------------------------------------------\n\n");
+}
+
+/*--------------------------------------------------------------------------------*/
+// Kinematics table and systematics envelope
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::fillView(bool n0150BugFix)
+{
+  if(m_view.isFilled() && m_view.n0150BugFix()==n0150BugFix) return;
+  m_view.fill(&nt, n0150BugFix);
+  m_view.fillEnvelope(m_sysList);
+  m_nominal.valid = false;
+}
+/*--------------------------------------------------------------------------------*/
+uint SusyNtAna::maxPreLeptons(bool n0150BugFix)
+{
+  fillView(n0150BugFix);
+  return m_view.ele.cand.size() + m_view.muo.cand.size();
+}
+/*--------------------------------------------------------------------------------*/
+uint SusyNtAna::maxPreJets(bool n0150BugFix)
+{
+  fillView(n0150BugFix);
+  return m_view.jet.cand.size();
+}
+/*--------------------------------------------------------------------------------*/
+// Reuse of the nominal selection for systematics
+/*--------------------------------------------------------------------------------*/
+namespace
+{
+  // Values of the NominalSelection signal decisions
+  const char NomSig_Unknown = 0;      // not a nominal baseline object
+  const char NomSig_Fail    = 1;
+  const char NomSig_Pass    = 2;      // for taus: medium
+  const char NomSig_Tight   = 3;      // taus only: tight and medium
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::storeNominal(bool removeLepsFromIso)
+{
+  NominalSelection& nom = m_nominal;
+  nom.valid = true;
+  nom.removeLepsFromIso = removeLepsFromIso;
+  nom.selectTaus = m_selectTaus;
+  nom.preElectrons  = m_preElectrons;
+  nom.preMuons      = m_preMuons;
+  nom.preTaus       = m_preTaus;
+  nom.preJets       = m_preJets;
+  nom.baseElectrons = m_baseElectrons;
+  nom.baseMuons     = m_baseMuons;
+  nom.baseTaus      = m_baseTaus;
+  nom.baseJets      = m_baseJets;
+
+  // Signal decisions of the baseline objects
+  nom.sigEle.assign(m_view.ele.size(), NomSig_Unknown);
+  for(uint i=0; i<m_baseElectrons.size(); i++) nom.sigEle[m_view.index(m_baseElectrons[i])] = NomSig_Fail;
+  for(uint i=0; i<m_signalElectrons.size(); i++) nom.sigEle[m_view.index(m_signalElectrons[i])] = NomSig_Pass;
+
+  nom.sigMuo.assign(m_view.muo.size(), NomSig_Unknown);
+  for(uint i=0; i<m_baseMuons.size(); i++) nom.sigMuo[m_view.index(m_baseMuons[i])] = NomSig_Fail;
+  for(uint i=0; i<m_signalMuons.size(); i++) nom.sigMuo[m_view.index(m_signalMuons[i])] = NomSig_Pass;
+
+  nom.sigTau.assign(m_view.tau.size(), NomSig_Unknown);
+  for(uint i=0; i<m_baseTaus.size(); i++) nom.sigTau[m_view.index(m_baseTaus[i])] = NomSig_Fail;
+  for(uint i=0; i<m_mediumTaus.size(); i++) nom.sigTau[m_view.index(m_mediumTaus[i])] = NomSig_Pass;
+  for(uint i=0; i<m_tightTaus.size(); i++) nom.sigTau[m_view.index(m_tightTaus[i])] = NomSig_Tight;
+
+  nom.sigJet.assign(m_view.jet.size(), NomSig_Unknown);
+  nom.sigJet2Lep.assign(m_view.jet.size(), NomSig_Unknown);
+  for(uint i=0; i<m_baseJets.size(); i++){
+    nom.sigJet[m_view.index(m_baseJets[i])] = NomSig_Fail;
+    nom.sigJet2Lep[m_view.index(m_baseJets[i])] = NomSig_Fail;
+  }
+  for(uint i=0; i<m_signalJets.size(); i++) nom.sigJet[m_view.index(m_signalJets[i])] = NomSig_Pass;
+  for(uint i=0; i<m_signalJets2Lep.size(); i++) nom.sigJet2Lep[m_view.index(m_signalJets2Lep[i])] = NomSig_Pass;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::selectObjectsFromNominal(SusyNtSys sys, bool removeLepsFromIso)
+{
+  const NominalSelection& nom = m_nominal;
+  uint deps = sysDependencies(sys);
+  bool eleChanged = deps & SysDep_Ele;
+  bool muoChanged = deps & SysDep_Muo;
+  bool tauChanged = deps & SysDep_Tau;
+  bool jetChanged = deps & SysDep_Jet;
+
+  // Pre-selection, per collection. The reused objects may still carry
+  // the four-momentum of a previous systematic, so set them back to nominal.
+  if(eleChanged) getPreElectrons(&nt, m_view, sys, m_preElectrons);
+  else{
+    m_preElectrons = nom.preElectrons;
+    for(uint i=0; i<m_preElectrons.size(); i++) m_view.setP4(m_preElectrons[i], NtSys_NOM);
+  }
+  if(muoChanged) getPreMuons(&nt, m_view, sys, m_preMuons);
+  else{
+    m_preMuons = nom.preMuons;
+    for(uint i=0; i<m_preMuons.size(); i++) m_view.setP4(m_preMuons[i], NtSys_NOM);
+  }
+  if(tauChanged && m_selectTaus) getPreTaus(&nt, m_view, sys, m_preTaus);
+  else{
+    m_preTaus = nom.preTaus;
+    for(uint i=0; i<m_preTaus.size(); i++) m_view.setP4(m_preTaus[i], NtSys_NOM);
+  }
+  if(jetChanged) getPreJets(&nt, m_view, sys, m_preJets);
+  else{
+    m_preJets = nom.preJets;
+    for(uint i=0; i<m_preJets.size(); i++) m_view.setP4(m_preJets[i], NtSys_NOM);
+  }
+
+  // Overlap removal couples all collections
+  if(eleChanged || muoChanged || tauChanged || jetChanged){
+    getBaselineObjects(m_preElectrons, m_preMuons, m_preTaus, m_preJets,
+                       m_baseElectrons, m_baseMuons, m_baseTaus, m_baseJets);
+  }
+  else{
+    m_baseElectrons = nom.baseElectrons;
+    m_baseMuons     = nom.baseMuons;
+    m_baseTaus      = nom.baseTaus;
+    m_baseJets      = nom.baseJets;
+  }
+
+  // Lepton isolation only looks at the lepton itself, unless the other
+  // baseline leptons are subtracted from the cones
+  uint nVtx = nt.evt()->nVtx;
+  bool isMC = nt.evt()->isMC;
+  bool sameIsoInputs = !removeLepsFromIso ||
+                       (!eleChanged && !muoChanged &&
+                        m_baseElectrons == nom.baseElectrons && m_baseMuons == nom.baseMuons);
+
+  // One isolation context for the leptons evaluated again
+  if(removeLepsFromIso && (eleChanged || muoChanged || !sameIsoInputs))
+    buildIsolationContext(m_baseElectrons, m_baseMuons);
+  for(uint ie=0; ie<m_baseElectrons.size(); ie++){
+    Electron* e = m_baseElectrons[ie];
+    char nomSig = (eleChanged || !sameIsoInputs)? NomSig_Unknown : nom.sigEle[m_view.index(e)];
+    bool pass = nomSig != NomSig_Unknown? nomSig == NomSig_Pass :
+                isSignalElectron(e, m_baseElectrons, m_baseMuons, nVtx, isMC, removeLepsFromIso);
+    if(pass) m_signalElectrons.push_back(e);
+  }
+  for(uint im=0; im<m_baseMuons.size(); im++){
+    Muon* mu = m_baseMuons[im];
+    char nomSig = (muoChanged || !sameIsoInputs)? NomSig_Unknown : nom.sigMuo[m_view.index(mu)];
+    bool pass = nomSig != NomSig_Unknown? nomSig == NomSig_Pass :
+                isSignalMuon(mu, m_baseElectrons, m_baseMuons, nVtx, isMC, removeLepsFromIso);
+    if(pass) m_signalMuons.push_back(mu);
+  }
+  clearIsolationContext();
+
+  // Signal taus only depend on the tau
+  if(tauChanged) getSignalTaus(m_baseTaus, m_mediumTaus, m_tightTaus);
+  else{
+    for(uint it=0; it<m_baseTaus.size(); it++){
+      Tau* tau = m_baseTaus[it];
+      char nomSig = nom.sigTau[m_view.index(tau)];
+      if(nomSig == NomSig_Unknown){
+        m_oneTau.assign(1, tau);
+        getSignalTaus(m_oneTau, m_mediumTaus, m_tightTaus);
+        continue;
+      }
+      if(nomSig == NomSig_Tight) m_tightTaus.push_back(tau);
+      if(nomSig == NomSig_Pass || nomSig == NomSig_Tight) m_mediumTaus.push_back(tau);
+    }
+  }
+
+  // Signal jets depend on the jet and on the JVF systematics
+  if(jetChanged || (deps & SysDep_JetSel)){
+    getSignalJets(m_baseJets, m_view, sys, m_signalJets);
+    getSignalJets2Lep(m_baseJets, m_view, sys, m_signalJets2Lep);
+  }
+  else{
+    for(uint ij=0; ij<m_baseJets.size(); ij++){
+      Jet* j = m_baseJets[ij];
+      uint idx = m_view.index(j);
+      char nomSig = nom.sigJet[idx];
+      if(nomSig == NomSig_Unknown? isSignalJet(j, sys) : nomSig == NomSig_Pass) m_signalJets.push_back(j);
+      nomSig = nom.sigJet2Lep[idx];
+      if(nomSig == NomSig_Unknown? isSignalJet2Lep(j, sys) : nomSig == NomSig_Pass) m_signalJets2Lep.push_back(j);
+    }
+  }
+}
+
 /*--------------------------------------------------------------------------------*/
 // Get on-the-fly cleaning cut flags. Select objects first!
 /*--------------------------------------------------------------------------------*/
 int SusyNtAna::cleaningCutFlags()
 {
+  ensureObjects();
   return SusyNtTools::cleaningCutFlags(nt.evt()->cutFlags[NtSys_NOM],
                                        m_preMuons, m_baseMuons,
                                        m_preJets, m_baseJets);
@@ -274,6 +987,169 @@ void SusyNtAna::dumpTimer()
   printf("---------------------------------------------------\n\n");
 }
 
+/*--------------------------------------------------------------------------------*/
+// Register event counters
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::registerCounter(const string& name, uint* counter, uint n)
+{
+  CounterRef ref;
+  ref.name = name;
+  ref.uCounts = counter;
+  ref.fCounts = 0;
+  ref.n = n;
+  ref.perSys = false;
+  m_counters.push_back(ref);
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::registerCounter(const string& name, float* counter, uint n)
+{
+  CounterRef ref;
+  ref.name = name;
+  ref.uCounts = 0;
+  ref.fCounts = counter;
+  ref.n = n;
+  ref.perSys = false;
+  m_counters.push_back(ref);
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::registerSysCounter(const string& name, uint* counter, uint n)
+{
+  registerCounter(name, counter, n);
+  m_counters.back().perSys = true;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::registerSysCounter(const string& name, float* counter, uint n)
+{
+  registerCounter(name, counter, n);
+  m_counters.back().perSys = true;
+}
+/*--------------------------------------------------------------------------------*/
+// Counter histogram, x is the counter index and y the systematic
+/*--------------------------------------------------------------------------------*/
+TH1* SusyNtAna::makeCounterHisto(const CounterRef& ref) const
+{
+  string name = "counter_" + ref.name;
+  TH1* h = 0;
+  if(ref.perSys){
+    h = new TH2D(name.c_str(), name.c_str(), ref.n, 0, ref.n, NtSys_N, 0, NtSys_N);
+    for(int s=0; s<NtSys_N; s++) h->GetYaxis()->SetBinLabel(s+1, SusyNtSystNames[s].c_str());
+  }
+  else h = new TH1D(name.c_str(), name.c_str(), ref.n, 0, ref.n);
+  h->SetDirectory(0);
+
+  uint nSys = ref.perSys? NtSys_N : 1;
+  for(uint s=0; s<nSys; s++){
+    for(uint i=0; i<ref.n; i++){
+      uint idx = s*ref.n + i;
+      float count = ref.uCounts? ref.uCounts[idx] : ref.fCounts[idx];
+      if(ref.perSys) h->SetBinContent(i+1, s+1, count);
+      else h->SetBinContent(i+1, count);
+    }
+  }
+  return h;
+}
+/*--------------------------------------------------------------------------------*/
+// Store the counters in the output list, one histogram per counter array
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::storeCounters()
+{
+  TList* output = GetOutputList();
+  for(uint iC=0; iC<m_counters.size(); iC++){
+    output->Add(makeCounterHisto(m_counters[iC]));
+  }
+  TH1D* hEntries = new TH1D("counter_chainEntries", "counter_chainEntries", 1, 0, 1);
+  hEntries->SetDirectory(0);
+  hEntries->SetBinContent(1, m_chainEntry+1);
+  output->Add(hEntries);
+
+  // Branch access of this worker, merged into the cache profile
+  if(!m_cacheProfile.empty()){
+    D3PDReader::D3PDReadStats* stats = new D3PDReader::D3PDReadStats(nt.GetReadStats());
+    stats->SetName(ReadStatsName);
+    output->Add(stats);
+  }
+
+  // Reading performance of this worker
+  if(m_readPerfStats){
+    D3PDReader::D3PDPerfStats::Instance()->Stop();
+    D3PDReader::D3PDReadStats* stats =
+      new D3PDReader::D3PDReadStats(D3PDReader::D3PDPerfStats::Instance()->GetStats());
+    stats->SetName(PerfStatsName);
+    output->Add(stats);
+  }
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtAna::retrieveCounters()
+{
+  TList* output = GetOutputList();
+  for(uint iC=0; iC<m_counters.size(); iC++){
+    const CounterRef& ref = m_counters[iC];
+    string name = "counter_" + ref.name;
+    TH1* h = (TH1*) output->FindObject(name.c_str());
+    if(h==NULL){
+      cout << "SusyNtAna::retrieveCounters WARNING counter " << ref.name << " not found" << endl;
+      continue;
+    }
+    uint nSys = ref.perSys? NtSys_N : 1;
+    for(uint s=0; s<nSys; s++){
+      for(uint i=0; i<ref.n; i++){
+        uint idx = s*ref.n + i;
+        double count = ref.perSys? h->GetBinContent(i+1, s+1) : h->GetBinContent(i+1);
+        if(ref.uCounts) ref.uCounts[idx] = (uint) (count + 0.5);
+        else ref.fCounts[idx] = count;
+      }
+    }
+  }
+  TH1* hEntries = (TH1*) output->FindObject("counter_chainEntries");
+  if(hEntries) m_chainEntry = (Long64_t) (hEntries->GetBinContent(1) + 0.5) - 1;
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtAna::writeCounters(const string& fileName)
+{
+  TFile* file = TFile::Open(fileName.c_str(), "RECREATE");
+  if(file == 0 || file->IsZombie()){
+    cout << "SusyNtAna::writeCounters ERROR cannot open " << fileName << endl;
+    delete file;
+    return false;
+  }
+  for(uint iC=0; iC<m_counters.size(); iC++){
+    TH1* h = makeCounterHisto(m_counters[iC]);
+    h->Write();
+    delete h;
+  }
+  file->Close();
+  delete file;
+  return true;
+}
+
+/*--------------------------------------------------------------------------------*/
+// Systematics list from names
+/*--------------------------------------------------------------------------------*/
+bool SusyNtAna::parseSystematics(const string& names, vector<SusyNtSys>& sysList)
+{
+  sysList.clear();
+  if(names=="ALL" || names=="all"){
+    for(int s=0; s<NtSys_N; s++) sysList.push_back((SusyNtSys) s);
+    return true;
+  }
+  string::size_type start = 0;
+  while(start <= names.size()){
+    string::size_type end = names.find(',', start);
+    if(end == string::npos) end = names.size();
+    string name = names.substr(start, end - start);
+    start = end + 1;
+    if(name.empty()) continue;
+    int sys = 0;
+    while(sys < NtSys_N && SusyNtSystNames[sys] != name) sys++;
+    if(sys == NtSys_N){
+      cout << "SusyNtAna::parseSystematics ERROR unknown systematic " << name << endl;
+      return false;
+    }
+    sysList.push_back((SusyNtSys) sys);
+  }
+  return !sysList.empty();
+}
+
 /*--------------------------------------------------------------------------------*/
 // Event and object dumps
 /*--------------------------------------------------------------------------------*/
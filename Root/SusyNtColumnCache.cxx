@@ -0,0 +1,522 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TChainElement.h"
+#include "TStreamerElement.h"
+#include "TVirtualStreamerInfo.h"
+
+#include "SusyNtuple/SusyNtColumnCache.h"
+#include "SusyNtuple/SusyNtObject.h"
+
+using namespace std;
+using namespace Susy;
+
+namespace
+{
+  // Start of every cache file, with the format version
+  const char Magic[8] = { 'S', 'U', 'S', 'Y', 'N', 'T', 'C', '1' };
+
+  // Fixed size header at the start of the file
+  struct FileHeader {
+    char magic[8];
+    Long64_t manifestOffset;    // text description of the sources and columns
+    Long64_t manifestSize;
+    Long64_t blockTableOffset;  // first entry, entries and offset of each block
+    Long64_t nBlocks;
+    Long64_t reserved[3];
+  };
+
+  // The blocks and the sections in them start on 8 bytes
+  Long64_t padded(Long64_t size) { return (size + 7) & ~Long64_t(7); }
+
+  // Write with the position kept up to date, false on error
+  bool writeBytes(FILE* out, const void* data, Long64_t size, Long64_t& pos)
+  {
+    if(size > 0 && fwrite(data, 1, size, out) != (size_t) size) return false;
+    pos += size;
+    return true;
+  }
+  bool writePadding(FILE* out, Long64_t& pos)
+  {
+    static const char zeros[8] = { 0 };
+    return writeBytes(out, zeros, padded(pos) - pos, pos);
+  }
+
+  // Columns of a branch being written. The objects are copied member by
+  // member into one buffer per column, written at the end of each block.
+  class ColumnWriter
+  {
+    public:
+      ColumnWriter(D3PDReader::VarHandleBase& handle, TClass* cl) :
+              m_handle(handle), m_class(cl), m_ok(SusyNtColumnCache::classColumns(cl, m_columns))
+      {
+        m_data.resize(m_columns.size());
+        m_index.push_back(0);
+      }
+      virtual ~ColumnWriter() {}
+
+      /// Append the objects of the current entry
+      virtual void fill() = 0;
+
+      const char* branch() const { return m_handle.GetName(); }
+      TClass* objectClass() const { return m_class; }
+      const vector<SusyNtColumnCache::Column>& columns() const { return m_columns; }
+      bool ok() const { return m_ok; }
+
+      /// Write the index and the columns of the block, and start the next one
+      bool writeBlock(FILE* out, Long64_t& pos)
+      {
+        bool ok = writeBytes(out, &m_index[0], m_index.size()*sizeof(Long64_t), pos);
+        for(uint i=0; i<m_data.size(); i++){
+          if(!m_data[i].empty()) ok = ok && writeBytes(out, &m_data[i][0], m_data[i].size(), pos);
+          ok = ok && writePadding(out, pos);
+          m_data[i].clear();
+        }
+        m_index.assign(1, 0);
+        return ok;
+      }
+
+    protected:
+      void append(const char* first, size_t n, size_t stride)
+      {
+        for(uint i=0; i<m_columns.size(); i++){
+          const SusyNtColumnCache::Column& col = m_columns[i];
+          for(size_t k=0; k<n; k++){
+            const char* member = first + k*stride + col.offset;
+            m_data[i].insert(m_data[i].end(), member, member + col.size);
+          }
+        }
+        m_index.push_back(m_index.back() + n);
+      }
+
+      D3PDReader::VarHandleBase& m_handle;
+      TClass* m_class;
+      vector<SusyNtColumnCache::Column> m_columns;
+      bool m_ok;
+      vector< vector<char> > m_data;
+      vector<Long64_t> m_index;
+  };
+
+  class EventWriter : public ColumnWriter
+  {
+    public:
+      EventWriter(D3PDReader::VarHandle<Event*>& handle) :
+              ColumnWriter(handle, Event::Class()), m_evt(handle) {}
+      virtual void fill() { append((const char*) m_evt(), 1, sizeof(Event)); }
+    protected:
+      D3PDReader::VarHandle<Event*>& m_evt;
+  };
+
+  template<class T>
+  class VectorWriter : public ColumnWriter
+  {
+    public:
+      VectorWriter(D3PDReader::VarHandle< vector<T>* >& handle) :
+              ColumnWriter(handle, T::Class()), m_objects(handle) {}
+      virtual void fill()
+      {
+        const vector<T>* objects = m_objects();
+        if(objects->empty()) append(0, 0, sizeof(T));
+        else append((const char*) &objects->at(0), objects->size(), sizeof(T));
+      }
+    protected:
+      D3PDReader::VarHandle< vector<T>* >& m_objects;
+  };
+}
+
+/*--------------------------------------------------------------------------------*/
+// SusyNtColumnCache constructor
+/*--------------------------------------------------------------------------------*/
+SusyNtColumnCache::SusyNtColumnCache() :
+        m_data(0),
+        m_size(0),
+        m_nEntries(0),
+        m_blockSize(0)
+{
+}
+/*--------------------------------------------------------------------------------*/
+SusyNtColumnCache::~SusyNtColumnCache()
+{
+  close();
+}
+/*--------------------------------------------------------------------------------*/
+// Class layout
+/*--------------------------------------------------------------------------------*/
+namespace
+{
+  bool addColumns(TClass* cl, Long64_t offset, const string& prefix,
+                  vector<SusyNtColumnCache::Column>& columns)
+  {
+    TVirtualStreamerInfo* info = cl? cl->GetStreamerInfo() : 0;
+    if(info == 0) return false;
+    bool ok = true;
+    TIter next(info->GetElements());
+    while(TStreamerElement* element = (TStreamerElement*) next()){
+      Long64_t elementOffset = offset + element->GetOffset();
+      int type = element->GetType();
+      TClass* elementClass = element->GetClassPointer();
+      // The TObject unique id and bits belong to the object in memory
+      if(element->IsBase()){
+        if(elementClass == TObject::Class()) continue;
+        ok = addColumns(elementClass, elementOffset, prefix, columns) && ok;
+      }
+      // Basic types and fixed size arrays of them, char* excepted
+      else if(type > 0 && type < TVirtualStreamerInfo::kOffsetP &&
+              type != TVirtualStreamerInfo::kCharStar &&
+              type != TVirtualStreamerInfo::kOffsetL + TVirtualStreamerInfo::kCharStar){
+        SusyNtColumnCache::Column col;
+        col.name = prefix + element->GetName();
+        col.offset = elementOffset;
+        col.size = element->GetSize();
+        columns.push_back(col);
+      }
+      // Object members, e.g. the TVector3 of the TLorentzVector
+      else if((type == TVirtualStreamerInfo::kObject || type == TVirtualStreamerInfo::kAny) &&
+              element->GetArrayLength() == 0){
+        ok = addColumns(elementClass, elementOffset, prefix + element->GetName() + ".", columns) && ok;
+      }
+      else{
+        cout << "SusyNtColumnCache ERROR cannot cache " << cl->GetName() << "::"
+             << element->GetName() << endl;
+        ok = false;
+      }
+    }
+    return ok;
+  }
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtColumnCache::classColumns(TClass* cl, vector<Column>& columns)
+{
+  columns.clear();
+  return addColumns(cl, 0, "", columns);
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtColumnCache::sameObjects(TClass* cl, const void* a, const void* b)
+{
+  // Same classes over and over, the columns are looked up once
+  static map<TClass*, vector<Column> > classes;
+  map<TClass*, vector<Column> >::iterator it = classes.find(cl);
+  if(it == classes.end()){
+    it = classes.insert(make_pair(cl, vector<Column>())).first;
+    classColumns(cl, it->second);
+  }
+  const vector<Column>& columns = it->second;
+  const char* objA = (const char*) a;
+  const char* objB = (const char*) b;
+  for(uint i=0; i<columns.size(); i++)
+    if(memcmp(objA + columns[i].offset, objB + columns[i].offset, columns[i].size) != 0) return false;
+  return true;
+}
+/*--------------------------------------------------------------------------------*/
+// Write the cache
+/*--------------------------------------------------------------------------------*/
+bool SusyNtColumnCache::makeCacheFile(TChain* chain, const string& fileName, Long64_t blockSize)
+{
+  if(blockSize <= 0) blockSize = DefaultBlockSize;
+  // Also fills the entry offsets of the files
+  Long64_t nEntries = chain->GetEntries();
+  if(nEntries <= 0){
+    cout << "SusyNtColumnCache::makeCacheFile ERROR no entries to cache" << endl;
+    return false;
+  }
+
+  Long64_t entry = 0;
+  SusyNtObject nt(entry);
+  nt.ReadFrom(chain);
+  chain->LoadTree(0);
+
+  // The branches of the input, the event first
+  vector<ColumnWriter*> writers;
+  writers.push_back(new EventWriter(nt.evt));
+  if(nt.ele.IsAvailable()) writers.push_back(new VectorWriter<Electron>(nt.ele));
+  if(nt.muo.IsAvailable()) writers.push_back(new VectorWriter<Muon>(nt.muo));
+  if(nt.jet.IsAvailable()) writers.push_back(new VectorWriter<Jet>(nt.jet));
+  if(nt.pho.IsAvailable()) writers.push_back(new VectorWriter<Photon>(nt.pho));
+  if(nt.tau.IsAvailable()) writers.push_back(new VectorWriter<Tau>(nt.tau));
+  if(nt.met.IsAvailable()) writers.push_back(new VectorWriter<Met>(nt.met));
+  if(nt.tpr.IsAvailable()) writers.push_back(new VectorWriter<TruthParticle>(nt.tpr));
+  if(nt.tjt.IsAvailable()) writers.push_back(new VectorWriter<TruthJet>(nt.tjt));
+  if(nt.tmt.IsAvailable()) writers.push_back(new VectorWriter<TruthMet>(nt.tmt));
+
+  bool ok = true;
+  for(uint i=0; i<writers.size(); i++) ok = writers[i]->ok() && ok;
+
+  FILE* out = ok? fopen(fileName.c_str(), "wb") : 0;
+  if(ok && out == 0){
+    cout << "SusyNtColumnCache::makeCacheFile ERROR cannot write " << fileName << endl;
+    ok = false;
+  }
+
+  // The header is written again at the end, with the offsets
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, Magic, sizeof(Magic));
+  Long64_t pos = 0;
+  if(ok) ok = writeBytes(out, &header, sizeof(header), pos);
+
+  vector<Long64_t> blockTable;
+  for(Long64_t first=0; ok && first<nEntries; first+=blockSize){
+    Long64_t n = std::min(blockSize, nEntries - first);
+    for(Long64_t i=first; i<first+n; i++){
+      entry = chain->LoadTree(i);
+      for(uint w=0; w<writers.size(); w++) writers[w]->fill();
+    }
+    blockTable.push_back(first);
+    blockTable.push_back(n);
+    blockTable.push_back(pos);
+    for(uint w=0; ok && w<writers.size(); w++) ok = writers[w]->writeBlock(out, pos);
+  }
+
+  // Manifest: sources, then the branches with the name and size of their columns
+  if(ok){
+    ostringstream manifest;
+    manifest << "entries " << nEntries << "\n";
+    manifest << "blockSize " << blockSize << "\n";
+    const Long64_t* treeOffsets = chain->GetTreeOffset();
+    TObjArray* files = chain->GetListOfFiles();
+    for(int i=0; i<files->GetEntries(); i++){
+      manifest << "source " << treeOffsets[i+1] - treeOffsets[i] << " " << files->At(i)->GetTitle() << "\n";
+    }
+    for(uint w=0; w<writers.size(); w++){
+      const vector<Column>& columns = writers[w]->columns();
+      manifest << "collection " << writers[w]->branch() << " " << writers[w]->objectClass()->GetName()
+               << " " << columns.size() << "\n";
+      for(uint i=0; i<columns.size(); i++)
+        manifest << "column " << columns[i].name << " " << columns[i].size << "\n";
+    }
+    string text = manifest.str();
+    header.manifestOffset = pos;
+    header.manifestSize = text.size();
+    ok = writeBytes(out, text.c_str(), text.size(), pos) && writePadding(out, pos);
+    header.blockTableOffset = pos;
+    header.nBlocks = blockTable.size() / 3;
+    ok = ok && writeBytes(out, &blockTable[0], blockTable.size()*sizeof(Long64_t), pos);
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+  }
+
+  if(out && fclose(out) != 0) ok = false;
+  if(out && !ok){
+    cout << "SusyNtColumnCache::makeCacheFile ERROR writing " << fileName << endl;
+    remove(fileName.c_str());
+  }
+  for(uint w=0; w<writers.size(); w++) delete writers[w];
+  if(ok) cout << "SusyNtColumnCache::makeCacheFile - " << nEntries << " entries, "
+              << pos/(1024*1024) << " MB written to " << fileName << endl;
+  return ok;
+}
+/*--------------------------------------------------------------------------------*/
+// Map the cache
+/*--------------------------------------------------------------------------------*/
+bool SusyNtColumnCache::open(const string& fileName)
+{
+  close();
+  m_fileName = fileName;
+
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  struct stat st;
+  if(fd < 0 || fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(FileHeader)){
+    cout << "SusyNtColumnCache::open ERROR cannot read " << fileName << endl;
+    if(fd >= 0) ::close(fd);
+    return false;
+  }
+  // Shared, so the processes of a node map the same pages of the page cache
+  void* data = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(data == MAP_FAILED){
+    cout << "SusyNtColumnCache::open ERROR cannot map " << fileName << endl;
+    return false;
+  }
+  m_data = (char*) data;
+  m_size = st.st_size;
+
+  if(!readLayout()){
+    close();
+    return false;
+  }
+  return true;
+}
+/*--------------------------------------------------------------------------------*/
+namespace
+{
+  // The n+1 object offsets of a block start at 0 and never decrease. A
+  // column has at least one byte per object, which bounds the last offset.
+  bool validIndex(const Long64_t* index, Long64_t n, Long64_t maxObjects)
+  {
+    if(index[0] != 0) return false;
+    for(Long64_t i=0; i<n; i++) if(index[i+1] < index[i]) return false;
+    return index[n] <= maxObjects;
+  }
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtColumnCache::readLayout()
+{
+  const FileHeader* header = (const FileHeader*) m_data;
+  if(memcmp(header->magic, Magic, sizeof(Magic)) != 0 ||
+     header->manifestOffset + header->manifestSize > (Long64_t) m_size ||
+     header->blockTableOffset + header->nBlocks*3*(Long64_t) sizeof(Long64_t) > (Long64_t) m_size){
+    cout << "SusyNtColumnCache::open ERROR " << m_fileName << " is not a SusyNt cache" << endl;
+    return false;
+  }
+
+  // Sources and columns. The file columns must be those of the classes of this job.
+  istringstream manifest(string(m_data + header->manifestOffset, header->manifestSize));
+  string key;
+  Long64_t first = 0;
+  while(manifest >> key){
+    if(key == "entries") manifest >> m_nEntries;
+    else if(key == "blockSize") manifest >> m_blockSize;
+    else if(key == "source"){
+      Source source;
+      manifest >> source.n;
+      manifest.ignore(1);
+      getline(manifest, source.name);
+      source.first = first;
+      first += source.n;
+      m_sources.push_back(source);
+    }
+    else if(key == "collection"){
+      Collection coll;
+      uint nColumns = 0;
+      manifest >> coll.branch >> coll.className >> nColumns;
+      vector<Column> layout;
+      if(!classColumns(TClass::GetClass(coll.className.c_str()), layout)){
+        cout << "SusyNtColumnCache::open ERROR no layout for " << coll.className << endl;
+        return false;
+      }
+      for(uint i=0; i<nColumns; i++){
+        Column col;
+        manifest >> key >> col.name >> col.size;
+        uint j = 0;
+        while(j < layout.size() && layout[j].name != col.name) j++;
+        if(j == layout.size() || layout[j].size != col.size){
+          cout << "SusyNtColumnCache::open ERROR " << coll.className << "::" << col.name
+               << " has changed, remake " << m_fileName << endl;
+          return false;
+        }
+        col.offset = layout[j].offset;
+        coll.columns.push_back(col);
+      }
+      if(nColumns != layout.size()){
+        cout << "SusyNtColumnCache::open ERROR " << coll.className << " has new members, remake "
+             << m_fileName << endl;
+        return false;
+      }
+      m_collections.push_back(coll);
+    }
+  }
+  if(first != m_nEntries || m_blockSize <= 0){
+    cout << "SusyNtColumnCache::open ERROR bad manifest in " << m_fileName << endl;
+    return false;
+  }
+
+  // Locate the index and the columns of each block
+  const Long64_t* table = (const Long64_t*) (m_data + header->blockTableOffset);
+  for(Long64_t iB=0; iB<header->nBlocks; iB++){
+    Block block;
+    block.first = table[3*iB];
+    block.n = table[3*iB + 1];
+    Long64_t pos = table[3*iB + 2];
+    // A corrupt table or index must not send the reads out of the mapping
+    if(block.n <= 0 || block.n > m_blockSize || pos < 0 || pos % sizeof(Long64_t) != 0){
+      cout << "SusyNtColumnCache::open ERROR bad block table in " << m_fileName << endl;
+      return false;
+    }
+    block.data.resize(m_collections.size());
+    for(uint iC=0; iC<m_collections.size(); iC++){
+      const Long64_t* index = (const Long64_t*) (m_data + pos);
+      pos += (block.n + 1)*sizeof(Long64_t);
+      if(pos > (Long64_t) m_size) break;
+      if(!validIndex(index, block.n, m_size - pos)){
+        cout << "SusyNtColumnCache::open ERROR bad object index in " << m_fileName << endl;
+        return false;
+      }
+      block.index.push_back(index);
+      const vector<Column>& columns = m_collections[iC].columns;
+      for(uint i=0; i<columns.size(); i++){
+        block.data[iC].push_back(m_data + pos);
+        pos += padded(index[block.n]*columns[i].size);
+      }
+    }
+    if(pos > (Long64_t) m_size || block.first != iB*m_blockSize){
+      cout << "SusyNtColumnCache::open ERROR " << m_fileName << " is truncated" << endl;
+      return false;
+    }
+    m_blocks.push_back(block);
+  }
+  if(m_blocks.empty() || m_blocks.back().first + m_blocks.back().n != m_nEntries){
+    cout << "SusyNtColumnCache::open ERROR the blocks of " << m_fileName << " don't cover its entries" << endl;
+    return false;
+  }
+
+  cout << "SusyNtColumnCache::open - " << m_nEntries << " entries of " << m_sources.size()
+       << " files in " << m_fileName << endl;
+  return true;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtColumnCache::close()
+{
+  if(m_data) munmap(m_data, m_size);
+  m_data = 0;
+  m_size = 0;
+  m_nEntries = 0;
+  m_blockSize = 0;
+  m_sources.clear();
+  m_collections.clear();
+  m_blocks.clear();
+}
+/*--------------------------------------------------------------------------------*/
+// Lookup
+/*--------------------------------------------------------------------------------*/
+Long64_t SusyNtColumnCache::sourceOffset(const string& fileName, Long64_t nEntries) const
+{
+  for(uint i=0; i<m_sources.size(); i++){
+    if(m_sources[i].name == fileName) return m_sources[i].n == nEntries? m_sources[i].first : -1;
+  }
+  return -1;
+}
+/*--------------------------------------------------------------------------------*/
+int SusyNtColumnCache::collection(const string& branch, const string& className) const
+{
+  for(uint i=0; i<m_collections.size(); i++){
+    if(m_collections[i].branch == branch && m_collections[i].className == className) return i;
+  }
+  return -1;
+}
+/*--------------------------------------------------------------------------------*/
+Long64_t SusyNtColumnCache::nObjects(int coll, Long64_t entry) const
+{
+  const Block& block = m_blocks[entry / m_blockSize];
+  const Long64_t* index = block.index[coll];
+  Long64_t i = entry - block.first;
+  return index[i + 1] - index[i];
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtColumnCache::fillObjects(int coll, Long64_t entry, char* first, size_t stride) const
+{
+  const Block& block = m_blocks[entry / m_blockSize];
+  const Long64_t* index = block.index[coll];
+  Long64_t i = entry - block.first;
+  Long64_t n = index[i + 1] - index[i];
+  const vector<Column>& columns = m_collections[coll].columns;
+  for(uint c=0; c<columns.size(); c++){
+    const Column& col = columns[c];
+    const char* src = block.data[coll][c] + index[i]*col.size;
+    for(Long64_t k=0; k<n; k++) memcpy(first + k*stride + col.offset, src + k*col.size, col.size);
+  }
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtColumnCache::read(int coll, Long64_t entry, Event& evt) const
+{
+  if(entry < 0 || entry >= m_nEntries || nObjects(coll, entry) != 1) return false;
+  fillObjects(coll, entry, (char*) &evt, sizeof(Event));
+  return true;
+}
@@ -1,10 +1,50 @@
 #include "SusyNtuple/SusyNtObject.h"
+#include "SusyNtuple/SusyNtColumnCache.h"
+#include "SusyNtuple/string_utils.h"
 
 using namespace std;
 using namespace Susy;
 
 #include <iostream>
 
+namespace
+{
+  // Serves the entries of a handle from the column cache, at the cache
+  // offset of the current tree
+  template<class T>
+  class CacheReader : public D3PDReader::VarReader
+  {
+    public:
+      CacheReader(const SusyNtColumnCache* cache, int coll, const Long64_t* offset) :
+              m_cache(cache), m_coll(coll), m_offset(offset) {}
+      virtual Bool_t ReadEntry(Long64_t entry, void* variable)
+      {
+        if(*m_offset < 0) return kFALSE;
+        return m_cache->read(m_coll, *m_offset + entry, *static_cast<T*>(variable));
+      }
+    protected:
+      const SusyNtColumnCache* m_cache;
+      int m_coll;
+      const Long64_t* m_offset;
+  };
+
+  // Class of the objects of a handle
+  TClass* objectClass(Event*) { return Event::Class(); }
+  template<class T>
+  TClass* objectClass(std::vector<T>*) { return T::Class(); }
+
+  template<class T>
+  void connectCache(D3PDReader::VarHandle<T*>& handle, const SusyNtColumnCache* cache,
+                    const Long64_t* offset, vector<D3PDReader::VarReader*>& readers)
+  {
+    handle.SetReader(0);
+    if(cache == 0) return;
+    int coll = cache->collection(handle.GetName(), objectClass((T*) 0)->GetName());
+    if(coll < 0) return;
+    readers.push_back(new CacheReader<T>(cache, coll, offset));
+    handle.SetReader(readers.back());
+  }
+}
 
 /*--------------------------------------------------------------------------------*/
 // SusyNtObject constructor for writing only.
@@ -19,7 +59,9 @@ SusyNtObject::SusyNtObject():
         met(this, "met", 0),
         tpr(this, "truthParticles", 0),
         tjt(this, "truthJets", 0),
-        tmt(this, "truthMet", 0)
+        tmt(this, "truthMet", 0),
+        m_cache(0),
+        m_cacheOffset(-1)
 {
 }
 
@@ -36,8 +78,15 @@ SusyNtObject::SusyNtObject(const Long64_t& entry):
         met(this, "met", &entry),
         tpr(this, "truthParticles", &entry),
         tjt(this, "truthJets", &entry),
-        tmt(this, "truthMet", &entry)
+        tmt(this, "truthMet", &entry),
+        m_cache(0),
+        m_cacheOffset(-1)
+{
+}
+/*--------------------------------------------------------------------------------*/
+SusyNtObject::~SusyNtObject()
 {
+  ReadFromCache(0);
 }
 
 /*--------------------------------------------------------------------------------*/
@@ -57,6 +106,33 @@ void SusyNtObject::SetActive()
   tmt.SetActive(true);
 }
 
+/*--------------------------------------------------------------------------------*/
+bool SusyNtObject::SetActive(const std::string& branches)
+{
+  vector<D3PDReader::VarHandleBase*> handles = this->handles();
+  for(uint i=0; i<handles.size(); i++) handles[i]->SetActive(false);
+  evt.SetActive(true);
+
+  bool ok = true;
+  vector<string> names = susy::utils::tokenizeString(branches, ',');
+  for(uint iN=0; iN<names.size(); iN++){
+    string name = susy::utils::rmLeadingTrailingWhitespaces(names[iN]);
+    if(name.empty()) continue;
+    bool found = false;
+    for(uint i=0; i<handles.size(); i++){
+      if(name == handles[i]->GetName()){
+        handles[i]->SetActive(true);
+        found = true;
+      }
+    }
+    if(!found){
+      cout << "SusyNtObject::SetActive ERROR unknown branch " << name << endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
 /*--------------------------------------------------------------------------------*/
 // Connect the objects to an output tree
 /*--------------------------------------------------------------------------------*/
@@ -107,3 +183,111 @@ void SusyNtObject::clear()
   tjt()->clear();
   tmt()->clear();
 }
+
+/*--------------------------------------------------------------------------------*/
+// Read statistics of all the branches
+/*--------------------------------------------------------------------------------*/
+D3PDReader::D3PDReadStats SusyNtObject::GetReadStats() const
+{
+  D3PDReader::D3PDReadStats stats;
+  stats.AddVariable(evt.GetStatistics());
+  stats.AddVariable(ele.GetStatistics());
+  stats.AddVariable(muo.GetStatistics());
+  stats.AddVariable(jet.GetStatistics());
+  stats.AddVariable(pho.GetStatistics());
+  stats.AddVariable(tau.GetStatistics());
+  stats.AddVariable(met.GetStatistics());
+  stats.AddVariable(tpr.GetStatistics());
+  stats.AddVariable(tjt.GetStatistics());
+  stats.AddVariable(tmt.GetStatistics());
+  return stats;
+}
+
+/*--------------------------------------------------------------------------------*/
+// Switch off the branches the profiled run did not read
+/*--------------------------------------------------------------------------------*/
+void SusyNtObject::DisableUnusedBranches(TTree* tree, const D3PDReader::D3PDReadStats& profile)
+{
+  vector<D3PDReader::VarHandleBase*> handles = this->handles();
+  const uint nHandles = handles.size();
+
+  tree->SetBranchStatus("*", 0);
+  uint nOn = 0;
+  for(uint i=0; i<nHandles; i++){
+    const char* name = handles[i]->GetName();
+    const D3PDReader::VariableStats* var = profile.GetVariable(name);
+    bool used = (var && var->GetReadEntries() > 0) || handles[i]->GetStatistics().GetReadEntries() > 0;
+    // The event is needed for every entry
+    if(handles[i] == &evt) used = true;
+    if(!used || !tree->GetBranch(name)) continue;
+    tree->SetBranchStatus((std::string(name) + "*").c_str(), 1);
+    nOn++;
+  }
+
+  // Fall back to reading a branch the profile missed
+  D3PDReader::VarHandleBase::SetActivateBranches(kTRUE);
+  cout << "SusyNtObject::DisableUnusedBranches - " << nOn << " of " << nHandles << " branches on" << endl;
+}
+
+/*--------------------------------------------------------------------------------*/
+// Batch reading
+/*--------------------------------------------------------------------------------*/
+void SusyNtObject::ReadBatch(Long64_t first, Long64_t n)
+{
+  vector<D3PDReader::VarHandleBase*> handles = this->handles();
+  Long64_t prevSize = evt.GetBatchSize();
+  for(uint i=0; i<handles.size(); i++){
+    D3PDReader::VarHandleBase* handle = handles[i];
+    Long64_t used = handle->GetUseCount();
+    if(handle == &evt || (used > 0 && 2*used >= prevSize)) handle->ReadBatch(first, n);
+    else handle->ClearBatch();
+  }
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtObject::ClearBatch()
+{
+  vector<D3PDReader::VarHandleBase*> handles = this->handles();
+  for(uint i=0; i<handles.size(); i++) handles[i]->ClearBatch();
+}
+/*--------------------------------------------------------------------------------*/
+vector<D3PDReader::VarHandleBase*> SusyNtObject::handles()
+{
+  D3PDReader::VarHandleBase* all[] = { &evt, &ele, &muo, &jet, &pho, &tau, &met, &tpr, &tjt, &tmt };
+  return vector<D3PDReader::VarHandleBase*>(all, all + sizeof(all)/sizeof(all[0]));
+}
+
+/*--------------------------------------------------------------------------------*/
+// Column cache
+/*--------------------------------------------------------------------------------*/
+void SusyNtObject::ReadFromCache(const SusyNtColumnCache* cache)
+{
+  vector<D3PDReader::VarHandleBase*> handles = this->handles();
+  for(uint i=0; i<handles.size(); i++) handles[i]->SetReader(0);
+  for(uint i=0; i<m_cacheReaders.size(); i++) delete m_cacheReaders[i];
+  m_cacheReaders.clear();
+  m_cache = cache;
+  m_cacheOffset = -1;
+  if(cache == 0 || !cache->isOpen()) return;
+
+  connectCache(evt, cache, &m_cacheOffset, m_cacheReaders);
+  connectCache(ele, cache, &m_cacheOffset, m_cacheReaders);
+  connectCache(muo, cache, &m_cacheOffset, m_cacheReaders);
+  connectCache(jet, cache, &m_cacheOffset, m_cacheReaders);
+  connectCache(pho, cache, &m_cacheOffset, m_cacheReaders);
+  connectCache(tau, cache, &m_cacheOffset, m_cacheReaders);
+  connectCache(met, cache, &m_cacheOffset, m_cacheReaders);
+  connectCache(tpr, cache, &m_cacheOffset, m_cacheReaders);
+  connectCache(tjt, cache, &m_cacheOffset, m_cacheReaders);
+  connectCache(tmt, cache, &m_cacheOffset, m_cacheReaders);
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtObject::SetCacheSource(const std::string& fileName, Long64_t nEntries)
+{
+  m_cacheOffset = m_cache? m_cache->sourceOffset(fileName, nEntries) : -1;
+  // The local entries start again, forget the entry last served
+  vector<D3PDReader::VarHandleBase*> handles = this->handles();
+  for(uint i=0; i<handles.size(); i++){
+    if(handles[i]->GetReader()) handles[i]->SetReader(handles[i]->GetReader());
+  }
+  return m_cacheOffset >= 0;
+}
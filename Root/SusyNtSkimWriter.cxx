@@ -0,0 +1,190 @@
+#include <iostream>
+#include <map>
+
+#include "TFileMerger.h"
+#include "TH1.h"
+#include "TKey.h"
+
+#include "SusyNtuple/SusyNtSkimWriter.h"
+
+using namespace std;
+using namespace Susy;
+
+namespace
+{
+  // Copy a particle collection. The four-vector is reset to the nominal
+  // kinematics, dropping the systematic shift of the object selection.
+  template<class T>
+  void copyParticles(D3PDReader::VarHandle< vector<T>* >& in, D3PDReader::VarHandle< vector<T>* >& out)
+  {
+    if(!out.IsActive()) return;
+    vector<T>* objects = out();
+    if(!in.IsAvailable()){
+      objects->clear();
+      return;
+    }
+    *objects = *in();
+    for(uint i=0; i<objects->size(); i++) objects->at(i).resetTLV();
+  }
+  // Copy a met collection, the systematics are separate entries
+  template<class T>
+  void copyMet(D3PDReader::VarHandle< vector<T>* >& in, D3PDReader::VarHandle< vector<T>* >& out)
+  {
+    if(!out.IsActive()) return;
+    vector<T>* objects = out();
+    if(!in.IsAvailable()) objects->clear();
+    else *objects = *in();
+  }
+}
+
+/*--------------------------------------------------------------------------------*/
+// SusyNtSkimWriter constructor
+/*--------------------------------------------------------------------------------*/
+SusyNtSkimWriter::SusyNtSkimWriter() :
+        m_file(0),
+        m_tree(0),
+        m_nWritten(0),
+        m_packCutFlags(true)
+{
+}
+/*--------------------------------------------------------------------------------*/
+SusyNtSkimWriter::~SusyNtSkimWriter()
+{
+  close();
+}
+/*--------------------------------------------------------------------------------*/
+// Output file
+/*--------------------------------------------------------------------------------*/
+bool SusyNtSkimWriter::open(const string& fileName, const string& branches)
+{
+  close();
+  m_fileName = fileName;
+  m_nWritten = 0;
+
+  TDirectory* dir = gDirectory;
+  m_file = TFile::Open(fileName.c_str(), "RECREATE");
+  if(m_file == 0 || m_file->IsZombie()){
+    cout << "SusyNtSkimWriter::open ERROR cannot write " << fileName << endl;
+    delete m_file;
+    m_file = 0;
+    if(dir) dir->cd();
+    return false;
+  }
+  m_tree = new TTree("susyNt", "susyNt");
+  if(dir) dir->cd();
+
+  bool ok = true;
+  if(branches.empty()) m_out.SetActive();
+  else ok = m_out.SetActive(branches);
+  m_out.WriteTo(m_tree);
+  return ok;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtSkimWriter::fill(SusyNtObject& in)
+{
+  if(m_tree == 0) return;
+
+  // The event is always written
+  *m_out.evt() = *in.evt();
+  if(m_packCutFlags) m_out.evt()->packCutFlags();
+  copyParticles(in.ele, m_out.ele);
+  copyParticles(in.muo, m_out.muo);
+  copyParticles(in.jet, m_out.jet);
+  copyParticles(in.pho, m_out.pho);
+  copyParticles(in.tau, m_out.tau);
+  copyMet(in.met, m_out.met);
+  copyParticles(in.tpr, m_out.tpr);
+  copyParticles(in.tjt, m_out.tjt);
+  copyMet(in.tmt, m_out.tmt);
+
+  m_tree->Fill();
+  m_nWritten++;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtSkimWriter::close()
+{
+  if(m_file == 0) return;
+  TDirectory* dir = gDirectory == m_file? 0 : gDirectory;
+  m_file->cd();
+  m_tree->Write();
+  m_file->Close();
+  delete m_file;
+  m_file = 0;
+  m_tree = 0;
+  if(dir) dir->cd();
+}
+/*--------------------------------------------------------------------------------*/
+// Merge the parts
+/*--------------------------------------------------------------------------------*/
+bool SusyNtSkimWriter::isCutflowHisto(const string& name)
+{
+  return name == "genCutFlow" || name.find("procCutFlow") == 0;
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtSkimWriter::mergeFiles(const vector<string>& parts, const vector<string>& inputs,
+                                  const string& output)
+{
+  if(parts.empty()){
+    cout << "SusyNtSkimWriter::mergeFiles ERROR no skim to merge into " << output << endl;
+    return false;
+  }
+
+  // The entries, in the order of the parts
+  TFileMerger merger(kFALSE);
+  if(!merger.OutputFile(output.c_str(), "RECREATE")){
+    cout << "SusyNtSkimWriter::mergeFiles ERROR cannot write " << output << endl;
+    return false;
+  }
+  for(uint i=0; i<parts.size(); i++) merger.AddFile(parts[i].c_str(), kFALSE);
+  if(!merger.Merge()){
+    cout << "SusyNtSkimWriter::mergeFiles ERROR merging the parts of " << output << endl;
+    return false;
+  }
+
+  // The normalization histograms of every input, including the files
+  // without any selected entry
+  bool addDir = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(kFALSE);
+  map<string, TH1*> histos;
+  vector<string> order;
+  for(uint iF=0; iF<inputs.size(); iF++){
+    TFile* in = TFile::Open(inputs[iF].c_str());
+    if(in == 0 || in->IsZombie()){
+      cout << "SusyNtSkimWriter::mergeFiles ERROR cannot open " << inputs[iF]
+           << ", the normalization is incomplete" << endl;
+      delete in;
+      continue;
+    }
+    TIter next(in->GetListOfKeys());
+    while(TKey* key = (TKey*) next()){
+      string name = key->GetName();
+      if(!isCutflowHisto(name)) continue;
+      TH1* h = dynamic_cast<TH1*>(key->ReadObj());
+      if(h == 0) continue;
+      if(histos.find(name) == histos.end()){
+        h->SetDirectory(0);
+        histos[name] = h;
+        order.push_back(name);
+      }
+      else{
+        histos[name]->Add(h);
+        delete h;
+      }
+    }
+    in->Close();
+    delete in;
+  }
+  TH1::AddDirectory(addDir);
+
+  TFile* out = TFile::Open(output.c_str(), "UPDATE");
+  bool ok = out != 0 && !out->IsZombie();
+  if(!ok) cout << "SusyNtSkimWriter::mergeFiles ERROR cannot update " << output << endl;
+  else out->cd();
+  for(uint i=0; i<order.size(); i++){
+    if(ok) histos[order[i]]->Write();
+    delete histos[order[i]];
+  }
+  if(out) out->Close();
+  delete out;
+  return ok;
+}
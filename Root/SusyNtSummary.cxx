@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "TFile.h"
+#include "TString.h"
+
+#include "SusyNtuple/SusyNtSummary.h"
+#include "SusyNtuple/SusyNtObject.h"
+#include "SusyNtuple/EventView.h"
+
+using namespace std;
+using namespace Susy;
+
+/*--------------------------------------------------------------------------------*/
+// Reset the summary
+/*--------------------------------------------------------------------------------*/
+void SusyNtSummary::clear()
+{
+  run = event = mcChannel = 0;
+  trigFlags = 0;
+  cutFlags = 0;
+  nEle = nMuo = nTau = nJet = 0;
+  lep0Pt = lep1Pt = jet0Pt = 0;
+  for(int s=0; s<NtSys_N; s++) met[s] = 0;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtSummary::merge(const SusyNtSummary& other)
+{
+  trigFlags |= other.trigFlags;
+  cutFlags  |= other.cutFlags;
+  nEle   = std::max(nEle, other.nEle);
+  nMuo   = std::max(nMuo, other.nMuo);
+  nTau   = std::max(nTau, other.nTau);
+  nJet   = std::max(nJet, other.nJet);
+  lep0Pt = std::max(lep0Pt, other.lep0Pt);
+  lep1Pt = std::max(lep1Pt, other.lep1Pt);
+  jet0Pt = std::max(jet0Pt, other.jet0Pt);
+  for(int s=0; s<NtSys_N; s++) met[s] = std::max(met[s], other.met[s]);
+}
+/*--------------------------------------------------------------------------------*/
+// Fill the summary of the current entry
+/*--------------------------------------------------------------------------------*/
+void SusyNtSummary::fill(SusyNtObject* susyNt, EventView& view)
+{
+  clear();
+  const Event* evt = susyNt->evt();
+  run       = evt->run;
+  event     = evt->event;
+  mcChannel = evt->mcChannel;
+  trigFlags = evt->trigFlags;
+  cutFlags  = evt->cutFlags[NtSys_NOM];
+
+  // Envelope over every systematic, so the counts hold whatever the analysis runs
+  vector<SusyNtSys> allSys;
+  for(int s=0; s<NtSys_N; s++) allSys.push_back((SusyNtSys) s);
+
+  // The muon scale factors depend on the n0150 bug fix, take the max of both
+  view.fill(susyNt, true);
+  view.fillEnvelope(allSys);
+  vector<float> muoPtMax = view.muo.ptMax;
+  view.fill(susyNt, false);
+  view.fillEnvelope(allSys);
+  for(uint i=0; i<muoPtMax.size(); i++) muoPtMax[i] = std::max(muoPtMax[i], view.muo.ptMax[i]);
+
+  nEle = view.ele.cand.size();
+  nTau = view.tau.cand.size();
+  nJet = view.jet.cand.size();
+  for(uint i=0; i<muoPtMax.size(); i++) if(muoPtMax[i] >= MUON_PT_CUT) nMuo++;
+
+  vector<float> lepPts;
+  for(uint k=0; k<view.ele.cand.size(); k++) lepPts.push_back(view.ele.ptMax[view.ele.cand[k]]);
+  for(uint i=0; i<muoPtMax.size(); i++) if(muoPtMax[i] >= MUON_PT_CUT) lepPts.push_back(muoPtMax[i]);
+  for(uint i=0; i<lepPts.size(); i++){
+    if(lepPts[i] > lep0Pt){ lep1Pt = lep0Pt; lep0Pt = lepPts[i]; }
+    else if(lepPts[i] > lep1Pt) lep1Pt = lepPts[i];
+  }
+  for(uint k=0; k<view.jet.cand.size(); k++){
+    float pt = view.jet.ptMax[view.jet.cand[k]];
+    if(pt > jet0Pt) jet0Pt = pt;
+  }
+
+  const vector<Met>* mets = susyNt->met();
+  for(uint i=0; i<mets->size(); i++){
+    int sys = mets->at(i).sys;
+    if(sys >= 0 && sys < NtSys_N) met[sys] = mets->at(i).Et;
+  }
+  // Same as SusyNtAna::selectObjects, JVF has no met variation
+  met[NtSys_JVF_UP] = met[NtSys_NOM];
+  met[NtSys_JVF_DN] = met[NtSys_NOM];
+}
+/*--------------------------------------------------------------------------------*/
+// Tree I/O
+/*--------------------------------------------------------------------------------*/
+void SusyNtSummary::writeTo(TTree* tree)
+{
+  tree->Branch("run",       &run,       "run/i");
+  tree->Branch("event",     &event,     "event/i");
+  tree->Branch("mcChannel", &mcChannel, "mcChannel/i");
+  tree->Branch("trigFlags", &trigFlags, "trigFlags/L");
+  tree->Branch("cutFlags",  &cutFlags,  "cutFlags/i");
+  tree->Branch("nEle",      &nEle,      "nEle/I");
+  tree->Branch("nMuo",      &nMuo,      "nMuo/I");
+  tree->Branch("nTau",      &nTau,      "nTau/I");
+  tree->Branch("nJet",      &nJet,      "nJet/I");
+  tree->Branch("lep0Pt",    &lep0Pt,    "lep0Pt/F");
+  tree->Branch("lep1Pt",    &lep1Pt,    "lep1Pt/F");
+  tree->Branch("jet0Pt",    &jet0Pt,    "jet0Pt/F");
+  tree->Branch("met",       met,        Form("met[%d]/F", NtSys_N));
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtSummary::readFrom(TTree* tree)
+{
+  tree->SetBranchAddress("run",       &run);
+  tree->SetBranchAddress("event",     &event);
+  tree->SetBranchAddress("mcChannel", &mcChannel);
+  tree->SetBranchAddress("trigFlags", &trigFlags);
+  tree->SetBranchAddress("cutFlags",  &cutFlags);
+  tree->SetBranchAddress("nEle",      &nEle);
+  tree->SetBranchAddress("nMuo",      &nMuo);
+  tree->SetBranchAddress("nTau",      &nTau);
+  tree->SetBranchAddress("nJet",      &nJet);
+  tree->SetBranchAddress("lep0Pt",    &lep0Pt);
+  tree->SetBranchAddress("lep1Pt",    &lep1Pt);
+  tree->SetBranchAddress("jet0Pt",    &jet0Pt);
+  tree->SetBranchAddress("met",       met);
+}
+/*--------------------------------------------------------------------------------*/
+// Summary files
+/*--------------------------------------------------------------------------------*/
+string SusyNtSummary::fileName(const string& susyNtFile)
+{
+  const string ext = ".root";
+  string base = susyNtFile;
+  if(base.size() > ext.size() && base.compare(base.size() - ext.size(), ext.size(), ext) == 0)
+    base.erase(base.size() - ext.size());
+  return base + ".summary.root";
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtSummary::makeSummaryFile(const string& susyNtFile, const string& summaryFile)
+{
+  string outName = summaryFile.empty()? fileName(susyNtFile) : summaryFile;
+
+  TFile* inFile = TFile::Open(susyNtFile.c_str());
+  if(inFile == 0 || inFile->IsZombie()){
+    cout << "SusyNtSummary::makeSummaryFile ERROR cannot open " << susyNtFile << endl;
+    delete inFile;
+    return false;
+  }
+  TTree* inTree = (TTree*) inFile->Get("susyNt");
+  if(inTree == 0){
+    cout << "SusyNtSummary::makeSummaryFile ERROR no susyNt tree in " << susyNtFile << endl;
+    delete inFile;
+    return false;
+  }
+
+  TFile* outFile = TFile::Open(outName.c_str(), "RECREATE");
+  if(outFile == 0 || outFile->IsZombie()){
+    cout << "SusyNtSummary::makeSummaryFile ERROR cannot write " << outName << endl;
+    delete outFile;
+    delete inFile;
+    return false;
+  }
+  TTree* outTree = new TTree(treeName(), "SusyNt event summary");
+  SusyNtSummary summary;
+  summary.writeTo(outTree);
+  TTree* zoneTree = new TTree(zoneTreeName(), "SusyNt zone map");
+  SusyNtZone zone;
+  zone.writeTo(zoneTree);
+
+  Long64_t entry = 0;
+  SusyNtObject nt(entry);
+  nt.ReadFrom(inTree);
+  EventView view;
+
+  // One zone per basket cluster, the unit the reading can skip
+  Long64_t nEntries = inTree->GetEntries();
+  TTree::TClusterIterator clusterIter = inTree->GetClusterIterator(0);
+  Long64_t clusterStart;
+  while((clusterStart = clusterIter()) < nEntries){
+    Long64_t clusterEnd = std::min(clusterIter.GetNextEntry(), nEntries);
+    zone.first = clusterStart;
+    zone.n = 0;
+    for(entry=clusterStart; entry<clusterEnd; entry++){
+      inTree->LoadTree(entry);
+      summary.fill(&nt, view);
+      outTree->Fill();
+      if(zone.n++ == 0) zone.max = summary;
+      else zone.max.merge(summary);
+    }
+    if(zone.n) zoneTree->Fill();
+  }
+
+  Long64_t nZones = zoneTree->GetEntries();
+  outFile->cd();
+  outTree->Write();
+  zoneTree->Write();
+  outFile->Close();
+  delete outFile;
+  inFile->Close();
+  delete inFile;
+
+  cout << "SusyNtSummary::makeSummaryFile - " << nEntries << " entries in " << nZones
+       << " zones written to " << outName << endl;
+  return true;
+}
+/*--------------------------------------------------------------------------------*/
+// Zone map
+/*--------------------------------------------------------------------------------*/
+void SusyNtZone::merge(const SusyNtZone& other)
+{
+  if(other.n == 0) return;
+  if(n == 0){ *this = other; return; }
+  Long64_t last = std::max(first + n, other.first + other.n);
+  first = std::min(first, other.first);
+  n = last - first;
+  max.merge(other.max);
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtZone::writeTo(TTree* tree)
+{
+  tree->Branch("firstEntry", &first, "firstEntry/L");
+  tree->Branch("nEntries",   &n,     "nEntries/L");
+  max.writeTo(tree);
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtZone::readFrom(TTree* tree)
+{
+  tree->SetBranchAddress("firstEntry", &first);
+  tree->SetBranchAddress("nEntries",   &n);
+  max.readFrom(tree);
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtZone::readZones(TFile* summaryFile, vector<SusyNtZone>& zones)
+{
+  zones.clear();
+  TTree* zoneTree = summaryFile? (TTree*) summaryFile->Get(SusyNtSummary::zoneTreeName()) : 0;
+  if(zoneTree == 0) return false;
+
+  SusyNtZone zone;
+  zone.readFrom(zoneTree);
+  Long64_t nZones = zoneTree->GetEntries();
+  for(Long64_t i=0; i<nZones; i++){
+    zoneTree->GetEntry(i);
+    zones.push_back(zone);
+  }
+  delete zoneTree;
+  return true;
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtZone::readFileZones(const string& summaryFile, vector<SusyNtZone>& zones)
+{
+  zones.clear();
+  TFile* file = TFile::Open(summaryFile.c_str());
+  if(file == 0 || file->IsZombie()){
+    delete file;
+    return false;
+  }
+  bool ok = readZones(file, zones);
+  file->Close();
+  delete file;
+  return ok;
+}
+/*--------------------------------------------------------------------------------*/
+bool SusyNtZone::readFileZone(const string& summaryFile, SusyNtZone& zone)
+{
+  zone = SusyNtZone();
+  vector<SusyNtZone> zones;
+  bool ok = readFileZones(summaryFile, zones);
+  for(uint i=0; i<zones.size(); i++) zone.merge(zones[i]);
+  return ok;
+}
@@ -1,10 +1,10 @@
-#include <set>
-
 #include "TFile.h"
 #include "TKey.h"
 #include "TChainElement.h"
 #include "TH1F.h"
 #include "TSystem.h"
+#include "TVector2.h"
+#include "TMath.h"
 
 #include "Mt2/mt2_bisect.h" 
 
@@ -15,9 +15,6 @@
 using namespace std;
 using namespace Susy;
 
-// TODO: implement a feature for sharing the tool, rather than making it static
-BTagCalib* SusyNtTools::m_btagTool = NULL;
-
 /*--------------------------------------------------------------------------------*/
 // Constructor
 /*--------------------------------------------------------------------------------*/
@@ -26,8 +23,8 @@ SusyNtTools::SusyNtTools() :
         m_doPtconeCut(true),
         m_doElEtconeCut(true),
         m_doMuEtconeCut(false),
-        m_doIPCut(true)
-	//m_btagTool(NULL)
+        m_doIPCut(true),
+        m_btagTool(NULL)
 {
   m_jvfTool = new JVFUncertaintyTool();
   m_jvfTool->UseGeV(true);
@@ -44,6 +41,7 @@ void SusyNtTools::configureBTagTool(string OP, float opVal, bool isJVF)
   string rootcoredir = getenv("ROOTCOREBIN");
   string calibration = gSystem->ExpandPathName("$ROOTCOREBIN/data/SUSYTools/BTagCalibration.env");
   string calibFolder = gSystem->ExpandPathName("$ROOTCOREBIN/data/SUSYTools/");
+  if(m_btagTool) delete m_btagTool;
   m_btagTool = new BTagCalib("MV1", calibration, calibFolder, OP, isJVF, opVal);
 }
 
@@ -83,6 +81,40 @@ void SusyNtTools::getBaselineObjects(SusyNtObject* susyNt,
   removeSFOSPair(muons, MLL_MIN);
 }
 /*--------------------------------------------------------------------------------*/
+void SusyNtTools::getBaselineObjects(SusyNtObject* susyNt, const EventView& view,
+                                     ElectronVector& preElecs, MuonVector& preMuons, TauVector& preTaus,
+                                     JetVector& preJets,
+                                     ElectronVector& elecs, MuonVector& muons, TauVector& taus, JetVector& jets, 
+                                     SusyNtSys sys, bool selectTaus)
+{
+  // Preselection
+  getPreElectrons(susyNt, view, sys, preElecs);
+  getPreMuons(susyNt, view, sys, preMuons);
+  getPreJets(susyNt, view, sys, preJets);
+  if(selectTaus) getPreTaus(susyNt, view, sys, preTaus);
+  else preTaus.clear();
+
+  getBaselineObjects(preElecs, preMuons, preTaus, preJets, elecs, muons, taus, jets);
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::getBaselineObjects(const ElectronVector& preElecs, const MuonVector& preMuons, 
+                                     const TauVector& preTaus, const JetVector& preJets,
+                                     ElectronVector& elecs, MuonVector& muons, TauVector& taus, JetVector& jets)
+{
+  // Baseline objects
+  elecs = preElecs;
+  muons = preMuons;
+  taus  = preTaus;
+  jets  = preJets;
+
+  // Overlap removal
+  performOverlap(elecs, muons, taus, jets);
+
+  // Remove MSFOS < 12 GeV
+  removeSFOSPair(elecs, MLL_MIN);
+  removeSFOSPair(muons, MLL_MIN);
+}
+/*--------------------------------------------------------------------------------*/
 void SusyNtTools::getBaselineObjects(SusyNtObject* susyNt, ElectronVector& elecs,
                                      MuonVector& muons, TauVector& taus, JetVector& jets, 
                                      SusyNtSys sys, bool selectTaus, bool n0150BugFix)
@@ -115,8 +147,11 @@ void SusyNtTools::getSignalObjects(const ElectronVector& baseElecs, const MuonVe
                                    SusyNtSys sys)
 {
   // Set signal objects
+  // One isolation context for the electrons and the muons
+  if(removeLepsFromIso) buildIsolationContext(baseElecs, baseMuons);
   sigElecs = getSignalElectrons(baseElecs, baseMuons, nVtx, isMC, removeLepsFromIso);
   sigMuons = getSignalMuons(baseMuons, baseElecs, nVtx, isMC, removeLepsFromIso);
+  clearIsolationContext();
   sigTaus  = getSignalTaus(baseTaus, tauJetID, tauEleID, tauMuoID);
   sigJets  = getSignalJets(baseJets, sys);
   sigJets2Lep = getSignalJets2Lep(baseJets, sys);
@@ -132,14 +167,37 @@ void SusyNtTools::getSignalObjects(const ElectronVector& baseElecs, const MuonVe
                                    SusyNtSys sys)
 {
   // Set signal objects
+  // One isolation context for the electrons and the muons
+  if(removeLepsFromIso) buildIsolationContext(baseElecs, baseMuons);
   sigElecs = getSignalElectrons(baseElecs, baseMuons, nVtx, isMC, removeLepsFromIso);
   sigMuons = getSignalMuons(baseMuons, baseElecs, nVtx, isMC, removeLepsFromIso);
+  clearIsolationContext();
   sigJets  = getSignalJets(baseJets, sys);
   sigJets2Lep = getSignalJets2Lep(baseJets, sys);
 
   getSignalTaus(baseTaus, mediumTaus, tightTaus);
 }
 /*--------------------------------------------------------------------------------*/
+void SusyNtTools::getSignalObjects(const EventView& view,
+                                   const ElectronVector& baseElecs, const MuonVector& baseMuons,
+                                   const TauVector& baseTaus, const JetVector& baseJets,
+				   ElectronVector& sigElecs, MuonVector& sigMuons, 
+                                   TauVector& mediumTaus, TauVector& tightTaus,
+                                   JetVector& sigJets, JetVector& sigJets2Lep, 
+                                   uint nVtx, bool isMC, bool removeLepsFromIso, SusyNtSys sys)
+{
+  // Set signal objects
+  // One isolation context for the electrons and the muons
+  if(removeLepsFromIso) buildIsolationContext(baseElecs, baseMuons);
+  getSignalElectrons(baseElecs, baseMuons, nVtx, isMC, removeLepsFromIso, sigElecs);
+  getSignalMuons(baseMuons, baseElecs, nVtx, isMC, removeLepsFromIso, sigMuons);
+  clearIsolationContext();
+  getSignalJets(baseJets, view, sys, sigJets);
+  getSignalJets2Lep(baseJets, view, sys, sigJets2Lep);
+
+  getSignalTaus(baseTaus, mediumTaus, tightTaus);
+}
+/*--------------------------------------------------------------------------------*/
 // This method cannot be used anymore. 
 // Analyzers must store the baseline objects for cleaning cuts!
 /*--------------------------------------------------------------------------------*/
@@ -167,8 +225,184 @@ void SusyNtTools::getSignalObjects(const ElectronVector& baseElecs, const MuonVe
   sigJets2Lep = getSignalJets2Lep(jets);
 }*/
 
+/*--------------------------------------------------------------------------------*/
+namespace
+{
+  /// Survivor bitmask of a collection
+  typedef ULong64_t OverlapMask;
+  const uint OverlapMaskBits = 64;
+
+  inline bool isAlive(OverlapMask mask, uint i) { return mask & (OverlapMask(1) << i); }
+  inline void kill(OverlapMask& mask, uint i) { mask &= ~(OverlapMask(1) << i); }
+  inline OverlapMask allAlive(uint n) { return n==OverlapMaskBits? ~OverlapMask(0) : (OverlapMask(1) << n) - 1; }
+
+  /// Cache the kinematics of a collection, starting at offset
+  template<class T> void cacheKinematics(const std::vector<T*>& objs, uint offset, 
+                                         vector<double>& pt, vector<double>& eta, vector<double>& phi)
+  {
+    for(uint i=0; i<objs.size(); i++){
+      pt[offset+i]  = objs[i]->Pt();
+      eta[offset+i] = objs[i]->Eta();
+      phi[offset+i] = objs[i]->Phi();
+    }
+  }
+
+  /// Delta R of every pair (i1, i2), dr[i1*n2 + i2]. Same arithmetic as TLorentzVector::DeltaR.
+  void fillDeltaR(const double* eta1, const double* phi1, uint n1, 
+                  const double* eta2, const double* phi2, uint n2, double* dr)
+  {
+    for(uint i1=0; i1<n1; i1++){
+      for(uint i2=0; i2<n2; i2++){
+        double deta = eta1[i1] - eta2[i2];
+        double dphi = TVector2::Phi_mpi_pi(phi1[i1] - phi2[i2]);
+        dr[i1*n2 + i2] = TMath::Sqrt(deta*deta + dphi*dphi);
+      }
+    }
+  }
+
+  /// Keep the survivors, in their original order
+  template<class T> void compact(std::vector<T*>& objs, OverlapMask mask)
+  {
+    uint nPass = 0;
+    for(uint i=0; i<objs.size(); i++){
+      if(isAlive(mask, i)) objs[nPass++] = objs[i];
+    }
+    objs.resize(nPass);
+  }
+}
 /*--------------------------------------------------------------------------------*/
 void SusyNtTools::performOverlap(ElectronVector& elecs, MuonVector& muons, TauVector& taus, JetVector& jets)
+{
+  uint nE = elecs.size();
+  uint nM = muons.size();
+  uint nT = taus.size();
+  uint nJ = jets.size();
+  if(nE > OverlapMaskBits || nM > OverlapMaskBits || nT > OverlapMaskBits || nJ > OverlapMaskBits){
+    performOverlapSequential(elecs, muons, taus, jets);
+    return;
+  }
+
+  // Kinematics computed once per object, offsets of each collection
+  uint oE = 0, oM = nE, oT = nE + nM, oJ = nE + nM + nT;
+  uint nAll = oJ + nJ;
+  m_orPt.resize(nAll);
+  m_orEta.resize(nAll);
+  m_orPhi.resize(nAll);
+  cacheKinematics(elecs, oE, m_orPt, m_orEta, m_orPhi);
+  cacheKinematics(muons, oM, m_orPt, m_orEta, m_orPhi);
+  cacheKinematics(taus,  oT, m_orPt, m_orEta, m_orPhi);
+  cacheKinematics(jets,  oJ, m_orPt, m_orEta, m_orPhi);
+  const double* pt  = nAll? &m_orPt[0] : 0;
+  const double* eta = nAll? &m_orEta[0] : 0;
+  const double* phi = nAll? &m_orPhi[0] : 0;
+
+  // Delta R of the pairs checked below, in the same argument order as the pairwise methods
+  uint dEE = 0, dEJ = dEE + nE*nE, dTE = dEJ + nE*nJ, dTM = dTE + nT*nE, dMJ = dTM + nT*nM;
+  uint dEM = dMJ + nM*nJ, dMM = dEM + nE*nM, dTJ = dMM + nM*nM, nDr = dTJ + nT*nJ;
+  m_orDr.resize(nDr);
+  double* dr = nDr? &m_orDr[0] : 0;
+  fillDeltaR(eta+oE, phi+oE, nE, eta+oE, phi+oE, nE, dr+dEE);
+  fillDeltaR(eta+oE, phi+oE, nE, eta+oJ, phi+oJ, nJ, dr+dEJ);
+  fillDeltaR(eta+oT, phi+oT, nT, eta+oE, phi+oE, nE, dr+dTE);
+  fillDeltaR(eta+oT, phi+oT, nT, eta+oM, phi+oM, nM, dr+dTM);
+  fillDeltaR(eta+oM, phi+oM, nM, eta+oJ, phi+oJ, nJ, dr+dMJ);
+  fillDeltaR(eta+oE, phi+oE, nE, eta+oM, phi+oM, nM, dr+dEM);
+  fillDeltaR(eta+oM, phi+oM, nM, eta+oM, phi+oM, nM, dr+dMM);
+  fillDeltaR(eta+oT, phi+oT, nT, eta+oJ, phi+oJ, nJ, dr+dTJ);
+
+  OverlapMask aliveE = allAlive(nE);
+  OverlapMask aliveM = allAlive(nM);
+  OverlapMask aliveT = allAlive(nT);
+  OverlapMask aliveJ = allAlive(nJ);
+
+  // Remove electrons from electrons, the softer one goes (see e_e_overlap)
+  OverlapMask removeE = 0;
+  for(uint i=0; i<nE; i++){
+    for(uint j=i+1; j<nE; j++){
+      if(dr[dEE + i*nE + j] < E_E_DR){
+        if(pt[oE+i] < pt[oE+j]){
+          removeE |= OverlapMask(1) << i;
+          break;
+        }
+        else removeE |= OverlapMask(1) << j;
+      }
+    }
+  }
+  aliveE &= ~removeE;
+
+  // Remove jets from electrons. The object-jet checks are written as !(dR > cut)
+  // like in e_j_overlap and m_j_overlap.
+  for(uint j=0; j<nJ; j++){
+    for(uint e=0; e<nE; e++){
+      if(isAlive(aliveE, e) && !(dr[dEJ + e*nJ + j] > J_E_DR)){ kill(aliveJ, j); break; }
+    }
+  }
+  // Remove taus from electrons
+  for(uint t=0; t<nT; t++){
+    for(uint e=0; e<nE; e++){
+      if(isAlive(aliveE, e) && dr[dTE + t*nE + e] < T_E_DR){ kill(aliveT, t); break; }
+    }
+  }
+  // Remove taus from muons
+  for(uint t=0; t<nT; t++){
+    if(!isAlive(aliveT, t)) continue;
+    for(uint m=0; m<nM; m++){
+      if(isAlive(aliveM, m) && dr[dTM + t*nM + m] < T_M_DR){ kill(aliveT, t); break; }
+    }
+  }
+  // Remove electrons from jets
+  for(uint e=0; e<nE; e++){
+    if(!isAlive(aliveE, e)) continue;
+    for(uint j=0; j<nJ; j++){
+      if(isAlive(aliveJ, j) && !(dr[dEJ + e*nJ + j] > E_J_DR)){ kill(aliveE, e); break; }
+    }
+  }
+  // Remove muons from jets
+  for(uint m=0; m<nM; m++){
+    for(uint j=0; j<nJ; j++){
+      if(isAlive(aliveJ, j) && !(dr[dMJ + m*nJ + j] > M_J_DR)){ kill(aliveM, m); break; }
+    }
+  }
+  // Remove electrons and muons that overlap, both of them
+  OverlapMask removeEm = 0, removeMe = 0;
+  for(uint e=0; e<nE; e++){
+    if(!isAlive(aliveE, e)) continue;
+    for(uint m=0; m<nM; m++){
+      if(isAlive(aliveM, m) && dr[dEM + e*nM + m] < E_M_DR){
+        removeEm |= OverlapMask(1) << e;
+        removeMe |= OverlapMask(1) << m;
+      }
+    }
+  }
+  aliveE &= ~removeEm;
+  aliveM &= ~removeMe;
+  // Remove muons from muons, both of them
+  OverlapMask removeM = 0;
+  for(uint i=0; i<nM; i++){
+    if(!isAlive(aliveM, i)) continue;
+    for(uint j=i+1; j<nM; j++){
+      if(isAlive(aliveM, j) && dr[dMM + i*nM + j] < M_M_DR){
+        removeM |= OverlapMask(1) << i;
+        removeM |= OverlapMask(1) << j;
+      }
+    }
+  }
+  aliveM &= ~removeM;
+  // Remove jets from taus
+  for(uint j=0; j<nJ; j++){
+    if(!isAlive(aliveJ, j)) continue;
+    for(uint t=0; t<nT; t++){
+      if(isAlive(aliveT, t) && dr[dTJ + t*nJ + j] < J_T_DR){ kill(aliveJ, j); break; }
+    }
+  }
+
+  compact(elecs, aliveE);
+  compact(muons, aliveM);
+  compact(taus, aliveT);
+  compact(jets, aliveJ);
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::performOverlapSequential(ElectronVector& elecs, MuonVector& muons, TauVector& taus, JetVector& jets)
 {
   // Remove electrons from electrons
   e_e_overlap(elecs, E_E_DR);
@@ -257,6 +491,124 @@ JetVector SusyNtTools::getPreJets(SusyNtObject* susyNt, SusyNtSys sys)
   return jets;
 }
 
+/*--------------------------------------------------------------------------------*/
+// Baseline objects from the EventView table
+/*--------------------------------------------------------------------------------*/
+ElectronVector SusyNtTools::getPreElectrons(SusyNtObject* susyNt, const EventView& view, SusyNtSys sys)
+{
+  ElectronVector elecs;
+  getPreElectrons(susyNt, view, sys, elecs);
+  return elecs;
+}
+/*--------------------------------------------------------------------------------*/
+MuonVector SusyNtTools::getPreMuons(SusyNtObject* susyNt, const EventView& view, SusyNtSys sys)
+{
+  MuonVector muons;
+  getPreMuons(susyNt, view, sys, muons);
+  return muons;
+}
+/*--------------------------------------------------------------------------------*/
+TauVector SusyNtTools::getPreTaus(SusyNtObject* susyNt, const EventView& view, SusyNtSys sys)
+{
+  TauVector taus;
+  getPreTaus(susyNt, view, sys, taus);
+  return taus;
+}
+/*--------------------------------------------------------------------------------*/
+JetVector SusyNtTools::getPreJets(SusyNtObject* susyNt, const EventView& view, SusyNtSys sys)
+{
+  JetVector jets;
+  getPreJets(susyNt, view, sys, jets);
+  return jets;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::getPreElectrons(SusyNtObject* susyNt, const EventView& view, SusyNtSys sys, 
+                                  ElectronVector& elecs)
+{
+  elecs.clear();
+  selectByPt(view.ele, sys, ELECTRON_PT_CUT, m_viewIdx);
+  for(uint i=0; i<m_viewIdx.size(); i++){
+    Electron* e = & susyNt->ele()->at(m_viewIdx[i]);
+    view.ele.setP4(*e, sys, m_viewIdx[i]);
+    elecs.push_back(e);
+  }
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::getPreMuons(SusyNtObject* susyNt, const EventView& view, SusyNtSys sys, 
+                              MuonVector& muons)
+{
+  muons.clear();
+  selectByPt(view.muo, sys, MUON_PT_CUT, m_viewIdx);
+  for(uint i=0; i<m_viewIdx.size(); i++){
+    Muon* mu = & susyNt->muo()->at(m_viewIdx[i]);
+    view.muo.setP4(*mu, sys, m_viewIdx[i]);
+    muons.push_back(mu);
+  }
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::getPreTaus(SusyNtObject* susyNt, const EventView& view, SusyNtSys sys, 
+                             TauVector& taus)
+{
+  taus.clear();
+  selectByPt(view.tau, sys, TAU_PT_CUT, m_viewIdx);
+  for(uint i=0; i<m_viewIdx.size(); i++){
+    Tau* tau = & susyNt->tau()->at(m_viewIdx[i]);
+    view.tau.setP4(*tau, sys, m_viewIdx[i]);
+    // The BDT part of the selection still needs the object
+    if(isSelectTau(tau)) taus.push_back(tau);
+  }
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::getPreJets(SusyNtObject* susyNt, const EventView& view, SusyNtSys sys, 
+                             JetVector& jets)
+{
+  jets.clear();
+  selectByPt(view.jet, sys, JET_PT_CUT, m_viewIdx);
+  for(uint i=0; i<m_viewIdx.size(); i++){
+    Jet* j = & susyNt->jet()->at(m_viewIdx[i]);
+    view.jet.setP4(*j, sys, m_viewIdx[i]);
+    jets.push_back(j);
+  }
+}
+/*--------------------------------------------------------------------------------*/
+// Column based cuts
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::selectByPt(const ObjectColumns& c, SusyNtSys sys, float minPt, vector<uint>& idx)
+{
+  idx.clear();
+  uint n = c.size();
+  const float* pt = n? &c.pt[0] : 0;
+  const float* sf = n? &c.sf[sys*n] : 0;
+  // Objects failing the cut in every systematic of the envelope are skipped
+  if(c.inEnvelope(sys, minPt)){
+    for(uint k=0; k<c.cand.size(); k++){
+      uint i = c.cand[k];
+      if(sf[i]*pt[i] >= minPt) idx.push_back(i);
+    }
+    return;
+  }
+  for(uint i=0; i<n; i++){
+    if(sf[i]*pt[i] >= minPt) idx.push_back(i);
+  }
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::selectByPtEta(const ObjectColumns& c, SusyNtSys sys, float minPt, float maxAbsEta,
+                                vector<uint>& idx)
+{
+  idx.clear();
+  if(c.inEnvelope(sys, minPt)){
+    for(uint k=0; k<c.cand.size(); k++){
+      uint i = c.cand[k];
+      if(c.ptSys(sys, i) >= minPt && fabs(c.eta[i]) <= maxAbsEta) idx.push_back(i);
+    }
+    return;
+  }
+  uint n = c.size();
+  for(uint i=0; i<n; i++){
+    if(c.ptSys(sys, i) >= minPt && fabs(c.eta[i]) <= maxAbsEta) idx.push_back(i);
+  }
+}
+
 /*--------------------------------------------------------------------------------*/
 // Get Signal objects
 /*--------------------------------------------------------------------------------*/
@@ -264,28 +616,47 @@ ElectronVector SusyNtTools::getSignalElectrons(const ElectronVector& baseElecs,
                                                uint nVtx, bool isMC, bool removeLepsFromIso)
 {
   ElectronVector sigElecs;
+  getSignalElectrons(baseElecs, baseMuons, nVtx, isMC, removeLepsFromIso, sigElecs);
+  return sigElecs;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::getSignalElectrons(const ElectronVector& baseElecs, const MuonVector& baseMuons, 
+                                     uint nVtx, bool isMC, bool removeLepsFromIso, ElectronVector& sigElecs)
+{
+  sigElecs.clear();
+  // Called on its own, the selection fills its own isolation context
+  bool ownIso = removeLepsFromIso && !m_isoCtx.isValid();
+  if(ownIso) buildIsolationContext(baseElecs, baseMuons);
   for(uint ie=0; ie<baseElecs.size(); ++ie){
     Electron* e = baseElecs.at(ie);
     if(isSignalElectron(e, baseElecs, baseMuons, nVtx, isMC, removeLepsFromIso)){
       sigElecs.push_back(e);
     }
   }
-
-  return sigElecs;
+  if(ownIso) clearIsolationContext();
 }
 /*--------------------------------------------------------------------------------*/
 MuonVector SusyNtTools::getSignalMuons(const MuonVector& baseMuons, const ElectronVector& baseElecs, 
                                        uint nVtx, bool isMC, bool removeLepsFromIso)
 {
   MuonVector sigMuons;
+  getSignalMuons(baseMuons, baseElecs, nVtx, isMC, removeLepsFromIso, sigMuons);
+  return sigMuons;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::getSignalMuons(const MuonVector& baseMuons, const ElectronVector& baseElecs, 
+                                 uint nVtx, bool isMC, bool removeLepsFromIso, MuonVector& sigMuons)
+{
+  sigMuons.clear();
+  bool ownIso = removeLepsFromIso && !m_isoCtx.isValid();
+  if(ownIso) buildIsolationContext(baseElecs, baseMuons);
   for(uint im=0; im<baseMuons.size(); ++im){
     Muon* mu = baseMuons.at(im);
     if(isSignalMuon(mu, baseElecs, baseMuons, nVtx, isMC, removeLepsFromIso)){
       sigMuons.push_back(mu);
     }
   }
-
-  return sigMuons;
+  if(ownIso) clearIsolationContext();
 }
 /*--------------------------------------------------------------------------------*/
 TauVector SusyNtTools::getSignalTaus(const TauVector& baseTaus, TauID tauJetID, TauID tauEleID, TauID tauMuoID)
@@ -339,6 +710,50 @@ JetVector SusyNtTools::getSignalJets2Lep(const JetVector& baseJets, SusyNtSys sy
   return sigJets;
 }
 /*--------------------------------------------------------------------------------*/
+JetVector SusyNtTools::getSignalJets(const JetVector& baseJets, const EventView& view, SusyNtSys sys)
+{
+  JetVector sigJets;
+  getSignalJets(baseJets, view, sys, sigJets);
+  return sigJets;
+}
+/*--------------------------------------------------------------------------------*/
+JetVector SusyNtTools::getSignalJets2Lep(const JetVector& baseJets, const EventView& view, SusyNtSys sys)
+{
+  JetVector sigJets;
+  getSignalJets2Lep(baseJets, view, sys, sigJets);
+  return sigJets;
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::getSignalJets(const JetVector& baseJets, const EventView& view, SusyNtSys sys, 
+                                JetVector& sigJets)
+{
+  sigJets.clear();
+  for(uint ij=0; ij<baseJets.size(); ++ij){
+    Jet* j = baseJets.at(ij);
+    uint i = view.index(j);
+    // Kinematic cuts on the table, the JVF requirement needs the object
+    if(view.jet.ptSys(sys, i) <= JET_SIGNAL_PT_CUT_3L || fabs(view.jet.eta[i]) >= JET_ETA_CUT) continue;
+    if(isSignalJet(j, sys)){
+      sigJets.push_back(j);
+    }
+  }
+}
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::getSignalJets2Lep(const JetVector& baseJets, const EventView& view, SusyNtSys sys, 
+                                    JetVector& sigJets)
+{
+  sigJets.clear();
+  for(uint ij=0; ij<baseJets.size(); ++ij){
+    Jet* j = baseJets.at(ij);
+    uint i = view.index(j);
+    // All 2L jet categories are within the forward acceptance
+    if(fabs(view.jetDetEta[i]) > JET_ETA_MAX_CUT) continue;
+    if(isSignalJet2Lep(j, sys)){
+      sigJets.push_back(j);
+    }
+  }
+}
+/*--------------------------------------------------------------------------------*/
 PhotonVector SusyNtTools::getSignalPhotons(SusyNtObject* susyNt)
 {
   // Currently only storing signal photons, so just a conv way to get them.
@@ -466,9 +881,14 @@ bool SusyNtTools::isSignalElectron(const Electron* ele,
 
   float pt = ele->Pt();
 
+  // The nearby lepton subtraction uses the pairs precomputed by the selection, if any
+  const IsolationContext* iso = removeLepsFromIso && m_isoCtx.isValid()? &m_isoCtx : 0;
+  int iLep = iso? iso->index(ele) : -1;
+
   // Relative ptcone iso
   if(m_doPtconeCut){ // true by default
-    float ptcone30 = elPtConeCorr(ele, baseElectrons, baseMuons, nVtx, isMC, removeLepsFromIso);
+    float ptcone30 = iLep>=0? elPtConeCorr(*iso, iLep, nVtx, isMC) :
+                              elPtConeCorr(ele, baseElectrons, baseMuons, nVtx, isMC, removeLepsFromIso);
     if(m_anaType == Ana_2LepWH){
       if(ptcone30/std::min(pt,ELECTRON_ISO_PT_THRS) >=  ELECTRON_PTCONE30_PT_WH_CUT) return false;
     }
@@ -478,7 +898,8 @@ bool SusyNtTools::isSignalElectron(const Electron* ele,
 
   // Topo etcone isolation cut
   if(m_doElEtconeCut){ // true by default
-    float etcone = elEtTopoConeCorr(ele, baseElectrons, baseMuons, nVtx, isMC, removeLepsFromIso);
+    float etcone = iLep>=0? elEtTopoConeCorr(*iso, iLep, nVtx, isMC) :
+                            elEtTopoConeCorr(ele, baseElectrons, baseMuons, nVtx, isMC, removeLepsFromIso);
      if(m_anaType == Ana_2LepWH){
        if(etcone/std::min(pt,ELECTRON_ISO_PT_THRS) >= ELECTRON_TOPOCONE30_PT_WH_CUT) return false;
      }
@@ -503,10 +924,15 @@ bool SusyNtTools::isSignalMuon(const Muon* mu,
     if(fabs(mu->z0SinTheta(true)) >= MUON_Z0_SINTHETA_CUT) return false;
   }
 
+  // The nearby lepton subtraction uses the pairs precomputed by the selection, if any
+  const IsolationContext* iso = removeLepsFromIso && m_isoCtx.isValid()? &m_isoCtx : 0;
+  int iLep = iso? iso->index(mu) : -1;
+
   // ptcone isolation cut with pileup correction
   if(m_doPtconeCut){ // true by default
     if(m_anaType == Ana_3Lep){
-      float ptcone30 = muPtConeCorr(mu, baseElectrons, baseMuons, nVtx, isMC, removeLepsFromIso);
+      float ptcone30 = iLep>=0? muPtConeCorr(*iso, iLep, nVtx, isMC) :
+                                muPtConeCorr(mu, baseElectrons, baseMuons, nVtx, isMC, removeLepsFromIso);
       if(ptcone30/mu->Pt() >= MUON_PTCONE30_PT_CUT) return false;
     }
     else{
@@ -522,10 +948,12 @@ bool SusyNtTools::isSignalMuon(const Muon* mu,
 
   // etcone isolation cut - not applied by default, but here for studies
   if(m_doMuEtconeCut){ // FALSE by default
-    float etcone30 = muEtConeCorr(mu, baseElectrons, baseMuons, nVtx, isMC, removeLepsFromIso);
+    float etcone30 = iLep>=0? muEtConeCorr(*iso, iLep, nVtx, isMC) :
+                              muEtConeCorr(mu, baseElectrons, baseMuons, nVtx, isMC, removeLepsFromIso);
     if(m_doMuEtconeCut && etcone30/mu->Pt() >= MUON_ETCONE30_PT_CUT) return false;
   } else if(m_anaType == Ana_2LepWH) {
-    float etcone30 = muEtConeCorr(mu, baseElectrons, baseMuons, nVtx, isMC, removeLepsFromIso);
+    float etcone30 = iLep>=0? muEtConeCorr(*iso, iLep, nVtx, isMC) :
+                              muEtConeCorr(mu, baseElectrons, baseMuons, nVtx, isMC, removeLepsFromIso);
     float pt = mu->Pt();
     if(pt==0.0 || (etcone30/std::min(pt,MUON_ISO_PT_THRS) >= MUON_ETCONE30_PT_WH_CUT)) return false;    
   }
@@ -646,6 +1074,82 @@ float SusyNtTools::muEtConeCorr(const Muon* mu,
   return etcone;
 }
 
+/*--------------------------------------------------------------------------------*/
+// Isolation corrections from the isolation context
+// Same loops as above, with the delta R and semi-signal flags looked up
+/*--------------------------------------------------------------------------------*/
+void SusyNtTools::buildIsolationContext(const ElectronVector& baseElectrons, const MuonVector& baseMuons)
+{
+  m_isoCtx.fill(baseElectrons, baseMuons);
+  for(uint iEl=0; iEl<baseElectrons.size(); iEl++){
+    const Electron* e = baseElectrons[iEl];
+    m_isoCtx.semiSignal[iEl] = isSemiSignalElectron(e);
+    m_isoCtx.clusEt[iEl] = e->clusE / cosh(e->clusEta);
+  }
+  for(uint iMu=0; iMu<baseMuons.size(); iMu++){
+    m_isoCtx.semiSignal[m_isoCtx.muoIndex(iMu)] = isSemiSignalMuon(baseMuons[iMu]);
+  }
+}
+/*--------------------------------------------------------------------------------*/
+float SusyNtTools::elPtConeCorr(const IsolationContext& iso, uint iLep, uint /*nVtx*/, bool /*isMC*/)
+{
+  float ptcone = iso.ele(iLep)->ptcone30;
+  for(uint iEl=0; iEl<iso.nEle(); iEl++){
+    if(iEl==iLep) continue;
+    if( !iso.semiSignal[iEl] ) continue;
+    if(iso.dR(iLep, iEl) < 0.3) ptcone -= iso.ele(iEl)->trackPt;
+  }
+  for(uint iMu=0; iMu<iso.nMuo(); iMu++){
+    uint jLep = iso.muoIndex(iMu);
+    if( !iso.semiSignal[jLep] ) continue;
+    if(iso.dR(iLep, jLep) < 0.3) ptcone -= iso.muo(iMu)->idTrackPt;
+  }
+  return ptcone;
+}
+/*--------------------------------------------------------------------------------*/
+float SusyNtTools::elEtTopoConeCorr(const IsolationContext& iso, uint iLep, uint nVtx, bool isMC)
+{
+  float slope = isMC? ELECTRON_TOPOCONE30_SLOPE_MC : ELECTRON_TOPOCONE30_SLOPE_DATA;
+  float etcone = iso.ele(iLep)->topoEtcone30Corr - slope*nVtx;
+  for(uint iEl=0; iEl<iso.nEle(); iEl++){
+    if(iEl==iLep) continue;
+    if( !iso.semiSignal[iEl] ) continue;
+    if(iso.dR(iLep, iEl) < 0.28) etcone -= iso.clusEt[iEl];
+  }
+  return etcone;
+}
+/*--------------------------------------------------------------------------------*/
+float SusyNtTools::muPtConeCorr(const IsolationContext& iso, uint iLep, uint nVtx, bool isMC)
+{
+  const Muon* mu = iso.muo(iLep - iso.nEle());
+  float slope = isMC? MUON_PTCONE30_SLOPE_MC : MUON_PTCONE30_SLOPE_DATA;
+  float ptcone = mu->ptcone30 - slope*nVtx;
+  for(uint iEl=0; iEl<iso.nEle(); iEl++){
+    if( !iso.semiSignal[iEl] ) continue;
+    if(iso.dR(iLep, iEl) < 0.3) ptcone -= iso.ele(iEl)->trackPt;
+  }
+  for(uint iMu=0; iMu<iso.nMuo(); iMu++){
+    uint jLep = iso.muoIndex(iMu);
+    if(jLep==iLep) continue;
+    if( !iso.semiSignal[jLep] ) continue;
+    if(iso.dR(iLep, jLep) < 0.3) ptcone -= iso.muo(iMu)->idTrackPt;
+  }
+  return ptcone;
+}
+/*--------------------------------------------------------------------------------*/
+float SusyNtTools::muEtConeCorr(const IsolationContext& iso, uint iLep, uint nVtx, bool isMC)
+{
+  const Muon* mu = iso.muo(iLep - iso.nEle());
+  float k1 = isMC? MUON_ETCONE30_K1_MC : MUON_ETCONE30_K1_DATA;
+  float k2 = isMC? MUON_ETCONE30_K2_MC : MUON_ETCONE30_K2_DATA;
+  float etcone = mu->etcone30 - k1*nVtx - k2*nVtx*nVtx;
+  for(uint iEl=0; iEl<iso.nEle(); iEl++){
+    if( !iso.semiSignal[iEl] ) continue;
+    if(iso.dR(iLep, iEl) < 0.28) etcone -= iso.clusEt[iEl];
+  }
+  return etcone;
+}
+
 /*--------------------------------------------------------------------------------*/
 // Signal jet selection
 /*--------------------------------------------------------------------------------*/
@@ -823,19 +1327,18 @@ void SusyNtTools::e_e_overlap(ElectronVector& elecs, float minDr)
   if(nEl < 2) return;
 
   // Find all possible pairings
-  static std::set<const Electron*> removeElecs;
-  removeElecs.clear();
+  m_removeEle.assign(nEl, 0);
   for(uint iEl=0; iEl<nEl; iEl++){
     const Electron* e1 = elecs[iEl];
     for(uint jEl=iEl+1; jEl<nEl; jEl++){
       const Electron* e2 = elecs[jEl];
       if(e1->DeltaR(*e2) < minDr){
         if(e1->Pt() < e2->Pt()){
-          removeElecs.insert(e1);
+          m_removeEle[iEl] = 1;
           break;
         }
         else{
-          removeElecs.insert(e2);
+          m_removeEle[jEl] = 1;
         }
       } // dR
     } // e2 loop
@@ -843,7 +1346,7 @@ void SusyNtTools::e_e_overlap(ElectronVector& elecs, float minDr)
 
   // Remove electrons that overlap
   for(int iEl=nEl-1; iEl>=0; iEl--){
-    if(removeElecs.find(elecs[iEl]) != removeElecs.end()){
+    if(m_removeEle[iEl]){
       elecs.erase( elecs.begin() + iEl );
     }
   }
@@ -870,7 +1373,7 @@ void SusyNtTools::e_j_overlap(ElectronVector& elecs, JetVector& jets, float minD
   }// end loop over electrons	  
 }
 /*--------------------------------------------------------------------------------*/
-void SusyNtTools::m_j_overlap(MuonVector& muons, JetVector jets, float minDr)
+void SusyNtTools::m_j_overlap(MuonVector& muons, const JetVector& jets, float minDr)
 {
   if(muons.size()==0 || jets.size()==0) return;
 
@@ -895,10 +1398,9 @@ void SusyNtTools::e_m_overlap(ElectronVector& elecs, MuonVector& muons, float mi
 
   // Electron muon overlap should be pretty rare,
   // so we can take advantage of that and optimize
-  static std::set<const Electron*> removeElecs;
-  static std::set<const Muon*> removeMuons;
-  removeElecs.clear();
-  removeMuons.clear();
+  bool removeAny = false;
+  m_removeEle.assign(nEl, 0);
+  m_removeMuo.assign(nMu, 0);
 
   // In this case we will want to remove both the electron and the muon
   for(uint iEl=0; iEl<nEl; iEl++){
@@ -906,26 +1408,24 @@ void SusyNtTools::e_m_overlap(ElectronVector& elecs, MuonVector& muons, float mi
     for(uint iMu=0; iMu<nMu; iMu++){
       const Muon* mu = muons[iMu];
       if(e->DeltaR(*mu) < minDr){
-        removeElecs.insert(e);
-        removeMuons.insert(mu);
+        m_removeEle[iEl] = 1;
+        m_removeMuo[iMu] = 1;
+        removeAny = true;
       }
     }
   }
+  if(!removeAny) return;
 
   // Remove those electrons flagged for removal
-  if(removeElecs.size()){
-    for(int iEl=nEl-1; iEl>=0; iEl--){
-      if(removeElecs.find(elecs[iEl])!=removeElecs.end()){
-        elecs.erase( elecs.begin() + iEl );
-      }
+  for(int iEl=nEl-1; iEl>=0; iEl--){
+    if(m_removeEle[iEl]){
+      elecs.erase( elecs.begin() + iEl );
     }
   }
   // Remove those muons flagged for removal
-  if(removeMuons.size()){
-    for(int iMu=nMu-1; iMu>=0; iMu--){
-      if(removeMuons.find(muons[iMu])!=removeMuons.end()){
-        muons.erase( muons.begin() + iMu );
-      }
+  for(int iMu=nMu-1; iMu>=0; iMu--){
+    if(m_removeMuo[iMu]){
+      muons.erase( muons.begin() + iMu );
     }
   }
 }
@@ -936,21 +1436,19 @@ void SusyNtTools::m_m_overlap(MuonVector& muons, float minDr)
   if(nMu < 2) return;
 
   // If 2 muons overlap, toss them both!
-  static std::set<const Muon*> removeMuons;
-  removeMuons.clear();
+  m_removeMuo.assign(nMu, 0);
   for(uint iMu=0; iMu<nMu; iMu++){
     const Muon* mu1 = muons[iMu];
     for(uint jMu=iMu+1; jMu<nMu; jMu++){
       const Muon* mu2 = muons[jMu];
       if(mu1->DeltaR(*mu2) < minDr){
-        removeMuons.insert(mu1);
-        removeMuons.insert(mu2);
+        m_removeMuo[iMu] = 1;
+        m_removeMuo[jMu] = 1;
       }
     }
   }
   for(int iMu=nMu-1; iMu>=0; iMu--){
-    const Muon* mu = muons[iMu];
-    if(removeMuons.find(mu) != removeMuons.end()){
+    if(m_removeMuo[iMu]){
       muons.erase( muons.begin() + iMu );
     }
   }
@@ -1029,25 +1527,28 @@ void SusyNtTools::removeSFOSPair(ElectronVector& elecs, float MllCut)
   if(nEle < 2) return;
 
   // Now removing all combinations of SFOS pairs with mll < cut
-  ElectronVector electronsPass;
+  // Flag first, all pairs are checked against the original list
+  m_removeEle.assign(nEle, 0);
 
   // Use a double loop to check all combinatorics
   for(uint i=0; i<nEle; i++){
     Electron* e1 = elecs[i];
-    bool pass = true;
     for(uint j=0; j<nEle; j++){
       if(i==j) continue;
       Electron* e2 = elecs[j];
       if(isSFOS(e1,e2) && Mll(e1,e2) < MllCut){
-        pass = false;
+        m_removeEle[i] = 1;
         break;
       }
     }
-    if(pass) electronsPass.push_back(e1);
   }
 
-  // Now replace the supplied vector with this cleaned vector
-  elecs = electronsPass;
+  // Now compact the supplied vector in place
+  uint nPass = 0;
+  for(uint i=0; i<nEle; i++){
+    if(!m_removeEle[i]) elecs[nPass++] = elecs[i];
+  }
+  elecs.resize(nPass);
 }
 /*--------------------------------------------------------------------------------*/
 void SusyNtTools::removeSFOSPair(MuonVector& muons, float MllCut)
@@ -1056,25 +1557,28 @@ void SusyNtTools::removeSFOSPair(MuonVector& muons, float MllCut)
   if(nMu < 2) return;
 
   // Now removing all combinations of SFOS pairs with mll < cut
-  MuonVector muonsPass;
+  // Flag first, all pairs are checked against the original list
+  m_removeMuo.assign(nMu, 0);
 
   // Use a double loop to check all combinatorics
   for(uint i=0; i<nMu; i++){
     Muon* m1 = muons[i];
-    bool pass = true;
     for(uint j=0; j<nMu; j++){
       if(i==j) continue;
       Muon* m2 = muons[j];
       if(isSFOS(m1,m2) && Mll(m1,m2) < MllCut){
-        pass = false;
+        m_removeMuo[i] = 1;
         break;
       }
     }
-    if(pass) muonsPass.push_back(m1);
   }
 
-  // Now replace the supplied vector with this cleaned vector
-  muons = muonsPass;
+  // Now compact the supplied vector in place
+  uint nPass = 0;
+  for(uint i=0; i<nMu; i++){
+    if(!m_removeMuo[i]) muons[nPass++] = muons[i];
+  }
+  muons.resize(nPass);
 }
 /*--------------------------------------------------------------------------------*/
 void SusyNtTools::removeSFOSPair(TauVector& taus, float MllCut)
@@ -1083,25 +1587,28 @@ void SusyNtTools::removeSFOSPair(TauVector& taus, float MllCut)
   if(nTau < 2) return;
 
   // Now removing all combinations of SFOS pairs with mll < cut
-  TauVector tausPass;
+  // Flag first, all pairs are checked against the original list
+  m_removeTau.assign(nTau, 0);
 
   // Use a double loop to check all combinatorics
   for(uint i=0; i<nTau; i++){
     Tau* t1 = taus[i];
-    bool pass = true;
     for(uint j=0; j<nTau; j++){
       if(i==j) continue;
       Tau* t2 = taus[j];
       if(isOppSign(t1,t2) && Mll(t1,t2) < MllCut){
-        pass = false;
+        m_removeTau[i] = 1;
         break;
       }
     }
-    if(pass) tausPass.push_back(t1);
   }
 
-  // Now replace the supplied vector with this cleaned vector
-  taus = tausPass;
+  // Now compact the supplied vector in place
+  uint nPass = 0;
+  for(uint i=0; i<nTau; i++){
+    if(!m_removeTau[i]) taus[nPass++] = taus[i];
+  }
+  taus.resize(nPass);
 }
 /*--------------------------------------------------------------------------------*/
 bool SusyNtTools::eventHasSusyPropagators(const std::vector< int > &pdgs,
@@ -1597,28 +2104,24 @@ float SusyNtTools::bTagSF(const Event* evt, const JetVector& jets, int mcID, BTa
   }
 
   static const float MEV = 1000;
-  static vector<float>  pt_btag;
-  static vector<float> eta_btag;
-  static vector<float> val_btag;
-  static vector<int> pdgid_btag;
-  pt_btag.clear();
-  eta_btag.clear();
-  val_btag.clear();
-  pdgid_btag.clear();
+  m_btagPt.clear();
+  m_btagEta.clear();
+  m_btagVal.clear();
+  m_btagPdgId.clear();
 
   bool isSherpa = isSherpaSample(mcID);
 
   uint nJet = jets.size();
   for(uint i=0; i<nJet; i++){
-    pt_btag.push_back(  jets[i]->Pt()*MEV ); 
-    eta_btag.push_back( jets[i]->Eta()    ); 
-    val_btag.push_back( jets[i]->mv1      ); //Assume MV1 as input always
-    pdgid_btag.push_back(jets[i]->truthLabel);
+    m_btagPt.push_back(   jets[i]->Pt()*MEV ); 
+    m_btagEta.push_back(  jets[i]->Eta()    ); 
+    m_btagVal.push_back(  jets[i]->mv1      ); //Assume MV1 as input always
+    m_btagPdgId.push_back(jets[i]->truthLabel);
   }
 
   pair< vector<float>, vector<float> > wgtbtag = 
-    m_btagTool->BTagCalibrationFunction(pt_btag, eta_btag,
-                                        val_btag, pdgid_btag,
+    m_btagTool->BTagCalibrationFunction(m_btagPt, m_btagEta,
+                                        m_btagVal, m_btagPdgId,
                                         isSherpa);
   
   if( sys == BTag_BJet_DN ) return wgtbtag.first.at(1);  
@@ -6,10 +6,18 @@
 
 namespace D3PDReader {
 
+#ifdef ACTIVATE_BRANCHES
+   ::Bool_t VarHandleBase::fgActivateBranches = kTRUE;
+#else
+   ::Bool_t VarHandleBase::fgActivateBranches = kFALSE;
+#endif // ACTIVATE_BRANCHES
+
    VarHandleBase::VarHandleBase( ::TObject* parent, const char* name,
                                  const ::Long64_t* master )
       : fMaster( master ), fParent( parent ), fFromInput( kFALSE ),
-        fInTree( 0 ), fInBranch( 0 ), fAvailable( UNKNOWN ), fName( name ),
+        fInTree( 0 ), fInBranch( 0 ), fAvailable( UNKNOWN ),
+        fBatchFirst( 0 ), fBatchSize( 0 ), fLastUsed( -1 ), fUseCount( 0 ),
+        fReader( 0 ), fReaderEntry( -1 ), fName( name ),
         fActive( kFALSE ), fType( "" ),
         fEntriesRead(), fBranchSize(), fZippedSize() {
 
@@ -62,6 +70,17 @@ namespace D3PDReader {
       return;
    }
 
+   void VarHandleBase::SetActivateBranches( ::Bool_t activate ) {
+
+      fgActivateBranches = activate;
+      return;
+   }
+
+   ::Bool_t VarHandleBase::GetActivateBranches() {
+
+      return fgActivateBranches;
+   }
+
    ::Bool_t VarHandleBase::IsActive() const {
 
       return fActive;
@@ -135,10 +154,14 @@ namespace D3PDReader {
                          GetName() );
          return kFALSE;
       }
-#ifdef ACTIVATE_BRANCHES
       // Only call this function when the user asks for it. It's quite expensive...
-      fInTree->SetBranchStatus( ::TString( GetName() ) + "*", 1 );
-#endif // ACTIVATE_BRANCHES
+      if( fgActivateBranches ) {
+         if( ! fInTree->GetBranchStatus( GetName() ) ) {
+            fParent->Info( ::TString( GetName() ) + "()",
+                           "Enabling branch %s, it was switched off", GetName() );
+         }
+         fInTree->SetBranchStatus( ::TString( GetName() ) + "*", 1 );
+      }
       if( fInTree->SetBranchAddress( GetName(), var, &fInBranch,
                                      realClass, dtype, isptr ) ) {
          fParent->Error( ::TString( GetName() ) + "()",
@@ -146,22 +169,119 @@ namespace D3PDReader {
          return kFALSE;
       }
 
-#ifdef COLLECT_D3PD_READING_STATISTICS
-      UpdateStat( fInBranch );
-#endif // COLLECT_D3PD_READING_STATISTICS
+      // The entry counts are always kept, they drive the TTreeCache training
+      // of SusyNtAna::setCacheProfile
+      if( fInBranch ) UpdateStat( fInBranch );
 
       return kTRUE;
    }
 
    void VarHandleBase::UpdateBranch() const {
 
+      CountUse();
       if( *fMaster != fInBranch->GetReadEntry() ) {
          fInBranch->GetEntry( *fMaster );
-#ifdef COLLECT_D3PD_READING_STATISTICS
-         ++( fEntriesRead.back() );
-#endif // COLLECT_D3PD_READING_STATISTICS
+         if( ! fEntriesRead.empty() ) ++( fEntriesRead.back() );
+      }
+
+      return;
+   }
+
+   /**
+    * The entries are read branch by branch rather than event by event, so
+    * consecutive reads hit the same basket, and the event loop then only
+    * does an index lookup per access.
+    *
+    * @param first First entry of the batch, in the current tree
+    * @param n Number of entries, they must all be in the current tree
+    * @returns <code>kTRUE</code> if the batch was read
+    */
+   ::Bool_t VarHandleBase::ReadBatch( ::Long64_t first, ::Long64_t n ) {
+
+      ClearBatch();
+      if( ( ! fFromInput ) || ( n <= 0 ) || ( ! IsAvailable() ) ) return kFALSE;
+      if( ! ConnectBatch() ) return kFALSE;
+
+      for( ::Long64_t i = 0; i < n; ++i ) {
+         fInBranch->GetEntry( first + i );
+         StoreBatchEntry( i );
       }
+      if( ! fEntriesRead.empty() ) fEntriesRead.back() += n;
+
+      fBatchFirst = first;
+      fBatchSize = n;
+      return kTRUE;
+   }
+
+   void VarHandleBase::ClearBatch() {
 
+      // The branch last read the final entry of the batch. Swap it back, so
+      // that the variable holds the entry the branch reports as read.
+      if( fBatchSize ) StoreBatchEntry( fBatchSize - 1 );
+      fBatchSize = 0;
+      fUseCount = 0;
+      return;
+   }
+
+   ::Bool_t VarHandleBase::InBatch( ::Long64_t entry ) const {
+
+      return ( fBatchSize && ( entry >= fBatchFirst ) &&
+               ( entry < fBatchFirst + fBatchSize ) );
+   }
+
+   ::Long64_t VarHandleBase::GetBatchSize() const {
+
+      return fBatchSize;
+   }
+
+   ::Long64_t VarHandleBase::GetUseCount() const {
+
+      return fUseCount;
+   }
+
+   void VarHandleBase::SetReader( VarReader* reader ) {
+
+      fReader = reader;
+      fReaderEntry = -1;
+      return;
+   }
+
+   VarReader* VarHandleBase::GetReader() const {
+
+      return fReader;
+   }
+
+   ::Bool_t VarHandleBase::ReadFromReader( void* var ) const {
+
+      if( *fMaster == fReaderEntry ) return kTRUE;
+      if( ! fReader->ReadEntry( *fMaster, var ) ) return kFALSE;
+      fReaderEntry = *fMaster;
+      return kTRUE;
+   }
+
+   ::Bool_t VarHandleBase::ConnectBatch() const {
+
+      return kFALSE;
+   }
+
+   void VarHandleBase::StoreBatchEntry( ::Long64_t ) const {
+
+      return;
+   }
+
+   ::Long64_t VarHandleBase::BatchIndex() const {
+
+      if( ! InBatch( *fMaster ) ) return -1;
+      CountUse();
+      return *fMaster - fBatchFirst;
+   }
+
+   void VarHandleBase::CountUse() const {
+
+      if( *fMaster != fLastUsed ) {
+         fLastUsed = *fMaster;
+         ++fUseCount;
+      }
       return;
    }
 
@@ -173,7 +293,9 @@ namespace D3PDReader {
       fZippedSize.push_back( ( ::Float_t ) br->GetZipBytes( "*" ) /
                              ( ::Float_t ) br->GetEntries() );
 
+#ifdef COLLECT_D3PD_READING_STATISTICS
       D3PDPerfStats::Instance()->NewTreeAccessed( fInTree );
+#endif // COLLECT_D3PD_READING_STATISTICS
 
       return;
    }
@@ -0,0 +1,191 @@
+#ifndef SusyNtuple_CutflowEngine_h
+#define SusyNtuple_CutflowEngine_h
+
+#include <string>
+#include <vector>
+
+#include "SusyNtuple/SusyDefs.h"
+
+namespace Susy
+{
+
+  /// One named cut of a CutflowEngine
+  class CutflowCut
+  {
+    public:
+      virtual ~CutflowCut() {}
+      /// Does the current event pass
+      virtual bool pass() = 0;
+  };
+
+#ifndef __CINT__
+  /// Cut calling a member function of the analysis, bool T::method()
+  template<class T>
+  class MemberCut : public CutflowCut
+  {
+    public:
+      typedef bool (T::*Method)();
+      MemberCut(T* obj, Method method) : m_obj(obj), m_method(method) {}
+      virtual bool pass() { return (m_obj->*m_method)(); }
+    protected:
+      T* m_obj;
+      Method m_method;
+  };
+#endif // __CINT__
+
+  /// Signal regions declared as sequences of named cuts
+  /**
+     The regions are merged into a tree of cuts: regions starting with
+     the same cuts share those nodes, so a common prefix (OS, jet veto,
+     Z veto) is evaluated and counted once per event. A cut is only
+     evaluated when all the cuts before it in some region pass, and its
+     result is kept for the rest of the event, so a cut used in several
+     places of the tree is still evaluated once.
+
+     Counters are kept per node, channel and systematic in one contiguous
+     array, [NtSys_N][nNodes][nChannels], which can be registered with
+     SusyNtAna::registerSysCounter. The number of evaluations and the
+     time spent in each cut are kept as well.
+
+     Usage:
+       engine.addCut("os", this, &MyAna::cutOS);
+       engine.addCut("jetVeto", this, &MyAna::cutJetVeto);
+       ...
+       engine.addRegion("SR1", "os,jetVeto,zVeto,metRel100");
+       engine.book();
+       registerSysCounter("cutflow", engine.counts(), engine.nCounts());
+       ...
+       engine.process(channel, sys);    // once per event and systematic
+
+     When only the region decisions are needed, setDecisionOnly makes
+     each region evaluate its cuts cheapest and most rejecting first,
+     from the time and pass rate measured while running. Cuts are not
+     moved across a barrier, e.g. a cut the following cuts need to be
+     safe to evaluate. Only the final count of each region is kept then.
+  */
+  class CutflowEngine
+  {
+    public:
+      CutflowEngine(uint nChannels=1);
+      virtual ~CutflowEngine();
+
+      /// Add a cut, the engine takes ownership. Fails if the name is already used.
+      bool addCut(const std::string& name, CutflowCut* cut);
+#ifndef __CINT__
+      /// Add a cut calling obj->method()
+      template<class T>
+      bool addCut(const std::string& name, T* obj, bool (T::*method)())
+      { return addCut(name, new MemberCut<T>(obj, method)); }
+#endif // __CINT__
+
+      /// Add a region from a comma separated list of cut names, in analysis order
+      bool addRegion(const std::string& name, const std::string& cuts);
+      /// Never move cuts across this one when reordering
+      bool setBarrier(const std::string& cut);
+      /// Allocate the counters. No region can be added afterwards.
+      void book();
+      bool isBooked() const { return m_booked; }
+
+      /// Evaluate all regions for the current event, count in channel ch and systematic sys
+      void process(uint ch, uint sys);
+      /// Did the current event pass a region, after process
+      bool passed(uint iRegion) const;
+      bool passed(const std::string& region) const;
+
+      /// Clear the counters and timing
+      void reset();
+
+      /// Only compute the region decisions, reordering the cuts every reorderPeriod events.
+      /** The intermediate steps of the regions are not counted in this mode. */
+      void setDecisionOnly(bool decisionOnly=true, uint reorderPeriod=1000);
+      bool isDecisionOnly() const { return m_decisionOnly; }
+      /// Reorder the cuts of every region from the measured cost and rejection
+      void reorder();
+      /// Cuts of a region in evaluation order
+      const std::vector<uint>& evalOrder(uint iRegion) const { return m_regions[iRegion].order; }
+
+      uint nCuts() const { return m_cuts.size(); }
+      uint nNodes() const { return m_nodes.size(); }
+      uint nRegions() const { return m_regions.size(); }
+      uint nChannels() const { return m_nChannels; }
+      const std::string& cutName(uint iCut) const { return m_cuts[iCut].name; }
+      const std::string& regionName(uint iRegion) const { return m_regions[iRegion].name; }
+      int regionIndex(const std::string& region) const;
+      /// Number of cuts of a region
+      uint nSteps(uint iRegion) const { return m_regions[iRegion].nodes.size(); }
+
+      /// Events passing a region up to and including one of its cuts
+      uint count(uint iRegion, uint step, uint ch, uint sys) const;
+
+      // Contiguous arrays, to register with SusyNtAna
+      uint* counts() { return m_counts.empty()? 0 : &m_counts[0]; }
+      uint nCounts() const { return m_nodes.size()*m_nChannels; }   ///< per systematic
+      uint* cutEvals() { return m_nEval.empty()? 0 : &m_nEval[0]; }   ///< evaluations per cut
+      uint* cutPasses() { return m_nPass.empty()? 0 : &m_nPass[0]; } ///< passing evaluations per cut
+
+      /// Seconds spent in a cut, in this process
+      double cutTime(uint iCut) const { return m_booked? m_time[iCut] : 0; }
+
+      /// Enable the per-cut timing, off by default and forced by setDecisionOnly.
+      /** Two gettimeofday calls per evaluation cost more than the cheap cuts. */
+      void setTiming(bool doTiming=true) { m_doTiming = doTiming; }
+
+      /// Print the counts of every region for one systematic and channel
+      void print(uint sys, uint ch) const;
+      /// Print the evaluations and time spent in each cut
+      void printTiming() const;
+
+    protected:
+
+      /// Result of the cut for the current event, evaluating it if needed
+      bool evalCut(uint iCut);
+      int findCut(const std::string& name) const;
+      /// Region decisions only, see setDecisionOnly
+      void processDecisions(uint ch, uint sys);
+      /// Expected cost per rejected event of a cut, lower runs first
+      double rank(uint iCut) const;
+
+      struct Cut {
+        std::string name;
+        CutflowCut* cut;
+        uint generation;        ///< event of the stored result
+        bool result;
+        bool barrier;           ///< cuts are not moved across it
+      };
+      struct Node {
+        uint cut;
+        int parent;             ///< -1 for the first cut of a region
+      };
+      struct Region {
+        std::string name;
+        std::vector<uint> nodes;
+        std::vector<uint> order;        ///< cuts in evaluation order
+      };
+
+      uint m_nChannels;
+      bool m_booked;
+      bool m_doTiming;
+      uint m_generation;        ///< current event, for the cut results
+      bool m_decisionOnly;      ///< region decisions only, with reordered cuts
+      uint m_reorderPeriod;     ///< events between reorderings, 0 for never
+      uint m_nProcessed;        ///< process calls in decision mode
+
+      std::vector<Cut> m_cuts;
+      std::vector<Node> m_nodes;        ///< parents always before their children
+      std::vector<Region> m_regions;
+      std::vector<char> m_pass;         ///< node passed for the current event
+
+      std::vector<uint> m_counts;       ///< [NtSys_N][node][channel]
+      std::vector<uint> m_nEval;        ///< [cut]
+      std::vector<uint> m_nPass;        ///< [cut]
+      std::vector<double> m_time;       ///< [cut], seconds
+
+    private:
+      // Owns the cuts
+      CutflowEngine(const CutflowEngine&);
+      CutflowEngine& operator=(const CutflowEngine&);
+  };
+
+};
+
+#endif
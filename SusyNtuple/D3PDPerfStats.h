@@ -89,6 +89,8 @@ namespace D3PDReader {
 
       /// Flag showing whether some information message has already been printed
       ::Bool_t fTreeWarningPrinted;
+      /// Thread that started the statistics collection (the event loop)
+      ::Long_t fThread; //!
 
       /// Internal object for keeping track of the collected statistics
       D3PDReadStats fStats;
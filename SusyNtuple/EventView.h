@@ -0,0 +1,190 @@
+#ifndef SusyNtuple_EventView_h
+#define SusyNtuple_EventView_h
+
+#include <vector>
+
+#include "TLorentzVector.h"
+
+#include "SusyNtuple/SusyDefs.h"
+#include "SusyNtuple/SusyNt.h"
+#include "SusyNtuple/SusyNtObject.h"
+
+namespace Susy
+{
+
+  /// Bits of ObjectColumns::flags
+  enum EventViewFlag
+  {
+    EVF_TightPP    = 1 << 0,    ///< electron tight++
+    EVF_MediumPP   = 1 << 1,    ///< electron medium++
+    EVF_Combined   = 1 << 2,    ///< combined muon
+    EVF_BadMuon    = 1 << 3,    ///< bad muon
+    EVF_Cosmic     = 1 << 4,    ///< cosmic muon
+    EVF_BadJet     = 1 << 5,    ///< jet fails bad very loose
+    EVF_HotTile    = 1 << 6,    ///< jet in hot tile
+    EVF_BTag       = 1 << 7,    ///< jet mv1 above the 80% working point
+    EVF_TauMedium  = 1 << 8     ///< tau passes the medium jet BDT
+  };
+
+  /// Kinematics and flags of one object collection, stored as contiguous arrays
+  /**
+     Entry i corresponds to entry i of the SusyNtObject collection.
+     The kinematic columns hold the nominal values. The energy scale
+     systematics only scale the four-momentum, so the value for any
+     SusyNtSys is the nominal one times scale(sys, i). The scale factors
+     of a systematic are only set once EventView::fillScales has run for
+     it.
+  */
+  class ObjectColumns
+  {
+    public:
+      ObjectColumns() : candMinPt(-1) {}
+
+      // Nominal kinematics
+      std::vector<float> pt;
+      std::vector<float> eta;
+      std::vector<float> phi;
+      std::vector<double> px;
+      std::vector<double> py;
+      std::vector<double> pz;
+      std::vector<double> e;
+
+      std::vector<int> q;
+      std::vector<unsigned int> flags;
+
+      /// Scale factors of the filled systematics, sf[sys*size() + i]
+      std::vector<float> sf;
+
+      uint size() const { return pt.size(); }
+      bool hasFlag(uint i, unsigned int flag) const { return (flags[i] & flag) == flag; }
+
+      /// Kinematics for a systematic
+      float scale(SusyNtSys sys, uint i) const { return sf[sys*size() + i]; }
+      float ptSys(SusyNtSys sys, uint i) const { return scale(sys, i) * pt[i]; }
+      double eSys(SusyNtSys sys, uint i) const { return scale(sys, i) * e[i]; }
+      TLorentzVector p4(SusyNtSys sys, uint i) const {
+        TLorentzVector tlv;
+        setP4(tlv, sys, i);
+        return tlv;
+      }
+      /// Set the four-momentum of an object to its value for a systematic
+      void setP4(TLorentzVector& tlv, SusyNtSys sys, uint i) const {
+        double s = scale(sys, i);
+        tlv.SetPxPyPzE(s*px[i], s*py[i], s*pz[i], s*e[i]);
+      }
+
+      // Envelope over a list of systematics, see fillEnvelope
+      std::vector<float> ptMax;         ///< max pt over the envelope systematics
+      std::vector<uint> cand;           ///< objects with ptMax >= candMinPt
+      float candMinPt;                  ///< pt threshold of cand, negative without envelope
+      std::vector<char> envSys;         ///< systematics covered by the envelope
+
+      /// Compute the max pt of each object over sysList and the objects above minPt.
+      /** An object outside cand fails minPt for every systematic of sysList. */
+      void fillEnvelope(const std::vector<SusyNtSys>& sysList, float minPt);
+      /// Can a pt cut for this systematic be evaluated on the candidates only
+      bool inEnvelope(SusyNtSys sys, float minPt) const {
+        return candMinPt >= 0 && minPt >= candMinPt && envSys[sys];
+      }
+
+      /// Resize, keeping the allocated capacity. Drops the envelope.
+      void resize(uint n){
+        pt.resize(n);
+        eta.resize(n);
+        phi.resize(n);
+        px.resize(n);
+        py.resize(n);
+        pz.resize(n);
+        e.resize(n);
+        q.resize(n);
+        flags.resize(n);
+        sf.resize(n*NtSys_N);
+        ptMax.resize(n);
+        cand.clear();
+        candMinPt = -1;
+      }
+      void clear(){ resize(0); }
+  };
+
+  /// Per-entry kinematics table of the SusyNt object collections
+  /**
+     Filled once per entry from the SusyNtObject. It holds the nominal
+     kinematics and the scale factors of the systematics filled with
+     fillScales, so the four-momenta of these systematics are available
+     side by side without touching the ntuple objects. The scale factors
+     are only computed for the systematics a job runs, the nominal ones
+     by fill. Once the scales are filled the view is read-only, so one
+     table can serve several systematics at the same time.
+
+     Usage:
+       view.fill(&nt);
+       view.fillScales(sys);
+       for(uint i=0; i<view.jet.size(); i++) if(view.jet.ptSys(sys, i) > 20) ...
+       Jet* j = &nt.jet()->at(i);
+       view.jet.setP4(*j, sys, i);
+  */
+  class EventView
+  {
+    public:
+      EventView() : m_filled(false), m_n0150BugFix(false),
+                    m_ele0(0), m_muo0(0), m_tau0(0), m_jet0(0) { clearScales(); }
+
+      /// Fill the table from the ntuple, with the nominal scale factors
+      void fill(SusyNtObject* susyNt, bool n0150BugFix=false);
+      /// Forget the current entry
+      void clear();
+      /// Fill the scale factors of a systematic, if not filled yet
+      void fillScales(SusyNtSys sys) { if(!m_hasScales[sys]) computeScales(sys); }
+      /// Fill the envelope of every collection over sysList, for the pre-selection pt cuts.
+      /** Fills the scale factors of the systematics of the list. */
+      void fillEnvelope(const std::vector<SusyNtSys>& sysList);
+
+      /// Is the view filled for the current entry
+      bool isFilled() const { return m_filled; }
+      /// Are the scale factors of a systematic filled
+      bool hasScales(SusyNtSys sys) const { return m_hasScales[sys]; }
+      bool n0150BugFix() const { return m_n0150BugFix; }
+
+      /// Column index of an object of the ntuple collections
+      uint index(const Electron* e) const { return e - m_ele0; }
+      uint index(const Muon* m) const { return m - m_muo0; }
+      uint index(const Tau* t) const { return t - m_tau0; }
+      uint index(const Jet* j) const { return j - m_jet0; }
+
+      /// Set the four-momentum of an ntuple object to its value for a systematic
+      void setP4(Electron* e, SusyNtSys sys) const { ele.setP4(*e, sys, index(e)); }
+      void setP4(Muon* m, SusyNtSys sys) const { muo.setP4(*m, sys, index(m)); }
+      void setP4(Tau* t, SusyNtSys sys) const { tau.setP4(*t, sys, index(t)); }
+      void setP4(Jet* j, SusyNtSys sys) const { jet.setP4(*j, sys, index(j)); }
+
+      ObjectColumns ele;        ///< electrons
+      ObjectColumns muo;        ///< muons
+      ObjectColumns tau;        ///< taus
+      ObjectColumns jet;        ///< jets
+
+      // Additional jet columns used by the jet selection
+      std::vector<float> jetDetEta;     ///< jet detector eta
+      std::vector<float> jetJvf;        ///< jet vertex fraction
+      std::vector<float> jetMv1;        ///< MV1 weight
+
+    protected:
+
+      bool m_filled;            ///< view has been filled
+      bool m_n0150BugFix;       ///< muon sf fix for tag n0150
+      bool m_hasScales[NtSys_N]; ///< scale factors filled, per systematic
+
+      /// Compute the scale factors of a systematic for every collection
+      void computeScales(SusyNtSys sys);
+      void clearScales() { for(int s=0; s<NtSys_N; s++) m_hasScales[s] = false; }
+
+      // First element of each ntuple collection, to map objects to columns
+      const Electron* m_ele0;
+      const Muon* m_muo0;
+      const Tau* m_tau0;
+      const Jet* m_jet0;
+
+  };
+
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SusyNtuple_FilePrefetcher_h
+#define SusyNtuple_FilePrefetcher_h
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+/**
+   Warm up the next input file of a chain while the current one is processed
+
+   For a local file a background thread reads the file once, so its
+   baskets and metadata are in the page cache when the TChain opens it.
+   The thread only uses POSIX calls, no ROOT, since ROOT I/O is not
+   thread-safe. For a remote file the open is started with
+   TFile::AsyncOpen instead, which TFile::Open picks up when the chain
+   reaches the file.
+
+   Usage:
+     FilePrefetcher prefetcher;
+     prefetcher.prefetch(nextFileName);    // e.g. from TSelector::Notify
+*/
+class FilePrefetcher
+{
+
+  public:
+
+    FilePrefetcher();
+    ~FilePrefetcher();
+
+    /// Start warming up a file, stopping the previous prefetch
+    void prefetch(const std::string& fileName);
+    /// Stop the current prefetch and wait for the thread
+    void stop();
+
+    /// Last file prefetched
+    const std::string& fileName() const { return m_fileName; }
+    /// Bytes read by the finished prefetches
+    unsigned long long bytesRead() const { return m_bytesRead; }
+
+  protected:
+
+    /// Read a local file into the page cache, runs on the thread
+    static void* readFile(void* prefetcher);
+
+    std::string m_fileName;     ///< file being prefetched
+    pthread_t m_thread;         ///< background reader
+    bool m_running;             ///< thread started and not joined
+    volatile bool m_stop;       ///< ask the thread to stop
+    unsigned long long m_bytesRead;
+    unsigned long long m_threadBytes;   ///< bytes read by the current thread
+    std::vector<char> m_buffer; ///< read buffer of the thread
+
+  private:
+    FilePrefetcher(const FilePrefetcher&);
+    FilePrefetcher& operator=(const FilePrefetcher&);
+
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SusyNtuple_IsolationContext_h
+#define SusyNtuple_IsolationContext_h
+
+#include <vector>
+
+#include "TLorentzVector.h"
+
+#include "SusyNtuple/SusyDefs.h"
+#include "SusyNtuple/SusyNt.h"
+
+namespace Susy
+{
+
+  /// Per-event inputs of the lepton isolation corrections
+  /**
+     The isolation corrections subtract the nearby semi-signal baseline
+     leptons from the cones of each lepton. This table holds, for one set
+     of baseline leptons, the quantities those loops need: the
+     semi-signal flags, the delta R of every pair and the transverse
+     energy of the electron clusters. It is filled once per signal lepton
+     selection, shared by the four cone corrections of all its leptons,
+     and cleared after it, see SusyNtTools::buildIsolationContext.
+
+     Leptons are indexed electrons first, then muons, in the order of the
+     baseline vectors.
+  */
+  class IsolationContext
+  {
+    public:
+      IsolationContext() : m_valid(false), m_nLep(0) {}
+
+      /// Fill the pair table for these baseline leptons.
+      /** semiSignal and clusEt are set by the caller, see SusyNtTools::buildIsolationContext */
+      void fill(const ElectronVector& baseElectrons, const MuonVector& baseMuons);
+      /// Forget the current leptons
+      void clear() { m_valid = false; }
+      /// Is the table filled
+      bool isValid() const { return m_valid; }
+
+      uint nEle() const { return m_ele.size(); }
+      uint nMuo() const { return m_muo.size(); }
+      /// Lepton index, or -1 if not a baseline lepton
+      int index(const Electron* e) const;
+      int index(const Muon* m) const;
+      /// Index of muon i, after the electrons
+      uint muoIndex(uint i) const { return m_ele.size() + i; }
+
+      const Electron* ele(uint i) const { return m_ele[i]; }
+      const Muon* muo(uint i) const { return m_muo[i]; }
+      /// delta R of leptons i and j, as a float like in the cone corrections
+      float dR(uint i, uint j) const { return m_dR[i*m_nLep + j]; }
+
+      std::vector<char> semiSignal;     ///< semi-signal flag of each lepton
+      std::vector<double> clusEt;       ///< clusE/cosh(clusEta) of each electron
+
+    protected:
+
+      bool m_valid;
+      uint m_nLep;
+      std::vector<const Electron*> m_ele;
+      std::vector<const Muon*> m_muo;
+      std::vector<TLorentzVector> m_p4; ///< four-momenta of the leptons
+      std::vector<float> m_dR;          ///< m_nLep x m_nLep
+
+  };
+
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SusyNtuple_ParallelDriver_h
+#define SusyNtuple_ParallelDriver_h
+
+#include <string>
+
+#include "TChain.h"
+#include "TList.h"
+
+class SusyNtAna;
+
+/**
+   Run a SusyNtAna selector over a TChain with several worker processes
+
+   The requested entry range is split into nWorkers contiguous ranges.
+   With a TEntryList set on the chain, the range counts the entries of
+   the list, like TTree::Process.
+   Begin() is called once in the parent, then each worker is forked and
+   runs its range with its own TChain (and therefore its own files,
+   baskets and SusyNtObject branch buffers). At the end every worker
+   writes its output list, including the counters registered with
+   SusyNtAna::registerCounter(), to a temporary file. The parent merges
+   these and calls Terminate() on the merged result.
+
+   Processes are used rather than threads because ROOT I/O, the
+   dictionaries and several of the tools we depend on are not
+   thread-safe.
+
+   Usage:
+     ParallelDriver driver(nWorkers);
+     driver.process(chain, susyAna, option, nEvt, nSkip);
+
+   With nWorkers <= 1 this is equivalent to chain->Process().
+*/
+
+class ParallelDriver
+{
+
+  public:
+
+    enum Status {
+      GOOD = 0,
+      BAD = 1
+    };
+
+    ParallelDriver(int nWorkers=1);
+    ~ParallelDriver(){};
+
+    /// Process nEvt entries of the chain starting at nSkip
+    Status process(TChain* chain, SusyNtAna* ana, const char* option="",
+                   Long64_t nEvt=-1, Long64_t nSkip=0);
+
+    /// Number of worker processes
+    void setNWorkers(int n) { m_nWorkers = n; }
+    int nWorkers() const { return m_nWorkers; }
+
+    /// Directory for the temporary worker output files
+    void setTmpDir(const std::string& dir) { m_tmpDir = dir; }
+
+    /// Verbose printout
+    void setVerbose(bool v=true) { m_verbose = v; }
+
+    /// Merge all objects of the input list into the output list
+    /**
+       Objects found in both lists are combined with their Merge(TCollection*)
+       method, objects only in the input list are moved to the output list.
+    */
+    static void mergeOutput(TList* output, TList* input);
+
+  protected:
+
+    /// Run one entry range in the (forked) worker process
+    Status runWorker(TChain* chain, SusyNtAna* ana, Long64_t first, Long64_t last,
+                     const std::string& outFile);
+
+    /// Worker output file name
+    std::string workerFileName(int iWorker) const;
+
+    int m_nWorkers;             ///< number of worker processes
+    std::string m_tmpDir;       ///< directory for worker output
+    bool m_verbose;             ///< verbose printout
+    int m_jobId;                ///< parent pid, tags the worker files
+
+};
+
+#endif
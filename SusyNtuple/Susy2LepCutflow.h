@@ -11,6 +11,7 @@
 #include "SusyNtuple/SusyNtAna.h"
 #include "SusyNtuple/DilTrigLogic.h"
 #include "SusyNtuple/SusyNtTools.h"
+#include "SusyNtuple/CutflowEngine.h"
 
 #include <fstream>
 
@@ -39,13 +40,37 @@ class Susy2LepCutflow : public SusyNtAna
 
     // Full event selection. Specify which leptons to use.
     bool selectEvent(const LeptonVector& leptons, const LeptonVector& baseLeptons);
+    // Event cleaning on the nominal cut flags, counted for one systematic
+    bool passCleaning(int flag, SusyNtSys sys);
+    // Lepton multiplicity on the event summary, see SusyNtAna::setUseSummary
+    virtual bool passSummary(const Susy::SusyNtSummary& summary)
+    { return !m_cutNBaseLep || summary.nLep() >= (int) m_nLepMin; }
+    // The same cuts hold on the max of a zone, the counts only grow
+    virtual bool passZone(const Susy::SusyNtSummary& zoneMax) { return passSummary(zoneMax); }
 		     
-    // Signal regions
-    bool passSR1(const LeptonVector& leptons, const JetVector& jets, const Met* met);
-    bool passSR2(const LeptonVector& leptons, const JetVector& jets, const Met* met);
-    bool passSR3(const LeptonVector& leptons, const JetVector& jets, const Met* met);
-    bool passSR4(const LeptonVector& leptons, const JetVector& jets, const Met* met);
-    bool passSR5(const LeptonVector& leptons, const JetVector& jets, const Met* met);
+    // Signal regions, declared as sequences of cuts of m_cutflow
+    void defineSignalRegions();
+    bool passSR(const std::string& region) const { return m_cutflow.passed(region); }
+    /// Only count the full signal regions, running the cheapest and most rejecting cuts first
+    void setRegionDecisionsOnly(bool decisionOnly=true) { m_cutflow.setDecisionOnly(decisionOnly); }
+
+    // Signal region cuts on the selected signal objects, used by m_cutflow
+    bool cutOS()        { return oppositeSign(m_signalLeptons); }
+    bool cutSS()        { return sameSign(m_signalLeptons); }
+    bool cutSF()        { return sameFlavor(m_signalLeptons); }
+    bool cutJetVeto()   { return passJetVeto(m_signalJets); }
+    bool cutGe2Jet()    { return passge2Jet(m_signalJets); }
+    bool cutBJetVeto()  { return passbJetVeto(m_signalJets); }
+    bool cutZVeto()     { return passZVeto(m_signalLeptons); }
+    bool cutTopTag()    { return sigTopTag(); }
+    bool cutMetRel100() { return passMETRel(m_met, m_signalLeptons, m_signalJets, 100); }
+    bool cutMetRel50()  { return passMETRel(m_met, m_signalLeptons, m_signalJets, 50); }
+    bool cutMetRel40()  { return passMETRel(m_met, m_signalLeptons, m_signalJets, 40); }
+    bool cutL0Pt50();
+    bool cutSumPt100();
+    bool cutDPhiMetLL();
+    bool cutDPhiMetL1();
+    bool cutMT2_90()    { return passMT2(m_signalLeptons, m_met, 90); }
 
     // Cut methods
     bool passNLepCut(const LeptonVector& leptons);
@@ -88,51 +113,21 @@ class Susy2LepCutflow : public SusyNtAna
 
     DiLepEvtType        m_ET;           // Dilepton event type to store cf
 
-    // Event counters
+    // Event counters, indexed by systematic after n_readin
     uint                n_readin;
-    uint                n_pass_LAr;
-    uint                n_pass_BadJet;
-    uint                n_pass_BadMuon;
-    uint                n_pass_Cosmic;
-    uint                n_pass_flavor[ET_N];
-    uint                n_pass_nLep[ET_N];
-    uint                n_pass_mll[ET_N];    
-    uint                n_pass_os[ET_N];
-    uint                n_pass_ss[ET_N];
-    uint                n_pass_trig[ET_N];
-
-    // SR1 counts
-    uint                n_pass_SR1jv[ET_N];
-    uint                n_pass_SR1Zv[ET_N];
-    uint                n_pass_SR1MET[ET_N];
-
-    // SR2 counts
-    uint                n_pass_SR2jv[ET_N];
-    uint                n_pass_SR2MET[ET_N];
-
-    // SR3 counts
-    uint                n_pass_SR3ge2j[ET_N];
-    uint                n_pass_SR3Zv[ET_N];
-    uint                n_pass_SR3bjv[ET_N];
-    uint                n_pass_SR3mct[ET_N];
-    uint                n_pass_SR3MET[ET_N];
-
-    // SR4 counts
-    uint                n_pass_SR4jv[ET_N];
-    uint                n_pass_SR4MET[ET_N];
-    uint                n_pass_SR4Zv[ET_N];
-    uint                n_pass_SR4L0pt[ET_N];
-    uint                n_pass_SR4SUMpt[ET_N];
-    uint                n_pass_SR4dPhiMETLL[ET_N];
-    uint                n_pass_SR4dPhiMETL1[ET_N];
-    
-    // SR5 counts
-    uint                n_pass_SR5jv[ET_N];
-    uint                n_pass_SR5Zv[ET_N];
-    uint                n_pass_SR5MET[ET_N];
-    uint                n_pass_SR5MT2[ET_N];
-    
-
+    uint                n_pass_LAr[NtSys_N];
+    uint                n_pass_BadJet[NtSys_N];
+    uint                n_pass_BadMuon[NtSys_N];
+    uint                n_pass_Cosmic[NtSys_N];
+    uint                n_pass_flavor[NtSys_N][ET_N];
+    uint                n_pass_nLep[NtSys_N][ET_N];
+    uint                n_pass_mll[NtSys_N][ET_N];    
+    uint                n_pass_os[NtSys_N][ET_N];
+    uint                n_pass_ss[NtSys_N][ET_N];
+    uint                n_pass_trig[NtSys_N][ET_N];
+
+    // Signal region counters, per systematic and dilepton type
+    CutflowEngine       m_cutflow;
 
 };
 
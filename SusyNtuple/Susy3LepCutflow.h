@@ -45,6 +45,13 @@ class Susy3LepCutflow : public SusyNtAna
     // Full event selection. Specify which leptons to use.
     bool selectEvent(const LeptonVector& leptons, const TauVector& taus, 
                      const JetVector& jets, const Susy::Met* met);
+    // Event cleaning cuts, counted for one systematic
+    bool passCleaning(int flag, SusyNtSys sys);
+    // Lepton and tau multiplicity on the event summary, see SusyNtAna::setUseSummary
+    virtual bool passSummary(const Susy::SusyNtSummary& summary)
+    { return summary.nLep() >= (int) m_nLepMin && summary.nTau >= (int) m_nTauMin; }
+    // The same cuts hold on the max of a zone, the counts only grow
+    virtual bool passZone(const Susy::SusyNtSummary& zoneMax) { return passSummary(zoneMax); }
 
     // Fill histograms
     void fillHistos(const LeptonVector& leptons, const TauVector& taus,
@@ -106,24 +113,24 @@ class Susy3LepCutflow : public SusyNtAna
 
     bool                m_writeOut;     // switch to control output dump
 
-    // Event counters
+    // Event counters, indexed by systematic after n_readin
     uint                n_readin;
-    uint                n_pass_hotSpot;
-    uint                n_pass_badJet;
-    uint                n_pass_badMuon;
-    uint                n_pass_cosmic;
-    uint                n_pass_feb;
-    uint                n_pass_nLep;
-    uint                n_pass_nTau;
-    uint                n_pass_trig;
-    uint                n_pass_sfos;
-    uint                n_pass_z;
-    uint                n_pass_met;
-    uint                n_pass_bJet;
-    uint                n_pass_mt;
+    uint                n_pass_hotSpot[NtSys_N];
+    uint                n_pass_badJet[NtSys_N];
+    uint                n_pass_badMuon[NtSys_N];
+    uint                n_pass_cosmic[NtSys_N];
+    uint                n_pass_feb[NtSys_N];
+    uint                n_pass_nLep[NtSys_N];
+    uint                n_pass_nTau[NtSys_N];
+    uint                n_pass_trig[NtSys_N];
+    uint                n_pass_sfos[NtSys_N];
+    uint                n_pass_z[NtSys_N];
+    uint                n_pass_met[NtSys_N];
+    uint                n_pass_bJet[NtSys_N];
+    uint                n_pass_mt[NtSys_N];
 
     // Final estimate weighted to full lumi
-    float               n_evt_tot;
+    float               n_evt_tot[NtSys_N];
 };
 
 #endif
@@ -324,6 +324,26 @@ bool findLepton(const Susy::Lepton* lep, const LeptonVector& leptons);
 // Dilepton specific
 DiLepEvtType getDiLepEvtType(const LeptonVector& leptons);
 
+// Systematics which shift the kinematics of a given object type
+bool isElectronSys(int sys);
+bool isMuonSys(int sys);
+bool isTauSys(int sys);
+bool isJetSys(int sys);
+
+/// What a systematic changes with respect to the nominal, see sysDependencies
+enum SysDependency
+{
+  SysDep_Ele    = 1 << 0,       ///< electron kinematics
+  SysDep_Muo    = 1 << 1,       ///< muon kinematics
+  SysDep_Tau    = 1 << 2,       ///< tau kinematics
+  SysDep_Jet    = 1 << 3,       ///< jet kinematics
+  SysDep_JetSel = 1 << 4,       ///< signal jet selection (JVF cut)
+  SysDep_Met    = 1 << 5,       ///< missing Et
+  SysDep_Weight = 1 << 6        ///< event weight only
+};
+/// Bit mask of SysDependency for a SusyNtSys, 0 for the nominal
+uint sysDependencies(int sys);
+
 //-----------------------------------------------------------------------------------
 // Trigger flags
 //-----------------------------------------------------------------------------------
@@ -71,6 +71,13 @@ namespace Susy
 
       /// Event cleaning cut flags. The bits are defined in SusyDefs as EventCleaningCuts
       unsigned int cutFlags[NtSys_N];
+      /// The systematic cutFlags are stored XOR the nominal ones, mostly 0.
+      /** Set by packCutFlags before writing, undone when read (rule in LinkDef.h) */
+      bool cutFlagsDelta;
+      /// Store the systematic cutFlags as differences to the nominal ones
+      void packCutFlags();
+      /// Back to the plain cutFlags, if packed
+      void unpackCutFlags();
 
       // Reweighting and scaling
       float wPileup;            ///< pileup weight for full dataset
@@ -115,6 +122,7 @@ namespace Susy
         passMllForAlpgen = true;
         //memset(evtFlag,0,sizeof(evtFlag));
         memset(cutFlags,0,sizeof(cutFlags));
+        cutFlagsDelta = false;
         wPileup = wPileup_up = wPileup_dn = wPileupAB3 = wPileupAB = wPileupIL = wPileupAE = 0;
         xsec = errXsec = sumw = pdfSF = 0;
         pdf_id1 = pdf_id2 = pdf_x1 = pdf_x2 = pdf_scale = 0;
@@ -122,7 +130,7 @@ namespace Susy
         higgs_pt = 0.0;
       }
 
-      ClassDef(Event, 28);
+      ClassDef(Event, 29);
   };
 
   /// Particle class, base class for other object types
@@ -282,20 +290,23 @@ namespace Susy
       bool isEle() const { return true;  }
       bool isMu()  const { return false; }
 
-      // Systematic scale factors
+      // Systematic scale factors. The Float16_t of the scale factors are
+      // written with a 14 bit mantissa, about 6e-5 relative precision.
       //float ees_up;           ///< Energy Scale + sigma
       //float ees_dn;           ///< Energy Scale - sigma
-      float ees_z_up;           ///< Energy Scale Z + sigma
-      float ees_z_dn;           ///< Energy Scale Z - sigma
-      float ees_mat_up;         ///< Energy Scale Material + sigma
-      float ees_mat_dn;         ///< Energy Scale Material - sigma
-      float ees_ps_up;          ///< Energy Scale Presampler + sigma
-      float ees_ps_dn;          ///< Energy Scale Presampler - sigma
-      float ees_low_up;         ///< Energy Scale Low Pt + sigma
-      float ees_low_dn;         ///< Energy Scale Low Pt - sigma
-      float eer_up;             ///< Energy Reso. + sigma
-      float eer_dn;             ///< Energy Reso. - sigma
-
+      Float16_t ees_z_up;       ///< Energy Scale Z + sigma [0,0,14]
+      Float16_t ees_z_dn;       ///< Energy Scale Z - sigma [0,0,14]
+      Float16_t ees_mat_up;     ///< Energy Scale Material + sigma [0,0,14]
+      Float16_t ees_mat_dn;     ///< Energy Scale Material - sigma [0,0,14]
+      Float16_t ees_ps_up;      ///< Energy Scale Presampler + sigma [0,0,14]
+      Float16_t ees_ps_dn;      ///< Energy Scale Presampler - sigma [0,0,14]
+      Float16_t ees_low_up;     ///< Energy Scale Low Pt + sigma [0,0,14]
+      Float16_t ees_low_dn;     ///< Energy Scale Low Pt - sigma [0,0,14]
+      Float16_t eer_up;         ///< Energy Reso. + sigma [0,0,14]
+      Float16_t eer_dn;         ///< Energy Reso. - sigma [0,0,14]
+
+      /// Energy scale factor for a systematic, 1 if the systematic doesn't affect electrons
+      float sysScale(int sys) const;
       /// Shift energy up/down for systematic
       void setState(int sys);
 
@@ -315,7 +326,7 @@ namespace Susy
         Lepton::clear();
       }
 
-      ClassDef(Electron, 5);
+      ClassDef(Electron, 6);
   };
 
   /// Muon class
@@ -357,14 +368,16 @@ namespace Susy
       bool isCosmic;            ///< Cosmic muon flag from SUSYTools
       
       // Systematic sf
-      float ms_up;              ///< MS Pt + sigma
-      float ms_dn;              ///< MS Pt - sigma
-      float id_up;              ///< ID Pt + sigma
-      float id_dn;              ///< ID Pt - sigma
+      Float16_t ms_up;          ///< MS Pt + sigma [0,0,14]
+      Float16_t ms_dn;          ///< MS Pt - sigma [0,0,14]
+      Float16_t id_up;          ///< ID Pt + sigma [0,0,14]
+      Float16_t id_dn;          ///< ID Pt - sigma [0,0,14]
 
       // Polymorphism, baby!!
       bool isEle() const { return false; }
       bool isMu()  const { return true; }
+      /// Momentum scale factor for a systematic, 1 if the systematic doesn't affect muons
+      float sysScale(int sys, bool isTag0150 = false) const;
       void setState(int sys, bool isTag0150 = false);
 
       /// Print method
@@ -385,7 +398,7 @@ namespace Susy
         Lepton::clear();
       }
 
-      ClassDef(Muon, 6);
+      ClassDef(Muon, 7);
   };
 
   /// Tau class
@@ -435,8 +448,8 @@ namespace Susy
       //float errEffSF;         ///< Uncertainty on the efficiency scale factor
 
       // Systematic factors
-      float tes_up;             ///< tau energy scale + sigma
-      float tes_dn;             ///< tau energy scale - sigma
+      Float16_t tes_up;         ///< tau energy scale + sigma [0,0,14]
+      Float16_t tes_dn;         ///< tau energy scale - sigma [0,0,14]
 
       long long trigFlags;      ///< Bit word representing matched trigger chains
 
@@ -446,6 +459,8 @@ namespace Susy
         return (trigFlags & mask) == mask;
       }
 
+      /// Energy scale factor for a systematic, 1 if the systematic doesn't affect taus
+      float sysScale(int sys) const;
       /// Set systematic state
       void setState(int sys);
 
@@ -471,7 +486,7 @@ namespace Susy
         Particle::clear();
       }
 
-      ClassDef(Tau, 6);
+      ClassDef(Tau, 7);
   };
 
   /// Photon class
@@ -543,14 +558,16 @@ namespace Susy
       bool isBadTightBCH;       ///< BCH cleaning flag
 
       // Systematics
-      float jes_up;             ///< jet energy scale up
-      float jes_dn;             ///< jet energy scale down
-      float jer;                ///< jet energy resolution
+      Float16_t jes_up;         ///< jet energy scale up [0,0,14]
+      Float16_t jes_dn;         ///< jet energy scale down [0,0,14]
+      Float16_t jer;            ///< jet energy resolution [0,0,14]
 
       // Jet-Met Weights
       float met_wpx;
       float met_wpy;
 
+      // Energy scale factor for a systematic, 1 if the systematic doesn't affect jets
+      float sysScale(int sys) const;
       // Shift energy for systematic
       void setState(int sys);
 
@@ -573,7 +590,7 @@ namespace Susy
         Particle::clear();
       }
 
-      ClassDef(Jet, 10);
+      ClassDef(Jet, 11);
   };
 
   /// Met class
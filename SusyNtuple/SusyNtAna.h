@@ -3,6 +3,7 @@
 
 #include "TSelector.h"
 #include "TTree.h"
+#include "TH1.h"
 #include "TStopwatch.h"
 
 #include "ReweightUtils/APWeightEntry.h"
@@ -12,12 +13,18 @@
 #include "SusyNtuple/SusyNtObject.h"
 #include "SusyNtuple/SusyNtTools.h"
 #include "SusyNtuple/MCWeighter.h"
+#include "SusyNtuple/SusyNtSummary.h"
 
 #include <fstream>
 #include <map>
 #include <set>
+#include <string>
+#include <vector>
 
 
+class FilePrefetcher;
+namespace Susy { class SusyNtSkimWriter; class SusyNtColumnCache; }
+
 // To debug events in input file 
 typedef std::map< unsigned int, std::set<unsigned int>* > RunEventMap;
 
@@ -30,7 +37,7 @@ class SusyNtAna : public TSelector, public SusyNtTools
 
     /// Constructor and destructor
     SusyNtAna();
-    virtual ~SusyNtAna(){};
+    virtual ~SusyNtAna();
 
     /// SusyNt object, access to the SusyNt variables
     Susy::SusyNtObject nt;
@@ -45,7 +52,9 @@ class SusyNtAna : public TSelector, public SusyNtTools
     /// Begin is called before looping on entries
     virtual void    Begin(TTree *tree);
     /// Called at the first entry of a new file in a chain
-    virtual Bool_t  Notify() { return kTRUE; }
+    virtual Bool_t  Notify();
+    /// SlaveTerminate is called after looping, in the process that ran the entries
+    virtual void    SlaveTerminate();
     /// Terminate is called after looping is finished
     virtual void    Terminate();
     /** Due to ROOT's stupid design, need to specify version >= 2 or the tree will not connect automatically */
@@ -60,6 +69,10 @@ class SusyNtAna : public TSelector, public SusyNtTools
         to this class and hence to all of the VarHandles */
     virtual Int_t   GetEntry(Long64_t e, Int_t getall = 0) {
       m_entry=e;
+      if(m_batchSize && m_summaryTree == 0 && !nt.FromCache() && !nt.InBatch(e)) readBatch(e);
+      m_view.clear();
+      m_request.pending = false;
+      clearIsolationContext();
       return kTRUE;
     }
 
@@ -67,6 +80,28 @@ class SusyNtAna : public TSelector, public SusyNtTools
     void clearObjects();
     void selectObjects(SusyNtSys sys = NtSys_NOM, bool removeLepsFromIso=false, 
                        TauID signalTauID=TauID_medium, bool n0150BugFix = false);
+    /// Request the object selection, it runs on the first access to the objects.
+    /** Cuts on the Event alone can be applied before ensureObjects() or an object
+        accessor is called, so rejected events don't read the object branches. */
+    void requestObjects(SusyNtSys sys = NtSys_NOM, bool removeLepsFromIso=false, 
+                        TauID signalTauID=TauID_medium, bool n0150BugFix = false);
+    /// Run the requested object selection, if it hasn't run yet
+    void ensureObjects() { if(m_request.pending) selectRequestedObjects(); }
+    bool objectsPending() const { return m_request.pending; }
+
+    // Selected objects, built on first access after requestObjects
+    const ElectronVector& baseElectrons()    { ensureObjects(); return m_baseElectrons; }
+    const MuonVector& baseMuons()            { ensureObjects(); return m_baseMuons; }
+    const LeptonVector& baseLeptons()        { ensureObjects(); return m_baseLeptons; }
+    const TauVector& baseTaus()              { ensureObjects(); return m_baseTaus; }
+    const JetVector& baseJets()              { ensureObjects(); return m_baseJets; }
+    const ElectronVector& signalElectrons()  { ensureObjects(); return m_signalElectrons; }
+    const MuonVector& signalMuons()          { ensureObjects(); return m_signalMuons; }
+    const LeptonVector& signalLeptons()      { ensureObjects(); return m_signalLeptons; }
+    const TauVector& signalTaus()            { ensureObjects(); return m_signalTaus; }
+    const JetVector& signalJets()            { ensureObjects(); return m_signalJets; }
+    const JetVector& signalJets2Lep()        { ensureObjects(); return m_signalJets2Lep; }
+    const Susy::Met* met()                   { ensureObjects(); return m_met; }
 
     // Cleaning cuts
     int cleaningCutFlags();
@@ -115,6 +150,145 @@ class SusyNtAna : public TSelector, public SusyNtTools
     /// Dump timer
     void dumpTimer();
 
+    //
+    // Counters for parallel running (see ParallelDriver)
+    //
+
+    /// Register an array of n event counters so it is summed over parallel workers
+    void registerCounter(const std::string& name, uint* counter, uint n=1);
+    void registerCounter(const std::string& name, float* counter, uint n=1);
+    /// Register counters with a systematic axis, laid out as counter[NtSys_N][n]
+    void registerSysCounter(const std::string& name, uint* counter, uint n=1);
+    void registerSysCounter(const std::string& name, float* counter, uint n=1);
+    /// Copy the registered counters and the entry count into the output list
+    void storeCounters();
+    /// Copy the (merged) counters from the output list back into the registered counters
+    void retrieveCounters();
+    /// Write the registered counters as histograms to a ROOT file
+    bool writeCounters(const std::string& fileName);
+
+    //
+    // Systematics evaluated in a single pass over the input
+    //
+
+    /// Set the systematics evaluated for every entry, the default is nominal only
+    void setSystematics(const std::vector<SusyNtSys>& sysList) { m_sysList = sysList; }
+    void addSystematic(SusyNtSys sys) { m_sysList.push_back(sys); }
+    const std::vector<SusyNtSys>& systematics() const { return m_sysList; }
+    /// Parse a comma separated list of SusyNtSystNames, "ALL" selects every systematic
+    static bool parseSystematics(const std::string& names, std::vector<SusyNtSys>& sysList);
+    /// Fill the EventView of the current entry and its envelope over the systematics list
+    void fillView(bool n0150BugFix=false);
+    /// Best-case number of pre-selected leptons (jets) over the systematics list.
+    /** No systematic of the list can select more objects. Fills the view if needed. */
+    uint maxPreLeptons(bool n0150BugFix=false);
+    uint maxPreJets(bool n0150BugFix=false);
+    /// Reuse the nominal selection stages a systematic doesn't change (default true).
+    /** Only effective when the nominal is evaluated first for the entry. */
+    void setReuseNominal(bool reuse=true) { m_reuseNominal = reuse; }
+
+    //
+    // Event variables of the selected objects: signal leptons, signal jets and met.
+    // Computed on first use and cached until the objects are cleared.
+    //
+
+    float sigMll();             ///< mass of the two leading signal leptons, -999 if fewer
+    float sigMetRel();          ///< getMetRel, central jets only
+    float sigMT2();             ///< getMT2 of the two leading signal leptons
+    float sigMeff();            ///< Meff of leptons, jets above 40 GeV and met
+    float sigHT();              ///< getHT of the signal jets
+    float sigMljj();            ///< mljj of the two leading leptons and jets
+    bool  sigTopTag();          ///< passTopTag with the default options
+    /// Are these the selected objects the cached variables are computed from
+    bool isSignalSelection(const LeptonVector& leps, const JetVector& jets, const Susy::Met* met) const
+    { return &leps == &m_signalLeptons && &jets == &m_signalJets && met == m_met; }
+
+    //
+    // TTreeCache training from the branch access of a previous run
+    //
+
+    /// Branch access profile file.
+    /** If the file exists, Init sizes the TTreeCache and fills it with the
+        branches read in the profiled run, without a learning phase.
+        Terminate saves the profile of this run to the same file. */
+    void setCacheProfile(const std::string& fileName) { m_cacheProfile = fileName; }
+    const std::string& cacheProfile() const { return m_cacheProfile; }
+    /// Read ahead in the background (default false).
+    /** The next file of the chain is warmed up while the current one is
+        processed, and the TTreeCache fetches the next cluster asynchronously. */
+    void setPrefetch(bool prefetch=true) { m_prefetch = prefetch; }
+    /// Decompress the cached baskets on helper threads (default false).
+    /** Uses ROOT's TTreeCacheUnzip: the baskets of the branches in the
+        TTreeCache are unzipped ahead of the event loop. */
+    void setParallelUnzip(bool parallelUnzip=true) { m_parallelUnzip = parallelUnzip; }
+    /// Read the entries in batches of n, 0 to read one entry at a time (default 0).
+    /** See SusyNtObject::ReadBatch. Files with a summary preselection are
+        read one entry at a time: a batch would read the branches of the
+        entries the summary then skips. */
+    void setBatchSize(uint n) { m_batchSize = n; }
+    /// Monitor the reading with D3PDPerfStats, summary printed by Terminate (default false).
+    /** The unzip time is the time the event loop spent decompressing baskets. */
+    void setReadPerfStats(bool perfStats=true) { m_readPerfStats = perfStats; }
+    /// Also switch off the branches the profiled run did not read (default false).
+    /** A branch read anyway is switched back on when its handle connects. */
+    void setDisableUnusedBranches(bool disable=true) { m_disableUnusedBranches = disable; }
+
+    //
+    // Preselection on the event summary friend tree
+    //
+
+    /// Skip the entries rejected by passSummary (default false).
+    /** The summary is read from the file next to each input file, see
+        SusyNtSummary; files without one are processed in full. Skipped
+        entries don't reach the event selection, not even the cleaning
+        cuts: the cutflows print their number, nSkippedBySummary, on a
+        line of its own. */
+    void setUseSummary(bool useSummary=true);
+    /// Preselection on the summary of the entry, return false to skip the entry
+    virtual bool passSummary(const Susy::SusyNtSummary& /*summary*/) { return true; }
+    /// Preselection on the max of the summaries of a range of entries.
+    /** The counts and pts are maxima over the range and the flags are
+        OR-ed, see SusyNtZone: return false only if no entry of the range
+        can pass. The ranges are basket clusters: with pruneChain, the
+        rejected ones are left out of the entry list and never read,
+        otherwise their entries are rejected one by one. */
+    virtual bool passZone(const Susy::SusyNtSummary& /*zoneMax*/) { return true; }
+    /// Is the current entry rejected by passZone or passSummary. Call after GetEntry.
+    bool rejectedBySummary();
+    /// Entries skipped by the summary preselection, to print with the cutflow
+    uint nSkippedBySummary() const { return m_summaryCounts[1] + m_prunedEntries; }
+    /// Chain of the input files and zones whose summary passes passZone.
+    /** The entries of the passing zones are set as the TEntryList of the
+        chain, so the rejected clusters are never iterated, and files with
+        no passing zone are dropped. Files without a zone map are kept
+        whole. The MC normalization is built here from the full chain, so
+        the dataset sumw stays complete. The new chain and its entry list
+        belong to the caller. */
+    TChain* pruneChain(TChain* chain);
+
+    //
+    // Skim/slim output
+    //
+
+    /// Write the entries reaching a cut stage to a reduced SusyNt.
+    /** Only the listed branches are written, comma separated, all if
+        empty. An entry is written once, when skimStage(stage) is first
+        called for it in any systematic. The genCutFlow and procCutFlow*
+        histograms of all the inputs are added, see SusyNtSkimWriter. */
+    void setSkim(const std::string& fileName, const std::string& stage, const std::string& branches="");
+    /// The current entry passed a cut stage, written if it is the skim stage
+    void skimStage(const std::string& stage);
+
+    //
+    // Column cache
+    //
+
+    /// Serve the input from a column cache file made by SusyNtColumnCacheMaker (default none).
+    /** The files of the chain found in the cache are read from the
+        mapping, the others from the tree. The MC normalization is still
+        built from the input files. See SusyNtColumnCache. */
+    void setColumnCache(const std::string& fileName) { m_columnCacheFile = fileName; }
+
     /// Access tree
     TTree* getTree() { return m_tree; }
 
@@ -153,6 +327,7 @@ class SusyNtAna : public TSelector, public SusyNtTools
 
     ElectronVector      m_preElectrons;         ///< selected electrons before OR
     MuonVector          m_preMuons;             ///< selected muons before OR
+    TauVector           m_preTaus;              ///< selected taus before OR
     JetVector           m_preJets;              ///< selected jets before OR
 
     ElectronVector      m_baseElectrons;        ///< baseline electrons
@@ -171,12 +346,128 @@ class SusyNtAna : public TSelector, public SusyNtTools
     // New organization of tau selections
     TauVector           m_mediumTaus;           ///< taus with medium ID
     TauVector           m_tightTaus;            ///< taus with tight ID
+    TauVector           m_oneTau;               ///< scratch, one tau to reselect from nominal
 
     const Susy::Met*    m_met;                  ///< Met
 
+    /// Kinematics table of the current entry for all systematics, used by the object selection
+    Susy::EventView     m_view;
+
     /// Timer
     TStopwatch          m_timer;
 
+    /// Systematics evaluated for every entry
+    std::vector<SusyNtSys> m_sysList;
+    /// Systematic currently being evaluated
+    SusyNtSys           m_sys;
+
+    /// Nominal selection of the current entry
+    struct NominalSelection {
+      bool valid;
+      bool removeLepsFromIso;
+      bool selectTaus;
+      ElectronVector preElectrons;
+      MuonVector preMuons;
+      TauVector preTaus;
+      JetVector preJets;
+      ElectronVector baseElectrons;
+      MuonVector baseMuons;
+      TauVector baseTaus;
+      JetVector baseJets;
+      /// Signal decisions by EventView index, only set for nominal baseline objects
+      std::vector<char> sigEle, sigMuo, sigTau, sigJet, sigJet2Lep;
+    };
+    NominalSelection    m_nominal;
+    bool                m_reuseNominal;         ///< reuse nominal stages for systematics
+
+    /// Object selection requested with requestObjects
+    struct ObjectRequest {
+      bool pending;
+      SusyNtSys sys;
+      bool removeLepsFromIso;
+      TauID signalTauID;
+      bool n0150BugFix;
+    };
+    ObjectRequest       m_request;
+    /// Run the pending request
+    void selectRequestedObjects();
+
+    /// Keep the selection just made as the nominal of the current entry
+    void storeNominal(bool removeLepsFromIso);
+    /// Object selection for a systematic, reusing the nominal where the inputs are unchanged
+    void selectObjectsFromNominal(SusyNtSys sys, bool removeLepsFromIso);
+
+    /// Cached event variables
+    enum EventVar { EV_Mll = 0, EV_MetRel, EV_MT2, EV_Meff, EV_HT, EV_Mljj, EV_TopTag, EV_N };
+    struct CachedVar {
+      float value;
+      uint generation;          ///< m_varGeneration when the value was computed
+    };
+    CachedVar           m_varCache[EV_N];       ///< values for the current selection
+    uint                m_varGeneration;        ///< bumped by clearObjects, invalidates the cache
+    /// Value of a variable for the current objects
+    float cachedVar(EventVar var);
+    /// Compute a variable from the current objects
+    float computeVar(EventVar var);
+
+    /// Registered event counters
+    struct CounterRef {
+      std::string name;
+      uint* uCounts;
+      float* fCounts;
+      uint n;
+      bool perSys;              ///< counts are [NtSys_N][n]
+    };
+    std::vector<CounterRef> m_counters;
+    /// Build the output histogram of a counter, with the systematic on the y axis for perSys
+    TH1* makeCounterHisto(const CounterRef& ref) const;
+
+    std::string         m_cacheProfile;         ///< branch access profile, empty for none
+    bool                m_disableUnusedBranches; ///< switch off branches unused in the profile
+    bool                m_prefetch;             ///< read ahead in the background
+    FilePrefetcher*     m_prefetcher;           //!< warms up the next file of the chain
+    bool                m_parallelUnzip;        ///< unzip the cached baskets on helper threads
+    bool                m_readPerfStats;        ///< monitor the reading with D3PDPerfStats
+    uint                m_batchSize;            ///< entries per batch, 0 for no batches
+
+    bool                m_useSummary;           ///< preselect on the summary tree
+    Susy::SusyNtSummary m_summary;              //!< summary of the current entry
+    TFile*              m_summaryFile;          //!< summary of the current input file
+    TTree*              m_summaryTree;          //!< summary tree, 0 if not available
+    uint                m_summaryCounts[3];     ///< entries checked, rejected, rejected by zone
+    uint                m_prunedEntries;        ///< entries of the zones dropped by pruneChain
+    std::vector<Susy::SusyNtZone> m_zones;      //!< zone map of the current input file
+    std::vector<bool>   m_zonePass;             //!< passZone of each zone
+    uint                m_zone;                 //!< zone of the last entry
+    bool                m_sumwBuilt;            ///< MC normalization built by pruneChain
+    /// Is an entry in a zone rejected by passZone
+    bool rejectedByZone(Long64_t entry);
+
+    std::string         m_skimFile;             ///< skim output, empty for none
+    std::string         m_skimStage;            ///< cut stage of the skimmed entries
+    std::string         m_skimBranches;         ///< branches of the skim, empty for all
+    std::vector<std::string> m_skimInputs;      ///< input files, for the cutflow histograms
+    Susy::SusyNtSkimWriter* m_skimWriter;       //!< skim part of this process
+    Long64_t            m_skimmed;              //!< last entry written to the skim
+    std::string         m_columnCacheFile;      ///< column cache, empty for none
+    Susy::SusyNtColumnCache* m_columnCache;     //!< column cache mapped by this process
+    /// Serve the current tree from the column cache if it is cached
+    void setCacheSource();
+
+    /// Merge the skim parts of the workers
+    void mergeSkim();
+    /// Open the summary of the current input file
+    void openSummary();
+    void closeSummary();
+    /// Read the batch starting at an entry of the current tree
+    void readBatch(Long64_t entry);
+    /// Configure the TTreeCache and the branch status of the tree from the profile
+    void applyCacheProfile(TTree* tree);
+    /// Write the branch access of this run, merged over workers, to the profile
+    void saveCacheProfile();
+    /// Print the reading statistics, merged over workers
+    void dumpReadPerfStats();
+
 };
 
 
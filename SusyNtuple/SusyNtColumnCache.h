@@ -0,0 +1,147 @@
+#ifndef SusyNtuple_SusyNtColumnCache_h
+#define SusyNtuple_SusyNtColumnCache_h
+
+#include <string>
+#include <vector>
+
+#include "TChain.h"
+#include "TClass.h"
+
+#include "SusyNtuple/SusyNt.h"
+
+namespace Susy
+{
+
+  /// Memory-mapped columnar copy of SusyNt files, for repeated passes over the same inputs
+  /**
+     The cache holds the objects of each branch as they are in memory after
+     reading the SusyNt, one column per persistent data member, uncompressed.
+     The file is mapped read-only, so reading an entry is a copy of the
+     member values into the objects, without unzipping or streaming, and
+     the processes of a node share the pages of the mapping.
+
+     The columns are the data members found in the streamer info of each
+     class, the TObject base excepted. The member offsets are taken from the
+     classes of the reading job, so the cache is checked against the class
+     layout when it is opened and has to be remade if a class changes. The
+     entries are stored in blocks of blockSize entries: per block, the
+     object offsets of each branch, then its columns.
+
+     The cache knows the files it was made from, with their number of
+     entries: SusyNtObject::ReadFromCache serves the cached files from the
+     mapping and reads the others from the tree as usual.
+
+     Usage:
+       SusyNtColumnCache::makeCacheFile(chain, "sample.sntc");   // once
+       ...
+       SusyNtColumnCache cache;
+       cache.open("sample.sntc");
+       nt.ReadFromCache(&cache);
+       nt.SetCacheSource(fileName, nEntries);    // for each tree
+  */
+  class SusyNtColumnCache
+  {
+    public:
+      SusyNtColumnCache();
+      ~SusyNtColumnCache();
+
+      /// Map a cache file, false on error or if it doesn't match the classes
+      bool open(const std::string& fileName);
+      /// Unmap the file
+      void close();
+
+      bool isOpen() const { return m_data != 0; }
+      const std::string& fileName() const { return m_fileName; }
+      /// Entries of all the source files
+      Long64_t nEntries() const { return m_nEntries; }
+
+      /// First entry of a source file in the cache, -1 if not cached or if the entries differ
+      Long64_t sourceOffset(const std::string& fileName, Long64_t nEntries) const;
+      /// Index of a cached branch, -1 if the branch of these objects is not cached
+      int collection(const std::string& branch, const std::string& className) const;
+
+      /// Number of objects of a branch in an entry of the cache
+      Long64_t nObjects(int coll, Long64_t entry) const;
+      /// Copy the columns of the objects of an entry into objects laid out every stride bytes
+      void fillObjects(int coll, Long64_t entry, char* first, size_t stride) const;
+
+      /// Read the objects of an entry of the cache into a vector, false if out of range
+      template<class T>
+      bool read(int coll, Long64_t entry, std::vector<T>& objects) const
+      {
+        if(entry < 0 || entry >= m_nEntries) return false;
+        objects.resize(nObjects(coll, entry));
+        if(!objects.empty()) fillObjects(coll, entry, (char*) &objects[0], sizeof(T));
+        return true;
+      }
+      /// Read the event of an entry of the cache, false if out of range
+      bool read(int coll, Long64_t entry, Event& evt) const;
+
+      /// Write the cache of the files of a chain, false on error
+      static bool makeCacheFile(TChain* chain, const std::string& fileName,
+                                Long64_t blockSize=DefaultBlockSize);
+
+      /// Entries per block
+      static const Long64_t DefaultBlockSize = 10000;
+
+      /// A persistent data member, at an offset in the object
+      struct Column {
+        std::string name;       ///< member name, with the path of the enclosing members
+        Long64_t offset;        ///< offset in the object in this job
+        Long64_t size;          ///< bytes, the whole array for array members
+      };
+      /// The columns of a class, false if it has members that can't be cached (pointers, STL, ...)
+      static bool classColumns(TClass* cl, std::vector<Column>& columns);
+      /// Are two objects of a class equal in every column, byte for byte
+      static bool sameObjects(TClass* cl, const void* a, const void* b);
+      /// Are two vectors of objects equal in size and in every column of every object
+      template<class T>
+      static bool sameObjects(const std::vector<T>& a, const std::vector<T>& b)
+      {
+        if(a.size() != b.size()) return false;
+        for(uint i=0; i<a.size(); i++) if(!sameObjects(T::Class(), &a[i], &b[i])) return false;
+        return true;
+      }
+
+    protected:
+
+      /// Source file of a range of entries
+      struct Source {
+        std::string name;
+        Long64_t first;
+        Long64_t n;
+      };
+      /// Cached branch
+      struct Collection {
+        std::string branch;
+        std::string className;
+        std::vector<Column> columns;    ///< in file order, offsets of this job
+      };
+      /// Block of entries in the mapping
+      struct Block {
+        Long64_t first;
+        Long64_t n;
+        std::vector<const Long64_t*> index;             ///< per branch, n+1 object offsets
+        std::vector< std::vector<const char*> > data;   ///< per branch and column
+      };
+
+      /// Read the manifest and the block table of the mapping
+      bool readLayout();
+
+      std::string m_fileName;
+      char* m_data;                     ///< the mapping, 0 if not open
+      size_t m_size;                    ///< bytes mapped
+      Long64_t m_nEntries;
+      Long64_t m_blockSize;
+      std::vector<Source> m_sources;
+      std::vector<Collection> m_collections;
+      std::vector<Block> m_blocks;
+
+    private:
+      SusyNtColumnCache(const SusyNtColumnCache&);
+      SusyNtColumnCache& operator=(const SusyNtColumnCache&);
+  };
+
+};
+
+#endif
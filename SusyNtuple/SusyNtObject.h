@@ -4,11 +4,14 @@
 #include "TTree.h"
 
 #include "SusyNtuple/VarHandle.h"
+#include "SusyNtuple/D3PDReadStats.h"
 #include "SusyNtuple/SusyNt.h"
 
 
 namespace Susy
 {
+  class SusyNtColumnCache;
+
   /// An interface class for accessing SusNt objects
   class SusyNtObject : public TObject
   {
@@ -18,16 +21,57 @@ namespace Susy
       SusyNtObject();
       /// Constructor for reading and writing
       SusyNtObject(const Long64_t& entry);
+      ~SusyNtObject();
   
       /// Set branches active for writing
       // I will later add flags here for controlling systematics
       void SetActive();
+      /// Set only the listed branches active, comma separated (e.g. "event,muons,met")
+      /** The event is always active. Unknown names are reported, false if any. */
+      bool SetActive( const std::string& branches );
       /// Connect the objects to an output tree
       void WriteTo( TTree* tree );
       /// Connect the objects to an input tree
       void ReadFrom( TTree* tree );
       /// Clear variables when in read mode
       void clear();
+      /// Entries and bytes read from each branch so far
+      D3PDReader::D3PDReadStats GetReadStats() const;
+      /// Switch off the branches not read in a profiled run
+      /**
+         Branches listed with entries in the profile, or already read in this
+         job, stay on. A handle reading a branch that was switched off turns
+         it back on, see VarHandleBase::SetActivateBranches.
+      */
+      void DisableUnusedBranches( TTree* tree, const D3PDReader::D3PDReadStats& profile );
+
+      /// Read n consecutive entries of the current tree in one go
+      /**
+         Each branch in use fills the entries into its batch buffers in one
+         call, the handles then serve these entries without reading. A
+         branch is in use when it was accessed for at least half of the
+         entries of the previous batch; the others keep being read one
+         entry at a time. The event is always batched. Call ClearBatch when
+         the tree changes.
+      */
+      void ReadBatch( Long64_t first, Long64_t n );
+      /// Drop the batch of all the branches
+      void ClearBatch();
+      /// Is the entry in the current batch
+      bool InBatch( Long64_t entry ) const { return evt.InBatch(entry); }
+
+      /// Serve the cached branches from a column cache, 0 to read the tree again
+      /**
+         The cache is not owned. Nothing is served until SetCacheSource
+         finds the current file in the cache, the other files are read from
+         the tree. See SusyNtColumnCache.
+      */
+      void ReadFromCache( const SusyNtColumnCache* cache );
+      /// Serve the current tree from the cache, false if it isn't cached
+      /** Call when the tree changes, with its file as added to the chain */
+      bool SetCacheSource( const std::string& fileName, Long64_t nEntries );
+      /// Are the entries of the current tree served from the cache
+      bool FromCache() const { return m_cacheOffset >= 0; }
 
       //
       // SusyNt variables
@@ -59,6 +103,12 @@ namespace Susy
 
     protected:
 
+      /// All the handles, for the operations on every branch
+      std::vector<D3PDReader::VarHandleBase*> handles();
+
+      const SusyNtColumnCache* m_cache;                 //!< column cache, 0 for none
+      Long64_t m_cacheOffset;                           //!< cache entry of the first entry of the tree, -1 if not cached
+      std::vector<D3PDReader::VarReader*> m_cacheReaders; //!< readers of the cached branches
   
   };
 
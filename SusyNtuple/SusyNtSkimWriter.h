@@ -0,0 +1,81 @@
+#ifndef SusyNtuple_SusyNtSkimWriter_h
+#define SusyNtuple_SusyNtSkimWriter_h
+
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include "SusyNtuple/SusyNtObject.h"
+
+namespace Susy
+{
+
+  /// Writes selected entries of a SusyNt to a reduced SusyNt
+  /**
+     The output has the same susyNt tree and branch classes, so SusyNtAna
+     reads it unchanged, with only the requested branches. The
+     four-vectors of the objects are reset to their nominal pt, eta, phi
+     and m, so the systematic shift left by the object selection is not
+     written, see test_skimRoundTrip. The systematic cutFlags of the Event
+     are stored as deltas to the nominal ones, unless setPackCutFlags(false).
+
+     A skim is written in parts, one per process, then merged with the
+     genCutFlow and procCutFlow* histograms of all the input files, so
+     MCWeighter computes the same sumw as on the full input. As for
+     MCWeighter, one output should hold a single complete dataset.
+
+     Usage:
+       SusyNtSkimWriter writer;
+       writer.open("part.root", "event,muons,electrons,met");
+       ...
+       writer.fill(nt);                    // for each selected entry
+       ...
+       writer.close();
+       SusyNtSkimWriter::mergeFiles(parts, inputFiles, "skim.root");
+  */
+  class SusyNtSkimWriter
+  {
+    public:
+      SusyNtSkimWriter();
+      ~SusyNtSkimWriter();
+
+      /// Create the output file, comma separated branch names, empty for all
+      bool open(const std::string& fileName, const std::string& branches="");
+      /// Write the current entry of the input objects
+      void fill(SusyNtObject& in);
+      /// Write the tree and close the file
+      void close();
+
+      /// Delta encoding of the systematic cutFlags (default true), see Event::packCutFlags
+      void setPackCutFlags(bool pack=true) { m_packCutFlags = pack; }
+
+      bool isOpen() const { return m_file != 0; }
+      const std::string& fileName() const { return m_fileName; }
+      /// Entries written so far
+      Long64_t nWritten() const { return m_nWritten; }
+
+      /// Merge the skim parts and add the cutflow histograms of the inputs, false on error
+      static bool mergeFiles(const std::vector<std::string>& parts,
+                             const std::vector<std::string>& inputs,
+                             const std::string& output);
+      /// Is a histogram used for the MC normalization, see MCWeighter
+      static bool isCutflowHisto(const std::string& name);
+
+    protected:
+      std::string m_fileName;   ///< output file
+      TFile* m_file;            ///< output file, 0 if not open
+      TTree* m_tree;            ///< output tree, belongs to the file
+      SusyNtObject m_out;       ///< output objects, only the requested branches active
+      Long64_t m_nWritten;      ///< entries written
+      bool m_packCutFlags;      ///< delta encoding of the systematic cutFlags
+
+    private:
+      SusyNtSkimWriter(const SusyNtSkimWriter&);
+      SusyNtSkimWriter& operator=(const SusyNtSkimWriter&);
+  };
+
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef SusyNtuple_SusyNtSummary_h
+#define SusyNtuple_SusyNtSummary_h
+
+#include <string>
+#include <vector>
+
+#include "TTree.h"
+#include "TFile.h"
+
+#include "SusyNtuple/SusyDefs.h"
+
+namespace Susy
+{
+
+  class SusyNtObject;
+  class EventView;
+
+  /// Per-entry summary of a SusyNt tree, stored in a friend tree
+  /**
+     A few bytes per entry, written next to each SusyNt file, so that a
+     preselection can be evaluated before reading the object branches.
+     The object counts and leading pts are upper bounds over all the
+     systematics: an object is counted when its pt passes the
+     pre-selection cut for at least one systematic (EventView envelope),
+     with or without the n0150 muon bug fix.
+     A predicate requiring at least n objects is therefore safe for any
+     systematic.
+
+     The summary of file.root is file.summary.root, with the tree
+     susyNtSummary in the same entry order, so it can also be used with
+     TTree::AddFriend. The file also holds the zone map, the tree
+     susyNtZones: for each basket cluster of the SusyNt tree, the max of
+     the summaries of its entries, see SusyNtZone.
+
+     Usage:
+       SusyNtSummary::makeSummaryFile("file.root");    // once per file
+       ...
+       summary.readFrom(summaryTree);
+       summaryTree->GetEntry(entry);
+       if(summary.nEle + summary.nMuo < 2) skip
+  */
+  class SusyNtSummary
+  {
+    public:
+      SusyNtSummary() { clear(); }
+
+      // Summary variables
+      unsigned int run;
+      unsigned int event;
+      unsigned int mcChannel;
+      long long trigFlags;
+      unsigned int cutFlags;    ///< nominal cut flags
+      int nEle;                 ///< electrons above ELECTRON_PT_CUT for some systematic
+      int nMuo;                 ///< muons above MUON_PT_CUT for some systematic
+      int nTau;                 ///< taus above TAU_PT_CUT for some systematic
+      int nJet;                 ///< jets above JET_PT_CUT for some systematic
+      float lep0Pt;             ///< max pt of the leptons over the systematics
+      float lep1Pt;             ///< second highest lepton pt, same definition
+      float jet0Pt;             ///< max pt of the jets over the systematics
+      float met[NtSys_N];       ///< met Et for each systematic, 0 if not stored
+
+      int nLep() const { return nEle + nMuo; }
+
+      /// Reset the variables
+      void clear();
+      /// Take the max of each variable with another summary, OR of the flags.
+      /** The run, event and mcChannel of the first summary are kept. */
+      void merge(const SusyNtSummary& other);
+      /// Fill the summary of the current entry
+      void fill(SusyNtObject* susyNt, EventView& view);
+
+      /// Create the branches in an output tree
+      void writeTo(TTree* tree);
+      /// Connect the variables to an input summary tree
+      void readFrom(TTree* tree);
+
+      /// Name of the summary tree
+      static const char* treeName() { return "susyNtSummary"; }
+      /// Name of the zone map tree
+      static const char* zoneTreeName() { return "susyNtZones"; }
+      /// Summary file of a SusyNt file, file.root -> file.summary.root
+      static std::string fileName(const std::string& susyNtFile);
+      /// Write the summary file of a SusyNt file, false on error
+      static bool makeSummaryFile(const std::string& susyNtFile, const std::string& summaryFile="");
+  };
+
+  /// Range of entries of a SusyNt file with the max of their summaries
+  /**
+     A predicate that can only pass when a count, pt or flag is large
+     enough fails for every entry of the zone if it fails on the max.
+     The whole zone can then be skipped.
+  */
+  class SusyNtZone
+  {
+    public:
+      SusyNtZone() : first(0), n(0) {}
+
+      Long64_t first;           ///< first entry
+      Long64_t n;               ///< number of entries
+      SusyNtSummary max;        ///< max of the summaries of the entries
+
+      bool contains(Long64_t entry) const { return entry >= first && entry < first + n; }
+      /// Extend the zone to cover another zone
+      void merge(const SusyNtZone& other);
+
+      /// Create the branches in an output tree
+      void writeTo(TTree* tree);
+      /// Connect the variables to an input zone tree
+      void readFrom(TTree* tree);
+
+      /// Read the zone map of a summary file, false if not available
+      static bool readZones(TFile* summaryFile, std::vector<SusyNtZone>& zones);
+      /// Read the zone map of a summary file by name, false if not available
+      static bool readFileZones(const std::string& summaryFile, std::vector<SusyNtZone>& zones);
+      /// Zone covering a whole SusyNt file, from its summary file
+      static bool readFileZone(const std::string& summaryFile, SusyNtZone& zone);
+  };
+
+};
+
+#endif
@@ -7,6 +7,8 @@
 #include "SusyNtuple/SusyDefs.h"
 #include "SusyNtuple/SusyNt.h"
 #include "SusyNtuple/SusyNtObject.h"
+#include "SusyNtuple/EventView.h"
+#include "SusyNtuple/IsolationContext.h"
 #include "SusyNtuple/MCWeighter.h"
 #include "SUSYTools/BTagCalib.h"
 #include "SUSYTools/SUSYCrossSection.h"
@@ -22,6 +24,7 @@ class SusyNtTools
     SusyNtTools();
     virtual ~SusyNtTools(){
       if(m_btagTool) delete m_btagTool;
+      if(m_jvfTool) delete m_jvfTool;
     };
 
     /// Set Analysis type to determine selection
@@ -44,6 +47,23 @@ class SusyNtTools
     MuonVector     getPreMuons(Susy::SusyNtObject* susyNt, SusyNtSys sys, bool n0150BugFix=false);
     TauVector      getPreTaus(Susy::SusyNtObject* susyNt, SusyNtSys sys);
     JetVector      getPreJets(Susy::SusyNtObject* susyNt, SusyNtSys sys);
+
+    /// 'Pre' Objects using the EventView kinematics table of the current entry.
+    /** The cuts run on the table for the desired systematic. Only the selected objects
+        get their four-momentum set, the other ntuple objects are left untouched. */
+    ElectronVector getPreElectrons(Susy::SusyNtObject* susyNt, const Susy::EventView& view, SusyNtSys sys);
+    MuonVector     getPreMuons(Susy::SusyNtObject* susyNt, const Susy::EventView& view, SusyNtSys sys);
+    TauVector      getPreTaus(Susy::SusyNtObject* susyNt, const Susy::EventView& view, SusyNtSys sys);
+    JetVector      getPreJets(Susy::SusyNtObject* susyNt, const Susy::EventView& view, SusyNtSys sys);
+    /// Same as above, filling the supplied vectors so their storage is reused between events
+    void getPreElectrons(Susy::SusyNtObject* susyNt, const Susy::EventView& view, SusyNtSys sys, 
+                         ElectronVector& elecs);
+    void getPreMuons(Susy::SusyNtObject* susyNt, const Susy::EventView& view, SusyNtSys sys, 
+                     MuonVector& muons);
+    void getPreTaus(Susy::SusyNtObject* susyNt, const Susy::EventView& view, SusyNtSys sys, 
+                    TauVector& taus);
+    void getPreJets(Susy::SusyNtObject* susyNt, const Susy::EventView& view, SusyNtSys sys, 
+                    JetVector& jets);
   
     /// Get Baseline objects. Pre + overlap removal.
     /** First method provides the pre-selected objects before OR and baseline objects after OR. */
@@ -51,6 +71,16 @@ class SusyNtTools
                             ElectronVector& preElecs, MuonVector& preMuons, JetVector& preJets,
                             ElectronVector& elecs, MuonVector& muons, TauVector& taus, JetVector& jets, 
                             SusyNtSys sys, bool selectTaus=false, bool n0150BugFix=false);
+    /// Same as above, with the preselection done on the EventView. Also provides the pre-selected taus.
+    void getBaselineObjects(Susy::SusyNtObject* susyNt, const Susy::EventView& view,
+                            ElectronVector& preElecs, MuonVector& preMuons, TauVector& preTaus, 
+                            JetVector& preJets,
+                            ElectronVector& elecs, MuonVector& muons, TauVector& taus, JetVector& jets, 
+                            SusyNtSys sys, bool selectTaus=false);
+    /// Baseline objects from already pre-selected objects: overlap removal and low mass SFOS removal
+    void getBaselineObjects(const ElectronVector& preElecs, const MuonVector& preMuons, 
+                            const TauVector& preTaus, const JetVector& preJets,
+                            ElectronVector& elecs, MuonVector& muons, TauVector& taus, JetVector& jets);
     /// Second method only provides the baseline objects after OR.
     void getBaselineObjects(Susy::SusyNtObject* susyNt, ElectronVector& elecs, 
                             MuonVector& muons, TauVector& taus, JetVector& jets, 
@@ -66,6 +96,18 @@ class SusyNtTools
                                  TauID tauEleID=TauID_loose, TauID tauMuoID=TauID_medium);
     JetVector      getSignalJets(const JetVector& baseJets, SusyNtSys sys=NtSys_NOM);
     JetVector      getSignalJets2Lep(const JetVector& baseJets, SusyNtSys sys=NtSys_NOM);
+    /// Signal jets with the kinematic cuts done on the EventView table first
+    JetVector      getSignalJets(const JetVector& baseJets, const Susy::EventView& view, SusyNtSys sys);
+    JetVector      getSignalJets2Lep(const JetVector& baseJets, const Susy::EventView& view, SusyNtSys sys);
+    /// Signal objects filled into the supplied vectors, which are cleared first
+    void getSignalElectrons(const ElectronVector& baseElecs, const MuonVector& baseMuons, 
+                            uint nVtx, bool isMC, bool removeLepsFromIso, ElectronVector& sigElecs);
+    void getSignalMuons(const MuonVector& baseMuons, const ElectronVector& baseElecs, 
+                        uint nVtx, bool isMC, bool removeLepsFromIso, MuonVector& sigMuons);
+    void getSignalJets(const JetVector& baseJets, const Susy::EventView& view, SusyNtSys sys, 
+                       JetVector& sigJets);
+    void getSignalJets2Lep(const JetVector& baseJets, const Susy::EventView& view, SusyNtSys sys, 
+                           JetVector& sigJets);
 
     /// Get the signal objects
     void getSignalObjects(const ElectronVector& baseElecs, const MuonVector& baseMuons, 
@@ -93,6 +135,14 @@ class SusyNtTools
                           JetVector& sigJets, JetVector& sigJets2Lep,
                           uint nVtx, bool isMC, bool removeLepsFromIso=false,
                           SusyNtSys sys=NtSys_NOM);
+    /// Same as above, with the jet kinematic cuts done on the EventView
+    void getSignalObjects(const Susy::EventView& view,
+                          const ElectronVector& baseElecs, const MuonVector& baseMuons, 
+                          const TauVector& baseTaus, const JetVector& baseJets, 
+                          ElectronVector& sigElecs, MuonVector& sigMuons, 
+                          TauVector& mediumTaus, TauVector& tightTaus, 
+                          JetVector& sigJets, JetVector& sigJets2Lep,
+                          uint nVtx, bool isMC, bool removeLepsFromIso, SusyNtSys sys);
     
     /// Check if selected object
     bool isTauBDT(const Susy::Tau* tau, TauID tauJetID=TauID_medium, 
@@ -119,6 +169,13 @@ class SusyNtTools
     bool isSignalJet2Lep(const Susy::Jet* jet, SusyNtSys sys=NtSys_NOM);
 
 
+    /// Column based cuts on an EventView collection for one systematic, 
+    /// filling the indices of the passing entries
+    static void selectByPt(const Susy::ObjectColumns& c, SusyNtSys sys, float minPt, 
+                           std::vector<uint>& idx);
+    static void selectByPtEta(const Susy::ObjectColumns& c, SusyNtSys sys, float minPt, 
+                              float maxAbsEta, std::vector<uint>& idx);
+
     /// Build Lepton vector - we should probably sort them here
     void buildLeptons(LeptonVector &lep, ElectronVector& ele, MuonVector& muo)
     {
@@ -137,6 +194,18 @@ class SusyNtTools
                        uint nVtx, bool isMC, bool removeLeps=false);
     float muEtConeCorr(const Susy::Muon* mu, const ElectronVector& baseElectrons, const MuonVector& baseMuons, 
                        uint nVtx, bool isMC, bool removeLeps=false);
+    /// Same corrections with the nearby leptons subtracted, for lepton iLep of an isolation context
+    float elPtConeCorr(const Susy::IsolationContext& iso, uint iLep, uint nVtx, bool isMC);
+    float elEtTopoConeCorr(const Susy::IsolationContext& iso, uint iLep, uint nVtx, bool isMC);
+    float muPtConeCorr(const Susy::IsolationContext& iso, uint iLep, uint nVtx, bool isMC);
+    float muEtConeCorr(const Susy::IsolationContext& iso, uint iLep, uint nVtx, bool isMC);
+    /// Fill the isolation context of these baseline leptons, used by isSignalElectron/Muon until cleared.
+    /** The signal lepton selections fill it before their lepton loops and
+        clear it after. Without a context, the cone corrections loop over
+        the baseline leptons for each lepton. */
+    void buildIsolationContext(const ElectronVector& baseElectrons, const MuonVector& baseMuons);
+    /// Forget the isolation context, e.g. when a new entry is read
+    void clearIsolationContext() { m_isoCtx.clear(); }
   
     /// Get the Met, for the appropriate systematic
     Susy::Met* getMet(Susy::SusyNtObject* susyNt, SusyNtSys sys);//, bool useNomPhiForMetSys = true);
@@ -146,7 +215,11 @@ class SusyNtTools
     //
   
     /// Perform all overlap on pre objects  
+    /** Evaluates the removal sequence below on survivor bitmasks, with the delta R
+        of each pair computed once. Collections above 64 objects use performOverlapSequential. */
     virtual void performOverlap(ElectronVector& elecs, MuonVector& muons, TauVector& taus, JetVector& jets);
+    /// Same removal, running the pairwise methods below one after the other
+    void performOverlapSequential(ElectronVector& elecs, MuonVector& muons, TauVector& taus, JetVector& jets);
 
     /// e-e overlap
     void e_e_overlap(ElectronVector& elecs, float minDr);
@@ -156,7 +229,7 @@ class SusyNtTools
                      bool removeJets = true);
   
     /// m-j overlap
-    void m_j_overlap(MuonVector& muons, JetVector jets, float minDr);
+    void m_j_overlap(MuonVector& muons, const JetVector& jets, float minDr);
 
     /// e-m overlap 
     void e_m_overlap(ElectronVector& elecs, MuonVector& muons, float minDr);
@@ -422,8 +495,24 @@ class SusyNtTools
     bool m_doMuEtconeCut;               ///< etcone isolation cuts for muons
     bool m_doIPCut;                     ///< impact parameter cuts
 
-    static BTagCalib* m_btagTool;     ///< BTag tool
+    BTagCalib* m_btagTool;            ///< BTag tool
     JVFUncertaintyTool* m_jvfTool;    ///< JVF tool
+
+    // Scratch buffers, owned by each instance so that independent selections
+    // can run concurrently. They keep their capacity from event to event.
+    std::vector<char>  m_removeEle;   ///< electrons flagged by overlap removal
+    std::vector<char>  m_removeMuo;   ///< muons flagged by overlap removal
+    std::vector<char>  m_removeTau;   ///< taus flagged by the SFOS pair removal
+    std::vector<float> m_btagPt;      ///< bTagSF input jet pt [MeV]
+    std::vector<float> m_btagEta;     ///< bTagSF input jet eta
+    std::vector<float> m_btagVal;     ///< bTagSF input jet MV1 weight
+    std::vector<int>   m_btagPdgId;   ///< bTagSF input jet truth label
+    std::vector<uint>  m_viewIdx;     ///< EventView indices passing a column cut
+    std::vector<double> m_orPt;       ///< overlap removal cached pt, all collections
+    std::vector<double> m_orEta;      ///< overlap removal cached eta
+    std::vector<double> m_orPhi;      ///< overlap removal cached phi
+    std::vector<double> m_orDr;       ///< overlap removal delta R of the checked pairs
+    Susy::IsolationContext m_isoCtx;  ///< isolation inputs of the current signal lepton selection
  private:
     /// check whether this jet comes from the primary vertex; the JVF criterion can be applied only within some pt/eta range
     static bool jetPassesJvfRequirement(const Susy::Jet* jet, JVFUncertaintyTool* jvfTool,
@@ -3,6 +3,9 @@
 #ifndef D3PDREADER_VARHANDLE_H
 #define D3PDREADER_VARHANDLE_H
 
+// System include(s):
+#include <vector>
+
 // ROOT include(s):
 #include <TString.h>
 #include <TDataType.h>
@@ -17,6 +20,28 @@ class TBranch;
 
 namespace D3PDReader {
 
+   /**
+    *  @short Interface for serving the entries of a variable from another source
+    *
+    *         A VarHandle with a reader asks it for each new entry before
+    *         reading its branch, see VarHandleBase::SetReader.
+    */
+   class VarReader {
+
+   public:
+      virtual ~VarReader() {}
+
+      /// Fill the variable with an entry of the current tree
+      /**
+       * @param entry Entry in the current tree
+       * @param variable Pointer to the object of the handle
+       * @returns <code>kFALSE</code> if the entry is not available, the
+       *          branch is then read instead
+       */
+      virtual ::Bool_t ReadEntry( ::Long64_t entry, void* variable ) = 0;
+
+   }; // class VarReader
+
    /**
     *  @short Base class for the different kind of VarHandle specializations
     *
@@ -85,7 +110,56 @@ namespace D3PDReader {
       /// Get information about the read statistics
       virtual VariableStats GetStatistics() const;
 
+      /// Enable the branch status when connecting to a branch.
+      /**
+       * Needed when unused branches were switched off with SetBranchStatus,
+       * so that a handle reading a disabled branch still gets its data.
+       * The default is set by the ACTIVATE_BRANCHES compile flag.
+       */
+      static void SetActivateBranches( ::Bool_t activate = kTRUE );
+      static ::Bool_t GetActivateBranches();
+
+      /// Read n consecutive entries of the current tree into the batch buffers
+      /**
+       * The entries are then served from the buffers, without a TBranch
+       * call per entry. The batch is dropped with ClearBatch, which has to
+       * be called when the tree changes.
+       */
+      ::Bool_t ReadBatch( ::Long64_t first, ::Long64_t n );
+      /// Drop the batch, entries are read one at a time again
+      void ClearBatch();
+      /// Check if an entry is in the current batch
+      ::Bool_t InBatch( ::Long64_t entry ) const;
+      /// Number of entries in the current batch
+      ::Long64_t GetBatchSize() const;
+      /// Number of different entries accessed since the batch was last read or dropped
+      ::Long64_t GetUseCount() const;
+
+      /// Serve the entries from a reader before reading the branch, 0 for none
+      /**
+       * The reader is not owned. Setting it again forgets the entry it last
+       * provided, which has to be done when the tree changes.
+       */
+      void SetReader( VarReader* reader );
+      /// The reader serving the entries, 0 if the branch is read
+      VarReader* GetReader() const;
+
    protected:
+      /// Connect to the input branch for reading a batch
+      /**
+       * Returns kFALSE if the variable type can't be read in batches. Only
+       * the object handles can, which covers all the SusyNt branches.
+       */
+      virtual ::Bool_t ConnectBatch() const;
+      /// Move the entry just read into slot i of the batch buffers
+      virtual void StoreBatchEntry( ::Long64_t i ) const;
+      /// Slot of the current entry in the batch, or -1. Counts the access.
+      ::Long64_t BatchIndex() const;
+      /// Count an access to the current entry
+      void CountUse() const;
+      /// Fill the variable from the reader, kFALSE if it can't provide the entry
+      ::Bool_t ReadFromReader( void* var ) const;
+
       /// Connect the variable to the branch
       ::Bool_t ConnectVariable( void* var, ::TClass* realClass,
                                 EDataType dtype, Bool_t isptr ) const;
@@ -104,8 +178,16 @@ namespace D3PDReader {
       ::TTree* fInTree; ///< The input TTree
       mutable ::TBranch* fInBranch; /// The input branch belonging to this variable
       mutable BranchAvailability fAvailable; ///< Availability of the branch
+      ::Long64_t fBatchFirst; ///< First entry of the batch
+      ::Long64_t fBatchSize; ///< Number of entries in the batch, 0 for none
+      mutable ::Long64_t fLastUsed; ///< Last entry accessed
+      mutable ::Long64_t fUseCount; ///< Entries accessed since the last batch
+      VarReader* fReader; ///< Source of the entries before the branch, not owned
+      mutable ::Long64_t fReaderEntry; ///< Entry last provided by the reader
 
    private:
+      static ::Bool_t fgActivateBranches; ///< Enable branches on connection
+
       ::TString fName; ///< Name of the branch to handle
       ::Bool_t fActive; ///< Flag telling if the variable can be written to the output
 
@@ -206,8 +288,20 @@ namespace D3PDReader {
       /// "Clear" the variable of its contents
       virtual void Clear();
 
+      /// Access an entry of the batch directly, for loops over the batch
+      result_type GetBatchEntry( ::Long64_t i ) const;
+
+   protected:
+      /// Connect to the input branch for reading a batch
+      virtual ::Bool_t ConnectBatch() const;
+      /// Swap the entry just read into slot i of the batch buffers
+      virtual void StoreBatchEntry( ::Long64_t i ) const;
+
    private:
       mutable Type* fVariable; ///< The variable in memory
+      /// Batch of entries, see ReadBatch. Kept between batches, so the
+      /// containers keep their capacity.
+      mutable std::vector< Type* > fBatch;
 
    }; // class VarHandle
 
@@ -1,12 +1,15 @@
 
 #include <cstdlib>
 #include <string>
+#include <vector>
 
 #include "TChain.h"
+#include "TEntryList.h"
 #include "Cintex/Cintex.h"
 
 #include "SusyNtuple/Susy2LepCutflow.h"
 #include "SusyNtuple/ChainHelper.h"
+#include "SusyNtuple/ParallelDriver.h"
 
 using namespace std;
 
@@ -34,6 +37,54 @@ void help()
   cout << "  -s sample name, for naming files"  << endl;
   cout << "     defaults: ntuple sample name"   << endl;
 
+  cout << "  -j number of parallel workers"     << endl;
+  cout << "     defaults: 1"                    << endl;
+
+  cout << "  -y systematics, comma separated"   << endl;
+  cout << "     or ALL, e.g. NOM,JES_UP,JES_DN" << endl;
+  cout << "     defaults: NOM"                  << endl;
+
+  cout << "  -o counter histogram output file"  << endl;
+  cout << "     defaults: '' (no output file)"  << endl;
+
+  cout << "  -c branch access profile, trains"  << endl;
+  cout << "     the TTreeCache and is updated"  << endl;
+  cout << "     defaults: '' (no profile)"      << endl;
+
+  cout << "  -B switch off the branches unused" << endl;
+  cout << "     in the -c profile"              << endl;
+
+  cout << "  -P prefetch the next file and baskets" << endl;
+  cout << "     in the background"              << endl;
+
+  cout << "  -Z unzip the baskets on helper threads" << endl;
+
+  cout << "  -R print the reading statistics"   << endl;
+
+  cout << "  -b read the entries in batches"    << endl;
+  cout << "     defaults: 0 (one at a time)"    << endl;
+
+  cout << "  -U skip entries on the summary"    << endl;
+  cout << "     files, see SusyNtSummaryMaker"  << endl;
+
+  cout << "  -K skim output file, entries"      << endl;
+  cout << "     passing the -T stage"           << endl;
+  cout << "     defaults: '' (no skim)"         << endl;
+
+  cout << "  -T skim cut stage or region"       << endl;
+  cout << "     defaults: mll"                  << endl;
+
+  cout << "  -W skim branches, comma separated" << endl;
+  cout << "     e.g. event,muons,electrons,met" << endl;
+  cout << "     defaults: '' (all branches)"    << endl;
+
+  cout << "  -M column cache file, see"         << endl;
+  cout << "     SusyNtColumnCacheMaker"         << endl;
+  cout << "     defaults: '' (read the trees)"  << endl;
+
+  cout << "  -F only count the full signal"      << endl;
+  cout << "     regions, reordering their cuts" << endl;
+
   cout << "  -h print this help"                << endl;
 }
 
@@ -44,6 +95,21 @@ int main(int argc, char** argv)
   int nEvt = -1;
   int nSkip = 0;
   int dbg = 0;
+  int nWorkers = 1;
+  bool srOnly = false;
+  string sysNames = "NOM";
+  string outFile;
+  string cacheProfile;
+  bool disableBranches = false;
+  bool prefetch = false;
+  bool parallelUnzip = false;
+  bool readStats = false;
+  int batchSize = 0;
+  bool useSummary = false;
+  string skimFile;
+  string skimStage = "mll";
+  string skimBranches;
+  string columnCache;
   string sample;
   string input;
   cout << "Susy2LepCutflow" << endl;
@@ -54,8 +120,23 @@ int main(int argc, char** argv)
     if      (strcmp(argv[i], "-n") == 0) nEvt = atoi(argv[++i]);
     else if (strcmp(argv[i], "-k") == 0) nSkip = atoi(argv[++i]);
     else if (strcmp(argv[i], "-d") == 0) dbg = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-j") == 0) nWorkers = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-y") == 0) sysNames = argv[++i];
+    else if (strcmp(argv[i], "-o") == 0) outFile = argv[++i];
+    else if (strcmp(argv[i], "-c") == 0) cacheProfile = argv[++i];
+    else if (strcmp(argv[i], "-B") == 0) disableBranches = true;
+    else if (strcmp(argv[i], "-P") == 0) prefetch = true;
+    else if (strcmp(argv[i], "-Z") == 0) parallelUnzip = true;
+    else if (strcmp(argv[i], "-R") == 0) readStats = true;
+    else if (strcmp(argv[i], "-b") == 0) batchSize = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-U") == 0) useSummary = true;
+    else if (strcmp(argv[i], "-K") == 0) skimFile = argv[++i];
+    else if (strcmp(argv[i], "-T") == 0) skimStage = argv[++i];
+    else if (strcmp(argv[i], "-W") == 0) skimBranches = argv[++i];
+    else if (strcmp(argv[i], "-M") == 0) columnCache = argv[++i];
     else if (strcmp(argv[i], "-i") == 0) input = argv[++i];
     else if (strcmp(argv[i], "-s") == 0) sample = argv[++i];
+    else if (strcmp(argv[i], "-F") == 0) srOnly = true;
     else {
         help();
         return 0;
@@ -67,11 +148,23 @@ int main(int argc, char** argv)
       return 1;
   }
 
+  vector<SusyNtSys> sysList;
+  if(!SusyNtAna::parseSystematics(sysNames, sysList)){
+      cout<<"Bad systematics list "<<sysNames<<endl;
+      return 1;
+  }
+
   cout << "flags:" << endl;
   cout << "  sample  " << sample   << endl;
   cout << "  nEvt    " << nEvt     << endl;
   cout << "  nSkip   " << nSkip    << endl;
   cout << "  dbg     " << dbg      << endl;
+  cout << "  workers " << nWorkers << endl;
+  cout << "  sys     " << sysNames << endl;
+  cout << "  output  " << outFile  << endl;
+  cout << "  profile " << cacheProfile << endl;
+  cout << "  cache   " << columnCache << endl;
+  cout << "  SR only " << srOnly   << endl;
   cout << "  input   " << input    << endl;
   cout << endl;
 
@@ -85,17 +178,43 @@ int main(int argc, char** argv)
   Susy2LepCutflow* susyAna = new Susy2LepCutflow();
   susyAna->setDebug(dbg);
   susyAna->setSampleName(sample);
+  susyAna->setSystematics(sysList);
+  susyAna->setCacheProfile(cacheProfile);
+  susyAna->setDisableUnusedBranches(disableBranches);
+  susyAna->setPrefetch(prefetch);
+  susyAna->setParallelUnzip(parallelUnzip);
+  susyAna->setReadPerfStats(readStats);
+  susyAna->setBatchSize(batchSize);
+  susyAna->setUseSummary(useSummary);
+  if(!skimFile.empty()) susyAna->setSkim(skimFile, skimStage, skimBranches);
+  if(!columnCache.empty()) susyAna->setColumnCache(columnCache);
+  // Drop the input files and clusters with no entry passing the summary preselection
+  TEntryList* entryList = 0;
+  if(useSummary){
+    TChain* pruned = susyAna->pruneChain(chain);
+    delete chain;
+    chain = pruned;
+    entryList = chain->GetEntryList();
+    nEntries = entryList->GetN();
+  }
+  susyAna->setRegionDecisionsOnly(srOnly);
 
   // Run the job
   if(nEvt<0) nEvt = nEntries;
   cout << endl;
   cout << "Total entries:   " << nEntries << endl;
   cout << "Process entries: " << nEvt << endl;
-  if(nEvt>0) chain->Process(susyAna, sample.c_str(), nEvt, nSkip);
+  if(nEvt>0){
+    ParallelDriver driver(nWorkers);
+    driver.setVerbose(dbg>0);
+    driver.process(chain, susyAna, sample.c_str(), nEvt, nSkip);
+    if(!outFile.empty()) susyAna->writeCounters(outFile);
+  }
 
   cout << endl;
   cout << "SusySelection job done" << endl;
 
   delete chain;
+  delete entryList;
   return 0;
 }
@@ -0,0 +1,80 @@
+
+#include <cstdlib>
+#include <string>
+
+#include "TChain.h"
+#include "Cintex/Cintex.h"
+
+#include "SusyNtuple/SusyNtColumnCache.h"
+#include "SusyNtuple/ChainHelper.h"
+
+using namespace std;
+using namespace Susy;
+
+/*
+
+    SusyNtColumnCacheMaker - write the memory-mapped column cache of a SusyNt chain
+
+*/
+
+void help()
+{
+  cout << "  Options:"                          << endl;
+  cout << "  -i input (file, list, or dir)"     << endl;
+  cout << "     defaults: ''"                   << endl;
+
+  cout << "  -o output cache file"              << endl;
+  cout << "     defaults: ''"                   << endl;
+
+  cout << "  -b entries per block"              << endl;
+  cout << "     defaults: " << SusyNtColumnCache::DefaultBlockSize << endl;
+
+  cout << "  -d debug printout level"           << endl;
+  cout << "     defaults: 0 (quiet) "           << endl;
+
+  cout << "  -h print this help"                << endl;
+}
+
+int main(int argc, char** argv)
+{
+  ROOT::Cintex::Cintex::Enable();
+
+  int dbg = 0;
+  Long64_t blockSize = SusyNtColumnCache::DefaultBlockSize;
+  string input;
+  string output;
+
+  cout << "SusyNtColumnCacheMaker" << endl;
+  cout << endl;
+
+  /** Read inputs to program */
+  for(int i = 1; i < argc; i++) {
+    if      (strcmp(argv[i], "-i") == 0) input = argv[++i];
+    else if (strcmp(argv[i], "-o") == 0) output = argv[++i];
+    else if (strcmp(argv[i], "-b") == 0) blockSize = atoll(argv[++i]);
+    else if (strcmp(argv[i], "-d") == 0) dbg = atoi(argv[++i]);
+    else {
+        help();
+        return 0;
+    }
+  }
+
+  if(input.empty() || output.empty()){
+      cout<<"You must specify an input and an output"<<endl;
+      return 1;
+  }
+
+  // The files are named in the cache as they are added to the chain,
+  // the analysis must use the same names
+  TChain* chain = new TChain("susyNt");
+  ChainHelper::addInput(chain, input, dbg>0);
+  if(dbg) chain->ls();
+
+  bool ok = SusyNtColumnCache::makeCacheFile(chain, output, blockSize);
+
+  cout << endl;
+  cout << "SusyNtColumnCacheMaker job " << (ok? "done" : "failed") << endl;
+
+  delete chain;
+  return ok? 0 : 1;
+}
@@ -0,0 +1,87 @@
+
+#include <cstdlib>
+#include <string>
+
+#include "TChain.h"
+#include "TChainElement.h"
+#include "TSystem.h"
+#include "Cintex/Cintex.h"
+
+#include "SusyNtuple/SusyNtSummary.h"
+#include "SusyNtuple/ChainHelper.h"
+
+using namespace std;
+using namespace Susy;
+
+/*
+
+    SusyNtSummaryMaker - write the event summary friend file of each SusyNt file
+
+*/
+
+void help()
+{
+  cout << "  Options:"                          << endl;
+  cout << "  -i input (file, list, or dir)"     << endl;
+  cout << "     defaults: ''"                   << endl;
+
+  cout << "  -f overwrite existing summaries"   << endl;
+
+  cout << "  -d debug printout level"           << endl;
+  cout << "     defaults: 0 (quiet) "           << endl;
+
+  cout << "  -h print this help"                << endl;
+}
+
+int main(int argc, char** argv)
+{
+  ROOT::Cintex::Cintex::Enable();
+
+  int dbg = 0;
+  bool force = false;
+  string input;
+
+  cout << "SusyNtSummaryMaker" << endl;
+  cout << endl;
+
+  /** Read inputs to program */
+  for(int i = 1; i < argc; i++) {
+    if      (strcmp(argv[i], "-i") == 0) input = argv[++i];
+    else if (strcmp(argv[i], "-f") == 0) force = true;
+    else if (strcmp(argv[i], "-d") == 0) dbg = atoi(argv[++i]);
+    else {
+        help();
+        return 0;
+    }
+  }
+
+  if(input.empty()){
+      cout<<"You must specify an input"<<endl;
+      return 1;
+  }
+
+  // The chain is only used to expand the input into files
+  TChain* chain = new TChain("susyNt");
+  ChainHelper::addInput(chain, input, dbg>0);
+
+  int nFail = 0;
+  TIter next(chain->GetListOfFiles());
+  while(TChainElement* element = (TChainElement*) next()){
+    string fileName = element->GetTitle();
+    string summaryName = SusyNtSummary::fileName(fileName);
+    // AccessPathName is true when the file does not exist
+    if(!force && !gSystem->AccessPathName(summaryName.c_str())){
+      cout << "Keeping existing " << summaryName << endl;
+      continue;
+    }
+    if(!SusyNtSummary::makeSummaryFile(fileName, summaryName)) nFail++;
+  }
+
+  cout << endl;
+  cout << "SusyNtSummaryMaker job done";
+  if(nFail) cout << ", " << nFail << " files failed";
+  cout << endl;
+
+  delete chain;
+  return nFail? 1 : 0;
+}
@@ -0,0 +1,190 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TChain.h"
+#include "TTree.h"
+#include "Cintex/Cintex.h"
+
+#include "SusyNtuple/SusyNtObject.h"
+#include "SusyNtuple/SusyNtColumnCache.h"
+#include "SusyNtuple/ChainHelper.h"
+
+using namespace std;
+using namespace Susy;
+
+/**
+   Compare the entries served by a SusyNtColumnCache with the tree
+
+   The cache of the input chain is written in small blocks, then every
+   entry is read through SusyNtObject::ReadFromCache and SetCacheSource,
+   and every stored member of every object is compared with a second
+   SusyNtObject reading the chain. A copy of the cache with a corrupt
+   object index must be refused by open.
+ */
+
+//----------------------------------------------------------
+// Checks
+//----------------------------------------------------------
+namespace
+{
+  /// Compare the objects of a branch, false if they differ
+  template<class T>
+  bool checkBranch(D3PDReader::VarHandle< vector<T>* >& cached,
+                   D3PDReader::VarHandle< vector<T>* >& tree, Long64_t entry, bool verbose)
+  {
+    if(!tree.IsAvailable() || SusyNtColumnCache::sameObjects(*cached(), *tree())) return true;
+    if(verbose) cout << "entry " << entry << " branch " << tree.GetName() << " differs" << endl;
+    return false;
+  }
+
+  /// Copy a cache and break the event index of its first block
+  bool corruptCopy(const string& cacheFile, const string& copyFile, Long64_t nBlocks)
+  {
+    FILE* in = fopen(cacheFile.c_str(), "rb");
+    if(in == 0) return false;
+    vector<char> bytes;
+    char buffer[65536];
+    size_t n;
+    while((n = fread(buffer, 1, sizeof(buffer), in)) > 0) bytes.insert(bytes.end(), buffer, buffer + n);
+    fclose(in);
+
+    // The block table ends the file: first entry, entries, offset of each block.
+    // The event index comes first in the block, make it decrease.
+    Long64_t tableSize = 3*nBlocks*sizeof(Long64_t);
+    if((Long64_t) bytes.size() < tableSize) return false;
+    Long64_t blockPos = 0;
+    memcpy(&blockPos, &bytes[bytes.size() - tableSize + 2*sizeof(Long64_t)], sizeof(Long64_t));
+    Long64_t bad = Long64_t(1) << 40;
+    if(blockPos + 2*(Long64_t) sizeof(Long64_t) > (Long64_t) bytes.size()) return false;
+    memcpy(&bytes[blockPos + sizeof(Long64_t)], &bad, sizeof(Long64_t));
+
+    FILE* out = fopen(copyFile.c_str(), "wb");
+    if(out == 0) return false;
+    bool ok = fwrite(&bytes[0], 1, bytes.size(), out) == bytes.size();
+    return fclose(out) == 0 && ok;
+  }
+}
+
+//----------------------------------------------------------
+bool test_ColumnCache(const string& input, const string& cacheFile, Long64_t blockSize, bool verbose)
+{
+  TChain* chain = new TChain("susyNt");
+  ChainHelper::addInput(chain, input);
+  Long64_t nEntries = chain->GetEntries();
+  if(!SusyNtColumnCache::makeCacheFile(chain, cacheFile, blockSize)){
+    cout << "test_ColumnCache: failed to write " << cacheFile << endl;
+    delete chain;
+    return false;
+  }
+
+  SusyNtColumnCache cache;
+  if(!cache.open(cacheFile) || cache.nEntries() != nEntries){
+    cout << "test_ColumnCache: failed to open " << cacheFile << endl;
+    delete chain;
+    return false;
+  }
+
+  // Entries served by the cache
+  Long64_t entry = 0;
+  SusyNtObject nt(entry);
+  nt.ReadFrom(chain);
+  nt.ReadFromCache(&cache);
+
+  // Entries read from the tree
+  TChain* refChain = new TChain("susyNt");
+  ChainHelper::addInput(refChain, input);
+  Long64_t refEntry = 0;
+  SusyNtObject ref(refEntry);
+  ref.ReadFrom(refChain);
+
+  uint nFail = 0;
+  int treeNumber = -1;
+  for(Long64_t i=0; i<nEntries; i++){
+    entry = chain->LoadTree(i);
+    refEntry = refChain->LoadTree(i);
+    // New file, served from the cache as SusyNtAna::Notify does
+    if(chain->GetTreeNumber() != treeNumber){
+      treeNumber = chain->GetTreeNumber();
+      string fileName = chain->GetListOfFiles()->At(treeNumber)->GetTitle();
+      if(!nt.SetCacheSource(fileName, chain->GetTree()->GetEntries())){
+        cout << "test_ColumnCache: " << fileName << " not found in the cache" << endl;
+        nFail++;
+      }
+    }
+    bool same = SusyNtColumnCache::sameObjects(Event::Class(), nt.evt(), ref.evt());
+    if(!same && verbose) cout << "entry " << i << " event differs" << endl;
+    same = checkBranch(nt.ele, ref.ele, i, verbose) && same;
+    same = checkBranch(nt.muo, ref.muo, i, verbose) && same;
+    same = checkBranch(nt.jet, ref.jet, i, verbose) && same;
+    same = checkBranch(nt.pho, ref.pho, i, verbose) && same;
+    same = checkBranch(nt.tau, ref.tau, i, verbose) && same;
+    same = checkBranch(nt.met, ref.met, i, verbose) && same;
+    same = checkBranch(nt.tpr, ref.tpr, i, verbose) && same;
+    same = checkBranch(nt.tjt, ref.tjt, i, verbose) && same;
+    same = checkBranch(nt.tmt, ref.tmt, i, verbose) && same;
+    if(!same) nFail++;
+  }
+  nt.ReadFromCache(0);
+  cache.close();
+
+  // A corrupt index is refused
+  string corruptFile = cacheFile + ".corrupt";
+  Long64_t nBlocks = (nEntries + blockSize - 1) / blockSize;
+  SusyNtColumnCache corrupt;
+  if(!corruptCopy(cacheFile, corruptFile, nBlocks) || corrupt.open(corruptFile)){
+    cout << "test_ColumnCache: the corrupt cache " << corruptFile << " was not refused" << endl;
+    nFail++;
+  }
+  corrupt.close();
+  remove(corruptFile.c_str());
+
+  delete refChain;
+  delete chain;
+  cout << "test_ColumnCache: " << (nFail? "failed" : "passed") << " (" << nFail
+       << " failures in " << nEntries << " entries)" << endl;
+  return nFail == 0;
+}
+//----------------------------------------------------------
+void help()
+{
+  cout << "  Options:"                          << endl;
+  cout << "  -i input (file, list, or dir), better small" << endl;
+  cout << "  -o cache file"                     << endl;
+  cout << "     defaults: /tmp/test_ColumnCache.sntc" << endl;
+  cout << "  -b entries per block"              << endl;
+  cout << "     defaults: 100"                  << endl;
+  cout << "  -v print the differences"          << endl;
+  cout << "  -h print this help"                << endl;
+}
+//----------------------------------------------------------
+int main(int argc, char **argv)
+{
+  ROOT::Cintex::Cintex::Enable();
+
+  Long64_t blockSize = 100;
+  bool verbose = false;
+  string input;
+  string cacheFile = "/tmp/test_ColumnCache.sntc";
+
+  for(int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-i") == 0) input = argv[++i];
+    else if (strcmp(argv[i], "-o") == 0) cacheFile = argv[++i];
+    else if (strcmp(argv[i], "-b") == 0) blockSize = atoll(argv[++i]);
+    else if (strcmp(argv[i], "-v") == 0) verbose = true;
+    else {
+      help();
+      return 0;
+    }
+  }
+  if(input.empty() || blockSize <= 0){
+    cout<<"You must specify an input and a positive block size"<<endl;
+    return 1;
+  }
+
+  return test_ColumnCache(input, cacheFile, blockSize, verbose)? 0 : 1;
+}
+//----------------------------------------------------------
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TRandom3.h"
+
+#include "SusyNtuple/CutflowEngine.h"
+
+using namespace std;
+using namespace Susy;
+
+/**
+   Check the CutflowEngine against a flat evaluation of its regions
+
+   The cuts and regions are those of Susy2LepCutflow, with random results:
+   each cut passes with its own probability, independently in each event.
+   For every event, each region is also evaluated flat, cut after cut in
+   analysis order, and the engine must
+
+   - evaluate each cut at most once per event, although OS, JV and ZV
+     start or appear in several regions,
+   - count every step of every region, the OS, SS and SF steps included,
+     like the flat evaluation, per channel and systematic,
+   - in decision-only mode, keep OS, SS and SF at their place in each
+     region while reordering the other cuts, and pass the same events.
+ */
+
+//----------------------------------------------------------
+// Random cuts
+//----------------------------------------------------------
+namespace
+{
+  /// Result of the cut for the current event, counting the evaluations
+  class RandomCut : public CutflowCut
+  {
+    public:
+      RandomCut(const vector<char>& results, uint index, vector<uint>& nCalls) :
+        m_results(results), m_index(index), m_nCalls(nCalls) {}
+      virtual bool pass() { m_nCalls[m_index]++; return m_results[m_index]; }
+    protected:
+      const vector<char>& m_results;
+      uint m_index;
+      vector<uint>& m_nCalls;
+  };
+
+  const char* cutNames[] = { "OS", "SS", "SF", "JV", ">=2j", "bV", "ZV", "mct",
+                             "MET", "MET50", "MET40", "l0Pt", "SumPt", "dPhiMetLL",
+                             "dPhiMetL1", "Mt2" };
+  const uint nCutNames = sizeof(cutNames)/sizeof(cutNames[0]);
+  const char* barriers[] = { "OS", "SS", "SF" };
+  const uint nBarriers = 3;
+
+  const char* regionNames[] = { "SR1", "SR2", "SR3", "SR4", "SR5" };
+  const char* regionCuts[] = { "OS,JV,ZV,MET",
+                               "SS,JV,MET",
+                               "OS,SF,>=2j,ZV,bV,mct,MET50",
+                               "OS,JV,MET40,ZV,l0Pt,SumPt,dPhiMetLL,dPhiMetL1",
+                               "OS,JV,ZV,MET40,Mt2" };
+  const uint nRegionNames = 5;
+
+  const uint nChannels = 3;
+  const uint nSys = 2;
+
+  /// Cut indices of a comma separated list
+  vector<uint> parseCuts(const string& cuts)
+  {
+    vector<uint> list;
+    string::size_type start = 0;
+    while(start <= cuts.size()){
+      string::size_type end = cuts.find(',', start);
+      if(end == string::npos) end = cuts.size();
+      string name = cuts.substr(start, end - start);
+      for(uint i=0; i<nCutNames; i++) if(name == cutNames[i]) list.push_back(i);
+      start = end + 1;
+    }
+    return list;
+  }
+
+  bool isBarrier(const string& name)
+  {
+    for(uint i=0; i<nBarriers; i++) if(name == barriers[i]) return true;
+    return false;
+  }
+
+  /// Engine with the cuts and regions above
+  void setup(CutflowEngine& engine, const vector<char>& results, vector<uint>& nCalls)
+  {
+    for(uint i=0; i<nCutNames; i++) engine.addCut(cutNames[i], new RandomCut(results, i, nCalls));
+    for(uint i=0; i<nBarriers; i++) engine.setBarrier(barriers[i]);
+    for(uint r=0; r<nRegionNames; r++) engine.addRegion(regionNames[r], regionCuts[r]);
+    engine.book();
+  }
+}
+
+//----------------------------------------------------------
+bool test_counts(uint nEvents, bool verbose)
+{
+  TRandom3 rnd(12);
+  vector<char> results(nCutNames, 0);
+  vector<uint> nCalls(nCutNames, 0);
+  CutflowEngine engine(nChannels);
+  setup(engine, results, nCalls);
+
+  vector< vector<uint> > regions;
+  for(uint r=0; r<nRegionNames; r++) regions.push_back(parseCuts(regionCuts[r]));
+
+  // Flat counts [sys][region][step][channel]
+  vector<uint> flat(nSys*nRegionNames*nCutNames*nChannels, 0);
+  vector<double> passProb(nCutNames);
+  for(uint i=0; i<nCutNames; i++) passProb[i] = 0.3 + 0.6*rnd.Rndm();
+
+  uint nFail = 0;
+  for(uint iEvt=0; iEvt<nEvents; iEvt++){
+    for(uint i=0; i<nCutNames; i++) results[i] = rnd.Rndm() < passProb[i];
+    uint ch = rnd.Integer(nChannels);
+    uint sys = rnd.Integer(nSys);
+
+    nCalls.assign(nCutNames, 0);
+    engine.process(ch, sys);
+    for(uint i=0; i<nCutNames; i++){
+      if(nCalls[i] > 1){
+        nFail++;
+        if(verbose) cout << "event " << iEvt << " cut " << cutNames[i] << " evaluated "
+                         << nCalls[i] << " times" << endl;
+      }
+    }
+
+    for(uint r=0; r<nRegionNames; r++){
+      bool pass = true;
+      for(uint s=0; s<regions[r].size() && pass; s++){
+        pass = results[regions[r][s]];
+        if(pass) flat[((sys*nRegionNames + r)*nCutNames + s)*nChannels + ch]++;
+      }
+      if(engine.passed(r) != pass){
+        nFail++;
+        if(verbose) cout << "event " << iEvt << " region " << regionNames[r] << " decision differs" << endl;
+      }
+    }
+  }
+
+  for(uint sys=0; sys<nSys; sys++){
+    for(uint r=0; r<nRegionNames; r++){
+      for(uint s=0; s<engine.nSteps(r); s++){
+        for(uint ch=0; ch<nChannels; ch++){
+          uint expected = flat[((sys*nRegionNames + r)*nCutNames + s)*nChannels + ch];
+          uint counted = engine.count(r, s, ch, sys);
+          if(counted != expected){
+            nFail++;
+            if(verbose) cout << "region " << regionNames[r] << " step " << s << " ("
+                             << cutNames[regions[r][s]] << ") channel " << ch << " sys " << sys
+                             << ": " << counted << " instead of " << expected << endl;
+          }
+        }
+      }
+    }
+  }
+
+  // The shared prefixes are single nodes
+  if(engine.nNodes() != 21){
+    nFail++;
+    if(verbose) cout << "tree has " << engine.nNodes() << " nodes instead of 21" << endl;
+  }
+
+  cout << "test_CutflowEngine counts: " << (nFail? "failed" : "passed")
+       << " (" << nFail << " failures in " << nEvents << " events)" << endl;
+  return nFail == 0;
+}
+//----------------------------------------------------------
+bool test_decisions(uint nEvents, bool verbose)
+{
+  TRandom3 rnd(13);
+  vector<char> results(nCutNames, 0);
+  vector<uint> nCalls(nCutNames, 0);
+  CutflowEngine engine(nChannels);
+  setup(engine, results, nCalls);
+  engine.setDecisionOnly(true, 100);
+
+  vector< vector<uint> > regions;
+  for(uint r=0; r<nRegionNames; r++) regions.push_back(parseCuts(regionCuts[r]));
+
+  // Very different pass rates, so that the reordering moves cuts
+  vector<double> passProb(nCutNames);
+  for(uint i=0; i<nCutNames; i++) passProb[i] = isBarrier(cutNames[i])? 0.9 : 0.05 + 0.9*rnd.Rndm();
+
+  uint nFail = 0;
+  vector<uint> flatFinal(nRegionNames, 0);
+  for(uint iEvt=0; iEvt<nEvents; iEvt++){
+    for(uint i=0; i<nCutNames; i++) results[i] = rnd.Rndm() < passProb[i];
+
+    nCalls.assign(nCutNames, 0);
+    engine.process(0, 0);
+    for(uint i=0; i<nCutNames; i++) if(nCalls[i] > 1) nFail++;
+
+    for(uint r=0; r<nRegionNames; r++){
+      bool pass = true;
+      for(uint s=0; s<regions[r].size() && pass; s++) pass = results[regions[r][s]];
+      if(pass) flatFinal[r]++;
+      if(engine.passed(r) != pass){
+        nFail++;
+        if(verbose) cout << "event " << iEvt << " region " << regionNames[r] << " decision differs" << endl;
+      }
+    }
+  }
+
+  // Final counts, and barriers in place with the same cuts on each side
+  uint nMoved = 0;
+  for(uint r=0; r<nRegionNames; r++){
+    if(engine.count(r, engine.nSteps(r)-1, 0, 0) != flatFinal[r]) nFail++;
+    const vector<uint>& order = engine.evalOrder(r);
+    const vector<uint>& cuts = regions[r];
+    if(order.size() != cuts.size()){
+      nFail++;
+      continue;
+    }
+    uint begin = 0;
+    for(uint s=0; s<=cuts.size(); s++){
+      if(s < cuts.size() && !isBarrier(cutNames[cuts[s]])) continue;
+      if(s < cuts.size() && order[s] != cuts[s]){
+        nFail++;
+        if(verbose) cout << "region " << regionNames[r] << " barrier " << cutNames[cuts[s]]
+                         << " moved" << endl;
+      }
+      // Same cuts between the barriers
+      vector<uint> a(cuts.begin()+begin, cuts.begin()+s);
+      vector<uint> b(order.begin()+begin, order.begin()+s);
+      if(a != b) nMoved++;
+      sort(a.begin(), a.end());
+      sort(b.begin(), b.end());
+      if(a != b){
+        nFail++;
+        if(verbose) cout << "region " << regionNames[r] << " cut moved across a barrier" << endl;
+      }
+      begin = s + 1;
+    }
+  }
+  if(nMoved == 0){
+    nFail++;
+    if(verbose) cout << "no cut was reordered" << endl;
+  }
+
+  cout << "test_CutflowEngine decisions: " << (nFail? "failed" : "passed")
+       << " (" << nFail << " failures in " << nEvents << " events)" << endl;
+  return nFail == 0;
+}
+//----------------------------------------------------------
+int main(int argc, char **argv)
+{
+  uint nEvents = 10000;
+  bool verbose = false;
+  for(int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0) nEvents = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-v") == 0) verbose = true;
+    else {
+      cout << "  -n number of random events, defaults: 10000" << endl;
+      cout << "  -v print the differences"                     << endl;
+      return 0;
+    }
+  }
+
+  bool ok = test_counts(nEvents, verbose);
+  ok = test_decisions(nEvents, verbose) && ok;
+  return ok? 0 : 1;
+}
+//----------------------------------------------------------
@@ -0,0 +1,157 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "TChain.h"
+#include "Cintex/Cintex.h"
+
+#include "SusyNtuple/SusyNtAna.h"
+#include "SusyNtuple/ChainHelper.h"
+
+using namespace std;
+
+/**
+   Count the heap allocations made by the object selection
+
+   Replaces the global operator new of this executable with a counting
+   one, and reports the allocations done by SusyNtAna::selectObjects for
+   the requested systematics, per entry, after a few warm-up entries.
+   The default systematics shift electrons and jets, so the selection
+   from the nominal one runs too.
+   Reading the entry from the tree is not counted: every branch is read
+   before the selection runs. The selection should
+   only allocate when an entry has more objects than any before it.
+ */
+
+//----------------------------------------------------------
+// Counting allocator
+//----------------------------------------------------------
+static unsigned long g_nAlloc = 0;
+void* operator new(size_t size) throw(std::bad_alloc)
+{
+  ++g_nAlloc;
+  void* p = malloc(size? size : 1);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t size) throw(std::bad_alloc) { return operator new(size); }
+void operator delete(void* p) throw() { free(p); }
+void operator delete[](void* p) throw() { free(p); }
+
+//----------------------------------------------------------
+// Selector counting the allocations of selectObjects
+//----------------------------------------------------------
+class AllocCounter : public SusyNtAna
+{
+  public:
+    AllocCounter(Long64_t nWarmUp) : m_nWarmUp(nWarmUp), m_nCounted(0), m_nAllocSel(0), m_nEvtAlloc(0) {}
+
+    virtual Bool_t Process(Long64_t entry)
+    {
+      GetEntry(entry);
+      m_chainEntry++;
+
+      // The branches are read lazily, read them all before counting
+      nt.evt(); nt.ele(); nt.muo(); nt.jet(); nt.pho(); nt.tau(); nt.met();
+      if(nt.tpr.IsAvailable()) nt.tpr();
+      if(nt.tjt.IsAvailable()) nt.tjt();
+      if(nt.tmt.IsAvailable()) nt.tmt();
+
+      unsigned long nBefore = g_nAlloc;
+      for(uint iSys=0; iSys<m_sysList.size(); iSys++) selectObjects(m_sysList[iSys]);
+      unsigned long nAlloc = g_nAlloc - nBefore;
+
+      if(m_chainEntry >= m_nWarmUp){
+        m_nCounted++;
+        m_nAllocSel += nAlloc;
+        if(nAlloc) m_nEvtAlloc++;
+        if(nAlloc && m_dbg)
+          cout << "entry " << m_chainEntry << " allocations " << nAlloc << endl;
+      }
+      return kTRUE;
+    }
+
+    virtual void Terminate()
+    {
+      SusyNtAna::Terminate();
+      cout << endl;
+      cout << "Entries after warm-up:          " << m_nCounted << endl;
+      cout << "Entries with allocations:       " << m_nEvtAlloc << endl;
+      cout << "Allocations in selectObjects:   " << m_nAllocSel << endl;
+      if(m_nCounted)
+        cout << "Allocations per entry:          " << double(m_nAllocSel)/m_nCounted << endl;
+    }
+
+  protected:
+    Long64_t m_nWarmUp;
+    Long64_t m_nCounted;
+    unsigned long m_nAllocSel;
+    unsigned long m_nEvtAlloc;
+};
+
+//----------------------------------------------------------
+void help()
+{
+  cout << "  Options:"                          << endl;
+  cout << "  -i input (file, list, or dir)"     << endl;
+  cout << "  -n number of events to process"    << endl;
+  cout << "     defaults: -1 (all events)"      << endl;
+  cout << "  -w number of warm-up events"       << endl;
+  cout << "     defaults: 100"                  << endl;
+  cout << "  -y systematics, comma separated"   << endl;
+  cout << "     defaults: NOM,EES_Z_UP,JES_UP"  << endl;
+  cout << "  -d debug printout level"           << endl;
+  cout << "  -h print this help"                << endl;
+}
+//----------------------------------------------------------
+int main(int argc, char **argv)
+{
+  ROOT::Cintex::Cintex::Enable();
+
+  int nEvt = -1;
+  int nWarmUp = 100;
+  int dbg = 0;
+  string sysNames = "NOM,EES_Z_UP,JES_UP";
+  string input;
+
+  for(int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0) nEvt = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-w") == 0) nWarmUp = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-d") == 0) dbg = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-y") == 0) sysNames = argv[++i];
+    else if (strcmp(argv[i], "-i") == 0) input = argv[++i];
+    else {
+      help();
+      return 0;
+    }
+  }
+  if(input.empty()){
+    cout<<"You must specify an input"<<endl;
+    return 1;
+  }
+  vector<SusyNtSys> sysList;
+  if(!SusyNtAna::parseSystematics(sysNames, sysList)){
+    cout<<"Bad systematics list "<<sysNames<<endl;
+    return 1;
+  }
+
+  TChain* chain = new TChain("susyNt");
+  ChainHelper::addInput(chain, input, dbg>0);
+  Long64_t nEntries = chain->GetEntries();
+  if(nEvt<0) nEvt = nEntries;
+
+  AllocCounter* ana = new AllocCounter(nWarmUp);
+  ana->setDebug(dbg);
+  ana->setSystematics(sysList);
+  chain->Process(ana, "", nEvt, 0);
+
+  // Vectors still grow on the first entry with more objects than seen before,
+  // so a few allocations after the warm-up are expected
+  delete ana;
+  delete chain;
+  return 0;
+}
+//----------------------------------------------------------
@@ -0,0 +1,178 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "Cintex/Cintex.h"
+
+#include "SusyNtuple/SusyNtAna.h"
+#include "SusyNtuple/SusyNtColumnCache.h"
+#include "SusyNtuple/ChainHelper.h"
+
+using namespace std;
+using namespace Susy;
+
+/**
+   Compare the objects read in batches with the objects read one entry at a time
+
+   The selector reads the chain in batches of n entries, like SusyNtAna
+   with -b n. For each entry, a second SusyNtObject reads the same entry
+   from its own copy of the current file, without batches, and every data
+   member of every object of every branch must be the same. The members
+   are those stored in the SusyNt, the TObject bits excepted.
+
+   The chain needs at least two files, and the batch size is chosen so
+   that a batch runs into the end of the first file: the first entries of
+   the next file are read after Notify dropped the batch. With one input
+   file, the file is added twice.
+ */
+
+//----------------------------------------------------------
+// Selector reading in batches, with an unbatched reference
+//----------------------------------------------------------
+class BatchChecker : public SusyNtAna
+{
+  public:
+    BatchChecker() : m_refEntry(0), m_ref(m_refEntry), m_refFile(0), m_ok(true), m_nFiles(0),
+                     m_nCompared(0), m_nFail(0) {}
+    virtual ~BatchChecker() { delete m_refFile; }
+
+    virtual Bool_t Notify()
+    {
+      SusyNtAna::Notify();
+      // Reference reader on its own copy of the new file
+      TFile* refFile = TFile::Open(m_tree->GetCurrentFile()->GetName());
+      TTree* refTree = refFile? (TTree*) refFile->Get("susyNt") : 0;
+      if(refTree == 0){
+        cout << "test_batchReading ERROR cannot read " << m_tree->GetCurrentFile()->GetName() << endl;
+        m_ok = false;
+      }
+      else m_ref.ReadFrom(refTree);
+      delete m_refFile;
+      m_refFile = refFile;
+      m_nFiles++;
+      return kTRUE;
+    }
+
+    virtual Bool_t Process(Long64_t entry)
+    {
+      GetEntry(entry);
+      m_chainEntry++;
+      m_refEntry = entry;
+      if(!m_ok) return kTRUE;
+
+      bool same = SusyNtColumnCache::sameObjects(Event::Class(), nt.evt(), m_ref.evt());
+      if(!same && m_dbg) cout << "entry " << m_chainEntry << " event differs" << endl;
+      same = checkBranch(nt.ele, m_ref.ele) && same;
+      same = checkBranch(nt.muo, m_ref.muo) && same;
+      same = checkBranch(nt.jet, m_ref.jet) && same;
+      same = checkBranch(nt.pho, m_ref.pho) && same;
+      same = checkBranch(nt.tau, m_ref.tau) && same;
+      same = checkBranch(nt.met, m_ref.met) && same;
+      same = checkBranch(nt.tpr, m_ref.tpr) && same;
+      same = checkBranch(nt.tjt, m_ref.tjt) && same;
+      same = checkBranch(nt.tmt, m_ref.tmt) && same;
+      m_nCompared++;
+      if(!same) m_nFail++;
+      return kTRUE;
+    }
+
+    virtual void Terminate()
+    {
+      SusyNtAna::Terminate();
+      cout << "test_batchReading: " << (passed()? "passed" : "failed") << " ("
+           << m_nFail << " different entries out of " << m_nCompared << ", "
+           << m_nFiles << " files)" << endl;
+    }
+
+    bool passed() const { return m_ok && m_nFail == 0 && m_nFiles > 1; }
+
+  protected:
+
+    /// Compare the objects of a branch, false if they differ
+    template<class T>
+    bool checkBranch(D3PDReader::VarHandle< vector<T>* >& batched,
+                     D3PDReader::VarHandle< vector<T>* >& single)
+    {
+      if(!batched.IsAvailable() || SusyNtColumnCache::sameObjects(*batched(), *single())) return true;
+      if(m_dbg) cout << "entry " << m_chainEntry << " branch " << batched.GetName() << " differs" << endl;
+      return false;
+    }
+
+    Long64_t m_refEntry;
+    SusyNtObject m_ref;         ///< reads the current file one entry at a time
+    TFile* m_refFile;
+    bool m_ok;
+    int m_nFiles;
+    Long64_t m_nCompared;
+    Long64_t m_nFail;
+};
+
+//----------------------------------------------------------
+void help()
+{
+  cout << "  Options:"                          << endl;
+  cout << "  -i input (file, list, or dir)"     << endl;
+  cout << "  -n number of events to process"    << endl;
+  cout << "     defaults: -1 (all events), must reach the second file" << endl;
+  cout << "  -b entries per batch"              << endl;
+  cout << "     defaults: 100, changed so that a batch reaches the end of the first file" << endl;
+  cout << "  -d debug printout level"           << endl;
+  cout << "  -h print this help"                << endl;
+}
+//----------------------------------------------------------
+int main(int argc, char **argv)
+{
+  ROOT::Cintex::Cintex::Enable();
+
+  int nEvt = -1;
+  int batchSize = 100;
+  int dbg = 0;
+  string input;
+
+  for(int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0) nEvt = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-b") == 0) batchSize = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-d") == 0) dbg = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-i") == 0) input = argv[++i];
+    else {
+      help();
+      return 0;
+    }
+  }
+  if(input.empty() || batchSize <= 0){
+    cout<<"You must specify an input and a positive batch size"<<endl;
+    return 1;
+  }
+
+  TChain* chain = new TChain("susyNt");
+  ChainHelper::addInput(chain, input, dbg>0);
+  // A file boundary to cross
+  if(chain->GetNtrees() < 2) ChainHelper::addInput(chain, input, dbg>0);
+  Long64_t nEntries = chain->GetEntries();
+  if(nEvt<0 || nEvt>nEntries) nEvt = nEntries;
+
+  // The last batch of the first file must stop at its end, not fill up
+  Long64_t nFirst = chain->GetTreeOffset()[1];
+  if(nFirst > 2){
+    if(batchSize >= nFirst) batchSize = nFirst - 1;
+    while(nFirst % batchSize == 0) batchSize++;
+  }
+  cout << "Batches of " << batchSize << " entries, " << nFirst
+       << " entries in the first file" << endl;
+
+  BatchChecker* ana = new BatchChecker();
+  ana->setDebug(dbg);
+  ana->setBatchSize(batchSize);
+  chain->Process(ana, "", nEvt, 0);
+  bool ok = ana->passed();
+
+  delete ana;
+  delete chain;
+  return ok? 0 : 1;
+}
+//----------------------------------------------------------
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TChain.h"
+#include "Cintex/Cintex.h"
+
+#include "SusyNtuple/SusyNtAna.h"
+#include "SusyNtuple/ChainHelper.h"
+
+using namespace std;
+using namespace Susy;
+
+/**
+   Compare the isolation with the nearby leptons removed, with and without
+   the isolation context
+
+   For each entry and systematic, selectObjects runs with removeLepsFromIso,
+   so the signal leptons come from the isolation context built once for the
+   selection. The signal decision of each baseline lepton is then taken
+   again without a context, with the cone corrections looping over the
+   baseline leptons like before the context was added, and must agree. The
+   four cone corrections of both ways are compared too.
+ */
+
+//----------------------------------------------------------
+// Selector comparing the two isolation computations
+//----------------------------------------------------------
+class IsoChecker : public SusyNtAna
+{
+  public:
+    IsoChecker() : m_nLep(0), m_nDecisionFail(0), m_nConeFail(0) {}
+
+    virtual Bool_t Process(Long64_t entry)
+    {
+      GetEntry(entry);
+      m_chainEntry++;
+
+      for(uint iSys=0; iSys<m_sysList.size(); iSys++){
+        selectObjects(m_sysList[iSys], true);
+        checkEntry();
+      }
+      return kTRUE;
+    }
+
+    virtual void Terminate()
+    {
+      SusyNtAna::Terminate();
+      bool ok = m_nDecisionFail == 0 && m_nConeFail == 0;
+      cout << "test_isolationContext: " << (ok? "passed" : "failed")
+           << " (" << m_nLep << " leptons, " << m_nDecisionFail << " different decisions, "
+           << m_nConeFail << " different cone corrections)" << endl;
+    }
+
+    bool passed() const { return m_nDecisionFail == 0 && m_nConeFail == 0; }
+
+  protected:
+
+    void checkEntry()
+    {
+      uint nVtx = nt.evt()->nVtx;
+      bool isMC = nt.evt()->isMC;
+      const ElectronVector& baseEle = m_baseElectrons;
+      const MuonVector& baseMuo = m_baseMuons;
+
+      // Decisions without a context, as before the context existed
+      clearIsolationContext();
+      for(uint i=0; i<baseEle.size(); i++){
+        bool legacy = isSignalElectron(baseEle[i], baseEle, baseMuo, nVtx, isMC, true);
+        bool selected = find(m_signalElectrons.begin(), m_signalElectrons.end(), baseEle[i])
+                        != m_signalElectrons.end();
+        checkDecision("electron", i, legacy, selected);
+      }
+      for(uint i=0; i<baseMuo.size(); i++){
+        bool legacy = isSignalMuon(baseMuo[i], baseEle, baseMuo, nVtx, isMC, true);
+        bool selected = find(m_signalMuons.begin(), m_signalMuons.end(), baseMuo[i])
+                        != m_signalMuons.end();
+        checkDecision("muon", i, legacy, selected);
+      }
+
+      // Cone corrections with and without the context
+      buildIsolationContext(baseEle, baseMuo);
+      for(uint i=0; i<baseEle.size(); i++){
+        const Electron* e = baseEle[i];
+        checkCone("electron ptcone", i, elPtConeCorr(e, baseEle, baseMuo, nVtx, isMC, true),
+                  elPtConeCorr(m_isoCtx, i, nVtx, isMC));
+        checkCone("electron etcone", i, elEtTopoConeCorr(e, baseEle, baseMuo, nVtx, isMC, true),
+                  elEtTopoConeCorr(m_isoCtx, i, nVtx, isMC));
+      }
+      for(uint i=0; i<baseMuo.size(); i++){
+        const Muon* mu = baseMuo[i];
+        uint iLep = m_isoCtx.muoIndex(i);
+        checkCone("muon ptcone", i, muPtConeCorr(mu, baseEle, baseMuo, nVtx, isMC, true),
+                  muPtConeCorr(m_isoCtx, iLep, nVtx, isMC));
+        checkCone("muon etcone", i, muEtConeCorr(mu, baseEle, baseMuo, nVtx, isMC, true),
+                  muEtConeCorr(m_isoCtx, iLep, nVtx, isMC));
+      }
+      clearIsolationContext();
+      m_nLep += baseEle.size() + baseMuo.size();
+    }
+
+    void checkDecision(const char* what, uint i, bool legacy, bool selected)
+    {
+      if(legacy == selected) return;
+      m_nDecisionFail++;
+      if(m_dbg) cout << "entry " << m_chainEntry << " " << what << " " << i << " signal "
+                     << selected << ", without context " << legacy << endl;
+    }
+
+    void checkCone(const char* what, uint i, float legacy, float ctx)
+    {
+      // Same float arithmetic, up to the order of the sums
+      if(fabs(legacy - ctx) <= 1e-5 * (1 + fabs(legacy))) return;
+      m_nConeFail++;
+      if(m_dbg) cout << "entry " << m_chainEntry << " " << what << " " << i << " "
+                     << ctx << ", without context " << legacy << endl;
+    }
+
+    Long64_t m_nLep;
+    Long64_t m_nDecisionFail;
+    Long64_t m_nConeFail;
+};
+
+//----------------------------------------------------------
+void help()
+{
+  cout << "  Options:"                          << endl;
+  cout << "  -i input (file, list, or dir)"     << endl;
+  cout << "  -n number of events to process"    << endl;
+  cout << "     defaults: 1000"                 << endl;
+  cout << "  -y systematics, comma separated"   << endl;
+  cout << "     defaults: NOM"                  << endl;
+  cout << "  -a analysis type: 2L, 3L or WH"    << endl;
+  cout << "     defaults: 3L"                   << endl;
+  cout << "  -d debug printout level"           << endl;
+  cout << "  -h print this help"                << endl;
+}
+//----------------------------------------------------------
+int main(int argc, char **argv)
+{
+  ROOT::Cintex::Cintex::Enable();
+
+  int nEvt = 1000;
+  int dbg = 0;
+  string sysNames = "NOM";
+  string anaName = "3L";
+  string input;
+
+  for(int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0) nEvt = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-d") == 0) dbg = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-y") == 0) sysNames = argv[++i];
+    else if (strcmp(argv[i], "-a") == 0) anaName = argv[++i];
+    else if (strcmp(argv[i], "-i") == 0) input = argv[++i];
+    else {
+      help();
+      return 0;
+    }
+  }
+  if(input.empty()){
+    cout<<"You must specify an input"<<endl;
+    return 1;
+  }
+  vector<SusyNtSys> sysList;
+  if(!SusyNtAna::parseSystematics(sysNames, sysList)){
+    cout<<"Bad systematics list "<<sysNames<<endl;
+    return 1;
+  }
+  AnalysisType anaType = Ana_3Lep;
+  if(anaName == "2L") anaType = Ana_2Lep;
+  else if(anaName == "WH") anaType = Ana_2LepWH;
+  else if(anaName != "3L"){
+    cout<<"Bad analysis type "<<anaName<<endl;
+    return 1;
+  }
+
+  TChain* chain = new TChain("susyNt");
+  ChainHelper::addInput(chain, input, dbg>0);
+  Long64_t nEntries = chain->GetEntries();
+  if(nEvt<0 || nEvt>nEntries) nEvt = nEntries;
+
+  IsoChecker* ana = new IsoChecker();
+  ana->setDebug(dbg);
+  ana->setAnaType(anaType);
+  ana->setSystematics(sysList);
+  chain->Process(ana, "", nEvt, 0);
+  bool ok = ana->passed();
+
+  delete ana;
+  delete chain;
+  return ok? 0 : 1;
+}
+//----------------------------------------------------------
@@ -0,0 +1,128 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "TRandom3.h"
+
+#include "SusyNtuple/SusyNtTools.h"
+
+using namespace std;
+using namespace Susy;
+
+/**
+   Compare SusyNtTools::performOverlap with performOverlapSequential
+
+   Random events are built with the objects on a coarse eta-phi grid and
+   a few pt values, so that many pairs are at the same delta R, at delta
+   R 0, or have the same pt. Both methods get the same input collections
+   and must keep the same objects, in the same order. Some events have
+   collections of 63, 64, 65 and 70 objects, around the size above which
+   performOverlap falls back to the sequential methods.
+ */
+
+//----------------------------------------------------------
+// Random objects
+//----------------------------------------------------------
+namespace
+{
+  // Grid step, the overlap cones are multiples of it
+  const double GridStep = 0.05;
+
+  template<class T>
+  void makeObjects(TRandom3& rnd, uint n, vector<T>& objects, vector<T*>& pointers)
+  {
+    objects.assign(n, T());
+    pointers.clear();
+    for(uint i=0; i<n; i++){
+      // Few distinct positions and pts: ties in delta R and pt
+      double eta = GridStep * (int) rnd.Integer(17) - 0.4;
+      double phi = GridStep * (int) rnd.Integer(17) - 0.4;
+      double pt  = 10. * (1 + rnd.Integer(4));
+      objects[i].SetPtEtaPhiM(pt, eta, phi, 0);
+      pointers.push_back(&objects[i]);
+    }
+  }
+
+  uint randomSize(TRandom3& rnd, bool large)
+  {
+    static const uint largeSizes[] = { 63, 64, 65, 70 };
+    if(large && rnd.Integer(2)) return largeSizes[rnd.Integer(4)];
+    return rnd.Integer(9);
+  }
+
+  template<class T>
+  bool sameObjects(const vector<T*>& a, const vector<T*>& b)
+  {
+    return a == b;
+  }
+}
+
+//----------------------------------------------------------
+bool test_overlap(uint nEvents, bool large, bool verbose)
+{
+  TRandom3 rnd(large? 64 : 1);
+  SusyNtTools tools;
+  uint nFail = 0;
+  uint nRemoved = 0;
+
+  vector<Electron> eleStore;
+  vector<Muon> muoStore;
+  vector<Tau> tauStore;
+  vector<Jet> jetStore;
+  ElectronVector eles;
+  MuonVector muos;
+  TauVector taus;
+  JetVector jets;
+
+  for(uint iEvt=0; iEvt<nEvents; iEvt++){
+    makeObjects(rnd, randomSize(rnd, large), eleStore, eles);
+    makeObjects(rnd, randomSize(rnd, large), muoStore, muos);
+    makeObjects(rnd, randomSize(rnd, large), tauStore, taus);
+    makeObjects(rnd, randomSize(rnd, large), jetStore, jets);
+
+    ElectronVector eles2 = eles;
+    MuonVector muos2 = muos;
+    TauVector taus2 = taus;
+    JetVector jets2 = jets;
+    uint nBefore = eles.size() + muos.size() + taus.size() + jets.size();
+
+    tools.performOverlap(eles, muos, taus, jets);
+    tools.performOverlapSequential(eles2, muos2, taus2, jets2);
+
+    nRemoved += nBefore - (eles.size() + muos.size() + taus.size() + jets.size());
+    if(!sameObjects(eles, eles2) || !sameObjects(muos, muos2) ||
+       !sameObjects(taus, taus2) || !sameObjects(jets, jets2)){
+      nFail++;
+      if(verbose) cout << "event " << iEvt << " differs: ele " << eles.size() << "/" << eles2.size()
+                       << " muo " << muos.size() << "/" << muos2.size()
+                       << " tau " << taus.size() << "/" << taus2.size()
+                       << " jet " << jets.size() << "/" << jets2.size() << endl;
+    }
+  }
+
+  cout << "test_overlap" << (large? " (large collections)" : "") << ": "
+       << (nFail? "failed" : "passed") << " (" << nFail << " failures in " << nEvents
+       << " events, " << nRemoved << " objects removed)" << endl;
+  return nFail == 0;
+}
+//----------------------------------------------------------
+int main(int argc, char **argv)
+{
+  uint nEvents = 10000;
+  bool verbose = false;
+  for(int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0) nEvents = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-v") == 0) verbose = true;
+    else {
+      cout << "  -n number of random events, defaults: 10000" << endl;
+      cout << "  -v print the events that differ"             << endl;
+      return 0;
+    }
+  }
+
+  bool ok = test_overlap(nEvents, false, verbose);
+  ok = test_overlap(nEvents/10, true, verbose) && ok;
+  return ok? 0 : 1;
+}
+//----------------------------------------------------------
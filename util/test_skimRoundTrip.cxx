@@ -0,0 +1,256 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "Cintex/Cintex.h"
+
+#include "SusyNtuple/SusyNtObject.h"
+#include "SusyNtuple/SusyNtSkimWriter.h"
+#include "SusyNtuple/ChainHelper.h"
+
+using namespace std;
+using namespace Susy;
+
+/**
+   Write a skim with SusyNtSkimWriter and read it back through SusyNtObject
+
+   The four-vectors of the input objects are shifted before the entries
+   are written, like a systematic applied by the object selection. Read
+   back from the skim, every object of every particle collection must
+   have Pt(), Eta() and M() equal to its stored pt, eta and m, to float
+   precision, and the same stored kinematics as the input.
+
+   The skim is written twice, with the packed cutFlags of the default
+   and with setPackCutFlags(false). The
+   systematic cutFlags read back must be those of the input, and the
+   systematic scale factors, stored as Float16_t with a 14 bit mantissa,
+   must be within 2^-14 of the input ones.
+ */
+
+//----------------------------------------------------------
+// Checks
+//----------------------------------------------------------
+namespace
+{
+  /// Relative precision of the Float16_t scale factors, 14 bit mantissa
+  const double ScalePrecision = 6.1e-5;
+
+  /// Equal to the precision of a float converted to double and back
+  bool sameFloat(double a, double b, double scale)
+  {
+    return fabs(a - b) <= 1e-6 * (fabs(scale) + 1e-3);
+  }
+
+  /// Shift the four-vectors, as a systematic would
+  template<class T>
+  void shiftParticles(D3PDReader::VarHandle< vector<T>* >& handle)
+  {
+    if(!handle.IsAvailable()) return;
+    vector<T>& objects = *handle();
+    for(uint i=0; i<objects.size(); i++) objects[i] *= 1.1;
+  }
+
+  /// Compare the four-vector of the objects read from the skim with their pt, eta, m
+  template<class T>
+  uint checkParticles(D3PDReader::VarHandle< vector<T>* >& skim,
+                      D3PDReader::VarHandle< vector<T>* >& input, Long64_t entry, bool verbose)
+  {
+    if(!input.IsAvailable()) return 0;
+    const vector<T>& out = *skim();
+    const vector<T>& in = *input();
+    if(out.size() != in.size()){
+      if(verbose) cout << "entry " << entry << " " << input.GetName() << ": " << out.size()
+                       << " objects instead of " << in.size() << endl;
+      return 1;
+    }
+    uint nFail = 0;
+    for(uint i=0; i<out.size(); i++){
+      const T& p = out[i];
+      bool ok = p.pt == in[i].pt && p.eta == in[i].eta && p.phi == in[i].phi && p.m == in[i].m;
+      ok = ok && sameFloat(p.Pt(), p.pt, p.pt);
+      // The pseudo-rapidity is undefined without transverse momentum
+      ok = ok && (p.pt <= 0 || sameFloat(p.Eta(), p.eta, p.eta));
+      // The mass comes from E^2 - p^2, its precision scales with E
+      ok = ok && fabs(p.M() - p.m) <= 1e-5 * (p.E() + 1);
+      if(!ok){
+        nFail++;
+        if(verbose) cout << "entry " << entry << " " << input.GetName() << " " << i
+                         << " Pt " << p.Pt() << " pt " << p.pt << " Eta " << p.Eta() << " eta " << p.eta
+                         << " M " << p.M() << " m " << p.m << endl;
+      }
+    }
+    return nFail;
+  }
+
+  /// Compare the systematic scale factors of the objects read from the skim with the input ones
+  template<class T>
+  uint checkScales(D3PDReader::VarHandle< vector<T>* >& skim,
+                   D3PDReader::VarHandle< vector<T>* >& input, Long64_t entry, bool verbose)
+  {
+    if(!input.IsAvailable()) return 0;
+    const vector<T>& out = *skim();
+    const vector<T>& in = *input();
+    if(out.size() != in.size()) return 1;
+    uint nFail = 0;
+    for(uint i=0; i<out.size(); i++){
+      for(int sys=0; sys<NtSys_N; sys++){
+        float a = out[i].sysScale(sys);
+        float b = in[i].sysScale(sys);
+        if(fabs(a - b) <= ScalePrecision * fabs(b)) continue;
+        nFail++;
+        if(verbose) cout << "entry " << entry << " " << input.GetName() << " " << i << " "
+                         << SusyNtSystNames[sys] << " scale " << a << " instead of " << b << endl;
+      }
+    }
+    return nFail;
+  }
+
+  /// Compare the cutFlags of the event read from the skim with the input ones
+  uint checkCutFlags(const Event* out, const Event* in, Long64_t entry, bool verbose)
+  {
+    uint nFail = out->cutFlagsDelta? 1 : 0;
+    for(int sys=0; sys<NtSys_N; sys++){
+      if(out->cutFlags[sys] == in->cutFlags[sys]) continue;
+      nFail++;
+      if(verbose) cout << "entry " << entry << " " << SusyNtSystNames[sys] << " cutFlags "
+                       << out->cutFlags[sys] << " instead of " << in->cutFlags[sys] << endl;
+    }
+    return nFail;
+  }
+}
+
+//----------------------------------------------------------
+bool writeSkim(const string& input, Long64_t nEntries, const string& skimFile, bool packCutFlags)
+{
+  TChain* chain = new TChain("susyNt");
+  ChainHelper::addInput(chain, input);
+  Long64_t entry = 0;
+  SusyNtObject nt(entry);
+  nt.ReadFrom(chain);
+
+  SusyNtSkimWriter writer;
+  writer.setPackCutFlags(packCutFlags);
+  bool ok = writer.open(skimFile);
+  for(Long64_t i=0; ok && i<nEntries; i++){
+    entry = chain->LoadTree(i);
+    shiftParticles(nt.ele);
+    shiftParticles(nt.muo);
+    shiftParticles(nt.jet);
+    shiftParticles(nt.pho);
+    shiftParticles(nt.tau);
+    shiftParticles(nt.tpr);
+    shiftParticles(nt.tjt);
+    writer.fill(nt);
+  }
+  writer.close();
+  delete chain;
+  return ok;
+}
+//----------------------------------------------------------
+bool checkSkim(const string& input, Long64_t nEntries, const string& skimFile, bool packCutFlags,
+               bool verbose)
+{
+  TFile* file = TFile::Open(skimFile.c_str());
+  TTree* tree = file? (TTree*) file->Get("susyNt") : 0;
+  if(tree == 0 || tree->GetEntries() != nEntries){
+    cout << "test_skimRoundTrip: cannot read " << nEntries << " entries from " << skimFile << endl;
+    delete file;
+    return false;
+  }
+  Long64_t skimEntry = 0;
+  SusyNtObject skim(skimEntry);
+  skim.ReadFrom(tree);
+
+  // The input again, with its stored kinematics
+  TChain* chain = new TChain("susyNt");
+  ChainHelper::addInput(chain, input);
+  Long64_t entry = 0;
+  SusyNtObject nt(entry);
+  nt.ReadFrom(chain);
+
+  uint nFail = 0;
+  for(Long64_t i=0; i<nEntries; i++){
+    entry = chain->LoadTree(i);
+    skimEntry = i;
+    nFail += checkParticles(skim.ele, nt.ele, i, verbose);
+    nFail += checkParticles(skim.muo, nt.muo, i, verbose);
+    nFail += checkParticles(skim.jet, nt.jet, i, verbose);
+    nFail += checkParticles(skim.pho, nt.pho, i, verbose);
+    nFail += checkParticles(skim.tau, nt.tau, i, verbose);
+    nFail += checkParticles(skim.tpr, nt.tpr, i, verbose);
+    nFail += checkParticles(skim.tjt, nt.tjt, i, verbose);
+    nFail += checkCutFlags(skim.evt(), nt.evt(), i, verbose);
+    nFail += checkScales(skim.ele, nt.ele, i, verbose);
+    nFail += checkScales(skim.muo, nt.muo, i, verbose);
+    nFail += checkScales(skim.tau, nt.tau, i, verbose);
+    nFail += checkScales(skim.jet, nt.jet, i, verbose);
+  }
+
+  delete chain;
+  file->Close();
+  delete file;
+  cout << "test_skimRoundTrip" << (packCutFlags? " (packed cutFlags)" : "") << ": "
+       << (nFail? "failed" : "passed") << " (" << nFail << " failures in " << nEntries
+       << " entries)" << endl;
+  return nFail == 0;
+}
+//----------------------------------------------------------
+void help()
+{
+  cout << "  Options:"                          << endl;
+  cout << "  -i input (file, list, or dir)"     << endl;
+  cout << "  -o skim file"                      << endl;
+  cout << "     defaults: /tmp/test_skimRoundTrip.root" << endl;
+  cout << "  -n number of entries"              << endl;
+  cout << "     defaults: 1000"                 << endl;
+  cout << "  -v print the differences"          << endl;
+  cout << "  -h print this help"                << endl;
+}
+//----------------------------------------------------------
+int main(int argc, char **argv)
+{
+  ROOT::Cintex::Cintex::Enable();
+
+  Long64_t nEntries = 1000;
+  bool verbose = false;
+  string input;
+  string skimFile = "/tmp/test_skimRoundTrip.root";
+
+  for(int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0) nEntries = atoll(argv[++i]);
+    else if (strcmp(argv[i], "-i") == 0) input = argv[++i];
+    else if (strcmp(argv[i], "-o") == 0) skimFile = argv[++i];
+    else if (strcmp(argv[i], "-v") == 0) verbose = true;
+    else {
+      help();
+      return 0;
+    }
+  }
+  if(input.empty()){
+    cout<<"You must specify an input"<<endl;
+    return 1;
+  }
+
+  TChain* chain = new TChain("susyNt");
+  ChainHelper::addInput(chain, input);
+  Long64_t nInput = chain->GetEntries();
+  delete chain;
+  if(nEntries < 0 || nEntries > nInput) nEntries = nInput;
+
+  bool ok = true;
+  for(int pack=0; pack<2; pack++){
+    if(!writeSkim(input, nEntries, skimFile, pack)){
+      cout << "test_skimRoundTrip: failed to write " << skimFile << endl;
+      return 1;
+    }
+    ok = checkSkim(input, nEntries, skimFile, pack, verbose) && ok;
+  }
+  return ok? 0 : 1;
+}
+//----------------------------------------------------------